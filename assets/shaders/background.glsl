@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor; // Bloom input (bloom_bright.glsl)
+
+in vec2 TexCoord;
+
+#include "scene_common.glsl"
+
+// Stars only, for tiles whose rays all miss the bounding sphere
+// (TileClassifier); matches the missesBounds() path of fragment.glsl
+void main() {
+    vec3 ro = cameraOrigin();
+    vec3 rd = cameraRay(ro, gl_FragCoord.xy);
+    FragColor = vec4(getStars(rd, 0.0, rd, ro), 0.0);
+    BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+}
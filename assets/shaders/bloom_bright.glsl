@@ -0,0 +1,17 @@
+// Bright part of a scene color for the bloom, using the alpha channel as a
+// mask to control which elements should bloom (disk, glow) vs not bloom
+// (stars). Written by the scene shaders as their second output; needs
+// uniform_blocks.glsl.
+
+vec4 bloomBright(vec4 sceneColor) {
+    vec3 color = sceneColor.rgb;
+    float bloomMask = sceneColor.a;
+    
+    float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    
+    if (luminance > u_BloomThreshold && bloomMask > 0.01) {
+        float soft = clamp((luminance - u_BloomThreshold) / (1.0 - u_BloomThreshold), 0.0, 1.0);
+        return vec4(color * soft * bloomMask * u_BloomIntensity, 1.0);
+    }
+    return vec4(0.0, 0.0, 0.0, 1.0);
+}
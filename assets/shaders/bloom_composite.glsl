@@ -10,12 +10,15 @@ in vec2 TexCoord;
 
 uniform sampler2D u_Scene;
 uniform sampler2D u_Bloom;
-uniform float u_BloomStrength;
-uniform float u_Exposure;
+// Part of the bloom texture under this target: xy offset, zw scale of
+// TexCoord. Tiles sample a pyramid built for the whole image.
+uniform vec4 u_BloomRect;
+
+#include "uniform_blocks.glsl"
 
 void main() {
     vec3 scene = texture(u_Scene, TexCoord).rgb;
-    vec3 bloom = texture(u_Bloom, TexCoord).rgb;
+    vec3 bloom = texture(u_Bloom, u_BloomRect.xy + TexCoord * u_BloomRect.zw).rgb;
     
     vec3 color = scene + bloom * u_BloomStrength;
     
@@ -0,0 +1,49 @@
+/*
+ * Bloom Downsample Shader
+ * Dual-filter downsample to the next (half size) pyramid level: the centre
+ * and four diagonal bilinear taps cover a 4x4 footprint of the source level.
+ * The base level is taken from the full-resolution bright texture at
+ * larger ratios (4:1 at 4K, more with a big bloom radius); there the dual
+ * filter would skip source texels and thin bright features would alias, so
+ * the target texel's whole footprint is box filtered instead, with bilinear
+ * taps at most two source texels apart.
+ */
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D u_Image;
+uniform vec2 u_TexelSize;       // Of the target, in UV
+uniform vec2 u_SourceTexelSize; // Of u_Image, in UV
+
+void main() {
+    vec2 ratio = u_TexelSize / u_SourceTexelSize;
+
+    if (max(ratio.x, ratio.y) <= 2.0) {
+        vec2 texel = 0.5 * u_TexelSize;
+
+        vec3 result = texture(u_Image, TexCoord).rgb * 4.0;
+        result += texture(u_Image, TexCoord + vec2(-texel.x, -texel.y)).rgb;
+        result += texture(u_Image, TexCoord + vec2(texel.x, -texel.y)).rgb;
+        result += texture(u_Image, TexCoord + vec2(-texel.x, texel.y)).rgb;
+        result += texture(u_Image, TexCoord + vec2(texel.x, texel.y)).rgb;
+
+        FragColor = vec4(result / 8.0, 1.0);
+        return;
+    }
+
+    // Each tap averages a 2x2 texel block; at an exact 4:1 this is the 4x4
+    // box of the old extract pass
+    ivec2 taps = ivec2(ceil(ratio * 0.5));
+    vec2 tapStep = u_TexelSize / vec2(taps);
+    vec2 origin = TexCoord - 0.5 * u_TexelSize + 0.5 * tapStep;
+
+    vec3 result = vec3(0.0);
+    for (int y = 0; y < taps.y; y++) {
+        for (int x = 0; x < taps.x; x++) {
+            result += texture(u_Image, origin + tapStep * vec2(x, y)).rgb;
+        }
+    }
+    FragColor = vec4(result / float(taps.x * taps.y), 1.0);
+}
@@ -0,0 +1,28 @@
+/*
+ * Bloom Upsample Shader
+ * 3x3 tent filter of the next coarser pyramid level. BloomRenderer blends
+ * the result into the current level, so each level ends up holding the
+ * average of itself and everything coarser.
+ */
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D u_Image;
+
+void main() {
+    vec2 texel = 1.0 / vec2(textureSize(u_Image, 0));
+
+    vec3 result = texture(u_Image, TexCoord).rgb * 4.0;
+    result += texture(u_Image, TexCoord + vec2(-texel.x, 0.0)).rgb * 2.0;
+    result += texture(u_Image, TexCoord + vec2(texel.x, 0.0)).rgb * 2.0;
+    result += texture(u_Image, TexCoord + vec2(0.0, -texel.y)).rgb * 2.0;
+    result += texture(u_Image, TexCoord + vec2(0.0, texel.y)).rgb * 2.0;
+    result += texture(u_Image, TexCoord + vec2(-texel.x, -texel.y)).rgb;
+    result += texture(u_Image, TexCoord + vec2(texel.x, -texel.y)).rgb;
+    result += texture(u_Image, TexCoord + vec2(-texel.x, texel.y)).rgb;
+    result += texture(u_Image, TexCoord + vec2(texel.x, texel.y)).rgb;
+
+    FragColor = vec4(result / 16.0, 1.0);
+}
@@ -0,0 +1,165 @@
+#version 430 core
+
+// Compute-shader variant of fragment.glsl for the march integrator
+// (ComputeTracer). Each work group traces a batch of BATCH_BLOCKS 8x8
+// pixel blocks, its lanes staying resident until the batch is done. Rays
+// march in slices of SLICE_STEPS; between slices the group's live rays
+// are compacted to the front of a shared queue and the freed lanes take
+// the batch's next pixels, so lanes whose rays ended early (horizon,
+// escape) don't idle while a neighbour circles the photon sphere. Results
+// go straight into the scene and bloom input images.
+//
+// Batches are bounded rather than pulled from a global queue until the
+// frame is done: llvmpipe runs work groups one after another per thread
+// and ends loops after 65535 iterations per invocation.
+
+#define WORKGROUP_SIZE 64
+#define BATCH_BLOCKS 16
+// Rays that use the whole step budget are compacted three times
+#define SLICE_STEPS (MARCH_STEPS / 4)
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+layout(binding = 0, rgba16f) uniform writeonly image2D u_SceneImage;
+layout(binding = 1, r11f_g11f_b10f) uniform writeonly image2D u_BrightImage;
+uniform bool u_WriteBright;
+uniform ivec4 u_Viewport; // Image region written: origin, size
+
+#include "scene_common.glsl"
+
+// A ray between slices: the march, the pixel and the disk crossings so
+// far. A ray that is still marching hasn't hit the horizon, and its exit
+// direction and lensing are only set by endMarch().
+struct QueuedRay {
+    vec4 posDist;     // pos, totalDist
+    vec4 velLensing;  // vel, accumulatedLensing
+    vec4 prevYCounts; // prevY, crossings, steps, pixel (as bits)
+    vec4 crossings01;
+    vec4 crossings23;
+};
+
+shared QueuedRay s_queue[WORKGROUP_SIZE];
+shared uint s_live;
+shared uint s_next;
+
+// Pixels are numbered by 8x8 block, so a group works on one patch of the
+// screen and its rays stay coherent until they diverge
+ivec2 pixelCoord(uint pixel) {
+    uint blocksX = (uint(u_Viewport.z) + 7u) / 8u;
+    uint block = pixel / 64u;
+    uint local = pixel % 64u;
+    return ivec2((block % blocksX) * 8u + (local % 8u), (block / blocksX) * 8u + local / 8u);
+}
+
+// gl_FragCoord of the fragment path
+vec2 fragCoord(uint pixel) {
+    return vec2(u_Viewport.xy + pixelCoord(pixel)) + 0.5;
+}
+
+void writePixel(uint pixel, vec4 color, vec4 bright) {
+    ivec2 coord = u_Viewport.xy + pixelCoord(pixel);
+    imageStore(u_SceneImage, coord, color);
+    if (u_WriteBright) {
+        imageStore(u_BrightImage, coord, bright);
+    }
+}
+
+QueuedRay packRay(MarchRay march, Geodesic g, uint pixel) {
+    return QueuedRay(vec4(march.pos, march.totalDist),
+                     vec4(march.vel, march.accumulatedLensing),
+                     vec4(march.prevY, intBitsToFloat(march.crossings),
+                          intBitsToFloat(march.steps), uintBitsToFloat(pixel)),
+                     vec4(g.crossings[0], g.crossings[1]),
+                     vec4(g.crossings[2], g.crossings[3]));
+}
+
+void unpackRay(QueuedRay ray, out MarchRay march, out Geodesic g, out uint pixel) {
+    march.pos = ray.posDist.xyz;
+    march.totalDist = ray.posDist.w;
+    march.vel = ray.velLensing.xyz;
+    march.accumulatedLensing = ray.velLensing.w;
+    march.prevY = ray.prevYCounts.x;
+    march.crossings = floatBitsToInt(ray.prevYCounts.y);
+    march.steps = floatBitsToInt(ray.prevYCounts.z);
+    pixel = floatBitsToUint(ray.prevYCounts.w);
+    g = newGeodesic(march.vel);
+    g.crossings[0] = ray.crossings01.xy;
+    g.crossings[1] = ray.crossings01.zw;
+    g.crossings[2] = ray.crossings23.xy;
+    g.crossings[3] = ray.crossings23.zw;
+}
+
+void main() {
+    uint lane = gl_LocalInvocationID.x;
+    uint blocksX = (uint(u_Viewport.z) + 7u) / 8u;
+    uint blocksY = (uint(u_Viewport.w) + 7u) / 8u;
+    uint batchStart = gl_WorkGroupID.x * uint(BATCH_BLOCKS * 64);
+    uint batchEnd = min(batchStart + uint(BATCH_BLOCKS * 64), blocksX * blocksY * 64u);
+    vec3 ro = cameraOrigin();
+
+    if (lane == 0u) s_next = batchStart;
+
+    // This lane's ray between slices, if any
+    bool marching = false;
+    QueuedRay ray;
+
+    while (true) {
+        // Compact the live rays to the front of the queue
+        if (lane == 0u) s_live = 0u;
+        memoryBarrierShared();
+        barrier();
+        if (marching) {
+            s_queue[atomicAdd(s_live, 1u)] = ray;
+        }
+        memoryBarrierShared();
+        barrier();
+
+        // The free lanes take the batch's next pixels
+        uint live = s_live;
+        uint next = s_next;
+        if (lane < live) {
+            ray = s_queue[lane];
+        }
+        // Everyone has read the queue and counters before they are reused
+        barrier();
+        if (live == 0u && next >= batchEnd) break;
+        if (lane == 0u) s_next = min(next + uint(WORKGROUP_SIZE) - live, batchEnd);
+
+        MarchRay march;
+        Geodesic g;
+        uint pixel;
+        marching = false;
+        if (lane < live) {
+            unpackRay(ray, march, g, pixel);
+            marching = true;
+        } else {
+            pixel = next + (lane - live);
+            ivec2 coord = pixelCoord(pixel);
+            if (pixel < batchEnd && all(lessThan(coord, u_Viewport.zw))) {
+                vec3 rd = cameraRay(ro, fragCoord(pixel));
+                if (missesBounds(ro, rd)) {
+                    writePixel(pixel, vec4(getStars(rd, 0.0, rd, ro), 0.0),
+                               vec4(0.0, 0.0, 0.0, 1.0));
+                } else {
+                    march = beginMarch(ro, rd);
+                    g = newGeodesic(rd);
+                    marching = true;
+                }
+            }
+        }
+
+        bool tracing = marching;
+        for (int i = 0; i < SLICE_STEPS && marching; i++) {
+            marching = marchStep(march, g);
+        }
+
+        if (marching) {
+            ray = packRay(march, g, pixel);
+        } else if (tracing) {
+            endMarch(march, g);
+            vec3 rd = cameraRay(ro, fragCoord(pixel));
+            vec4 color = shadeGeodesic(ro, rd, g);
+            writePixel(pixel, color, bloomBright(color));
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#version 330 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor; // Bloom input (bloom_bright.glsl)
+
+in vec2 TexCoord;
+
+#include "scene_common.glsl"
+
+// Written by geodesic_trace.glsl for the same viewport
+uniform sampler2D u_GeodesicExit;
+uniform sampler2D u_GeodesicCrossings01;
+uniform sampler2D u_GeodesicCrossings23;
+
+// Re-shades the disk and stars from cached geodesics: no tracing
+void main() {
+    vec3 ro = cameraOrigin();
+    vec3 rd = cameraRay(ro, gl_FragCoord.xy);
+    
+    if (missesBounds(ro, rd)) {
+       FragColor = vec4(getStars(rd, 0.0, rd, ro), 0.0);
+       BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+       return;
+    }
+    
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 exitData = texelFetch(u_GeodesicExit, texel, 0);
+    vec4 crossings01 = texelFetch(u_GeodesicCrossings01, texel, 0);
+    vec4 crossings23 = texelFetch(u_GeodesicCrossings23, texel, 0);
+    
+    Geodesic g;
+    g.hitHorizon = exitData.w < 0.0;
+    g.exitDir = exitData.xyz;
+    g.lensingAmount = max(exitData.w, 0.0);
+    g.crossings[0] = crossings01.xy;
+    g.crossings[1] = crossings01.zw;
+    g.crossings[2] = crossings23.xy;
+    g.crossings[3] = crossings23.zw;
+    
+    FragColor = shadeGeodesic(ro, rd, g);
+    BrightColor = bloomBright(FragColor);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+// G-buffer layout (GeodesicCache), read back by geodesic_shade.glsl
+layout (location = 0) out vec4 ExitData;    // exit direction, lensing (-1 = horizon)
+layout (location = 1) out vec4 Crossings01; // xz of disk crossings 0 and 1
+layout (location = 2) out vec4 Crossings23; // xz of disk crossings 2 and 3
+
+in vec2 TexCoord;
+
+#include "scene_common.glsl"
+
+// Traces every pixel's geodesic once per camera/geometry change
+void main() {
+    vec3 ro = cameraOrigin();
+    vec3 rd = cameraRay(ro, gl_FragCoord.xy);
+    
+    if (missesBounds(ro, rd)) {
+        // Not read: the shade pass repeats the bounds test
+        ExitData = vec4(0.0);
+        Crossings01 = vec4(0.0);
+        Crossings23 = vec4(0.0);
+        return;
+    }
+    
+    Geodesic g = traceGeodesic(ro, rd);
+    ExitData = vec4(g.exitDir, g.hitHorizon ? -1.0 : g.lensingAmount);
+    Crossings01 = vec4(g.crossings[0], g.crossings[1]);
+    Crossings23 = vec4(g.crossings[2], g.crossings[3]);
+}
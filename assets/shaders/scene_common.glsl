@@ -0,0 +1,698 @@
+// Shared by the scene shaders (fragment.glsl, geodesic_trace.glsl,
+// geodesic_shade.glsl, compute_trace.glsl): uniforms, disk and starfield
+// shading, and the geodesic tracer. Included after #version and the
+// outputs.
+
+#include "uniform_blocks.glsl"
+#include "bloom_bright.glsl"
+
+// Per-frame values, set directly
+uniform vec2 u_Resolution;
+uniform vec2 u_TileOffset; // Pixel origin of this viewport within u_Resolution
+uniform float u_Time;
+uniform float u_DiskPhase;
+uniform sampler3D u_NoiseTexture;
+uniform samplerCube u_StarfieldCubemap;
+
+// Baked light paths (DeflectionLUT), used instead of the march when enabled
+uniform bool u_UseDeflectionLUT;
+uniform sampler2D u_DeflectionExit;
+uniform sampler3D u_DeflectionOrbit;
+uniform vec4 u_DeflectionRange; // max alpha, min/max camera distance, max phi
+
+// Path integrator (GeodesicIntegrator), when the LUT isn't used
+const int INTEGRATOR_MARCH = 0;
+const int INTEGRATOR_BINET = 1;
+uniform int u_Integrator;
+
+// Quality tier (SceneQuality), injected by the renderer: 0 Low, 1 Medium,
+// 2 High, 3 Ultra. Tier differences are resolved by the preprocessor, so a
+// variant carries no code for the others.
+#ifndef QUALITY_TIER
+#define QUALITY_TIER 2
+#endif
+
+#if QUALITY_TIER == 0
+#define MARCH_STEPS 100
+#define MARCH_STEP_SCALE 2.0
+#define BINET_STEPS 32
+#define BINET_TOL 1e-4
+#define DISK_NOISE_LAYERS 1
+#define STAR_SAMPLES 1
+#define STAR_LOD_BIAS 1.0
+#elif QUALITY_TIER == 1
+#define MARCH_STEPS 140
+#define MARCH_STEP_SCALE 1.4
+#define BINET_STEPS 48
+#define BINET_TOL 3e-5
+#define DISK_NOISE_LAYERS 2
+#define STAR_SAMPLES 1
+#define STAR_LOD_BIAS 0.0
+#elif QUALITY_TIER == 2
+#define MARCH_STEPS 200
+#define MARCH_STEP_SCALE 1.0
+#define BINET_STEPS 64
+#define BINET_TOL 1e-5
+#define DISK_NOISE_LAYERS 3
+#define STAR_SAMPLES 1
+#define STAR_LOD_BIAS 0.0
+#else
+#define MARCH_STEPS 400
+#define MARCH_STEP_SCALE 0.5
+#define BINET_STEPS 96
+#define BINET_TOL 2e-6
+#define DISK_NOISE_LAYERS 3
+#define STAR_SAMPLES 4
+#define STAR_LOD_BIAS 0.0
+#endif
+
+const float PI = 3.14159265359;
+const float SCHWARZSCHILD_FACTOR = 3.0;
+const int MAX_STEPS = MARCH_STEPS;
+const float MAX_DIST = 80.0;
+const float EPSILON = 0.001;
+
+// ============================================================================
+// NOISE FUNCTIONS
+// Used for procedural texturing of the accretion disk and nebula background
+// ============================================================================
+
+float hash(vec2 p) {
+    return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453);
+}
+
+float noise(vec2 p) {
+    vec2 i = floor(p);
+    vec2 f = fract(p);
+    f = f * f * (3.0 - 2.0 * f);
+    
+    float a = hash(i);
+    float b = hash(i + vec2(1.0, 0.0));
+    float c = hash(i + vec2(0.0, 1.0));
+    float d = hash(i + vec2(1.0, 1.0));
+    
+    return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+}
+
+float fbm(vec2 p) {
+    float value = 0.0;
+    float amplitude = 0.5;
+    float frequency = 1.0;
+    for (int i = 0; i < 5; i++) {
+        value += amplitude * noise(p * frequency);
+        amplitude *= 0.5;
+        frequency *= 2.0;
+    }
+    return value;
+}
+
+vec4 sampleNoise3D(vec3 p) {
+    return texture(u_NoiseTexture, p);
+}
+
+float turbulenceFromTexture(vec3 p) {
+    vec4 n = sampleNoise3D(p);
+    float base = n.r * 2.0 - 1.0;
+    float oct2 = n.g * 2.0 - 1.0;
+    float oct3 = n.b * 2.0 - 1.0;
+    
+    float value = abs(base) * 0.5 + abs(oct2) * 0.25 + abs(oct3) * 0.125;
+    return value;
+}
+
+float signedNoiseFromTexture(vec3 p) {
+    float n = sampleNoise3D(p).r;
+    return n * 2.0 - 1.0;
+}
+
+vec3 rotateY(vec3 v, float angle) {
+    float c = cos(angle);
+    float s = sin(angle);
+    return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+vec3 rotateX(vec3 v, float angle) {
+    float c = cos(angle);
+    float s = sin(angle);
+    return vec3(v.x, c * v.y - s * v.z, s * v.y + c * v.z);
+}
+
+// ============================================================================
+// STARFIELD - Samples pre-rendered cubemap for O(1) performance
+// ============================================================================
+
+// Starfield along 'dir' at mip 'lod', supersampled on Ultra. Explicit LOD
+// since callers run in non-uniform control flow (no-op without mips).
+vec3 sampleStars(vec3 dir, float lod) {
+#if STAR_SAMPLES > 1
+    // Rotated-grid supersampling over the pixel's footprint
+    vec3 side = normalize(cross(dir, abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0)
+                                                       : vec3(1.0, 0.0, 0.0)));
+    vec3 up = cross(dir, side);
+    float pixel = 1.0 / min(u_Resolution.x, u_Resolution.y);
+    const vec2 taps[4] = vec2[](vec2(0.125, 0.375), vec2(-0.375, 0.125),
+                                vec2(-0.125, -0.375), vec2(0.375, -0.125));
+    vec3 col = vec3(0.0);
+    for (int i = 0; i < STAR_SAMPLES; i++) {
+        vec3 tap = normalize(dir + (taps[i].x * side + taps[i].y * up) * pixel);
+        col += textureLod(u_StarfieldCubemap, tap, lod).rgb;
+    }
+    return col / float(STAR_SAMPLES);
+#else
+    return textureLod(u_StarfieldCubemap, dir, lod).rgb;
+#endif
+}
+
+// Stars behind the march: its bending is too weak to show the lensed sky
+// by itself, so the sky is stretched around the black hole by hand
+vec3 getStars(vec3 rd, float lensingAmount, vec3 initialDir, vec3 cameraPos) {
+    vec3 toBlackHole = normalize(-cameraPos);
+    float distFromCamera = length(cameraPos);
+    float angularDistToCenter = acos(clamp(dot(normalize(initialDir), toBlackHole), -1.0, 1.0));
+    
+    float apparentSize = u_BlackHoleRadius * 3.0 / distFromCamera;
+    float innerZone = clamp(apparentSize * 0.8, 0.05, 0.2);   
+    float outerZone = clamp(apparentSize * 2.5, 0.15, 0.6);   
+    
+    float proximityStretch;
+    if (angularDistToCenter < innerZone) {
+        proximityStretch = 1.0;
+    } else if (angularDistToCenter < outerZone) {
+        float t = (angularDistToCenter - innerZone) / (outerZone - innerZone);
+        proximityStretch = 1.0 - smoothstep(0.0, 1.0, t);
+        proximityStretch = pow(proximityStretch, 0.5);  
+    } else {
+        proximityStretch = 0.0;
+    }
+    
+    float radiusScale = u_BlackHoleRadius * 2.0;
+    
+    float totalStretch = max(lensingAmount * 2.0, proximityStretch) * radiusScale;
+    
+    float stretch = 1.0 + totalStretch * 20.0;
+    
+    vec3 sampleDir = rd;
+    
+    vec3 radialDir = normalize(toBlackHole - rd * dot(rd, toBlackHole));
+    float radialPull = totalStretch * 0.4;
+    sampleDir = normalize(sampleDir + radialDir * radialPull);
+    
+    sampleDir.y /= stretch;
+    sampleDir = normalize(sampleDir);
+    
+    // Strong lensing squeezes a wide patch of sky into each pixel; read a
+    // correspondingly coarser mip instead of aliasing
+    vec3 col = sampleStars(sampleDir, log2(stretch) * 0.5 + STAR_LOD_BIAS);
+    
+    col *= 1.0 + totalStretch * 1.5;
+    
+    return col;
+}
+
+// Stars behind a Binet geodesic: exitDir already carries the whole
+// deflection, so it is sampled as is, at its own brightness (lensing keeps
+// surface brightness). The mip follows how much sky lands in a pixel. With
+// alpha the ray's angle off the black hole at the camera, theta the exit
+// direction's angle off the axis behind it and delta the deflection, the
+// sky is stretched sin(theta) / sin(alpha) times around the axis and, for a
+// point lens (delta proportional to 1 / sin(alpha)), 1 + delta cot(alpha)
+// times along it.
+vec3 getLensedStars(vec3 exitDir, vec3 initialDir, vec3 cameraPos) {
+    vec3 axis = normalize(-cameraPos);
+    float cosAlpha = clamp(dot(normalize(initialDir), axis), -1.0, 1.0);
+    float sinAlpha = max(sqrt(1.0 - cosAlpha * cosAlpha), 1e-4);
+    float sinTheta = length(cross(exitDir, axis));
+    float delta = acos(clamp(dot(normalize(initialDir), exitDir), -1.0, 1.0));
+    float stretch = max(sinTheta / sinAlpha, 1.0 + delta * cosAlpha / sinAlpha);
+    return sampleStars(exitDir, log2(stretch) + STAR_LOD_BIAS);
+}
+
+// ============================================================================
+// ACCRETION DISK - Texture-based noise for performance
+// ============================================================================
+
+vec3 sampleDisk(vec3 pos, float distToCenter) {
+    if (distToCenter < u_DiskInnerRadius || distToCenter > u_DiskOuterRadius) {
+        return vec3(0.0);
+    }
+    
+    float t = (distToCenter - u_DiskInnerRadius) / (u_DiskOuterRadius - u_DiskInnerRadius);
+    float angle = atan(pos.z, pos.x);
+    
+    // ===== TANGENTIAL GAS STREAKS =====
+    float rotAngle = angle - u_DiskPhase * 0.2;
+    
+    float u = rotAngle / (2.0 * PI);
+    float v = t; // 0.0 to 1.0
+    
+
+    // === Layer 1: Base Flow (The "river") ===
+    // Medium radial freq to define lanes, heavily warped
+    float warp = sampleNoise3D(vec3(u * 2.0, v * 1.5, u_Time * 0.05)).b * 0.15;
+    vec3 baseCoord = vec3(u * 3.0 + warp, v * 4.0 + warp, 0.0);
+    float baseFlow = sampleNoise3D(baseCoord).r; // [0,1]
+    
+    baseFlow = smoothstep(0.2, 0.8, baseFlow);
+    
+    // === Layer 2: Engraved Streaks (Texture) ===
+    // High freq, stretched tangentially
+    // These add the "fast gas" look on top of the heavy river
+#if DISK_NOISE_LAYERS >= 2
+    vec3 streakCoord = vec3(u * 8.0 + warp * 2.0, v * 12.0, u_Time * 0.1);
+    float streaks = sampleNoise3D(streakCoord).g;
+    
+    streaks = pow(streaks, 2.0);
+#else
+    float streaks = 0.33; // Mean of the layer, keeps the brightness
+#endif
+    
+    // === Layer 3: Hotspots/Clumps ===
+    // Variation in brightness
+#if DISK_NOISE_LAYERS >= 3
+    float clumps = sampleNoise3D(vec3(u * 4.0, v * 3.0, 5.0)).b;
+#else
+    float clumps = 0.5;
+#endif
+    
+    float noiseVal = baseFlow * 0.6 + streaks * 0.4;
+    noiseVal *= (0.7 + 0.3 * clumps);
+    float diskNoise = 0.3 + 0.7 * noiseVal;
+    
+    float edgeFade = smoothstep(0.0, 0.15, t) * smoothstep(1.0, 0.85, t);
+    diskNoise = diskNoise * edgeFade + (1.0 - edgeFade) * 0.1; // Darker at edges
+    
+    // Temperature gradient
+    float temperature = pow(1.0 - t, 0.5);
+    vec3 baseColor = mix(u_DiskColor2, u_DiskColor1, temperature);
+    
+    // Relativistic Doppler beaming
+    float orbitalSpeed = 0.4 * (1.0 - t * 0.5);
+    vec3 tangent = normalize(vec3(-sin(angle), 0.0, cos(angle)));
+    vec3 velocity = tangent * orbitalSpeed;
+    vec3 viewDir = normalize(vec3(0.0, sin(u_CameraAngle), cos(u_CameraAngle)));
+    
+    float dopplerFactor = dot(velocity, viewDir);
+    
+    float beaming = pow(1.0 + dopplerFactor * 2.0, 3.0);
+    beaming = clamp(beaming, 0.1, 5.0);
+    
+    vec3 color = baseColor;
+    if (dopplerFactor > 0.0) {
+        vec3 blueShift = vec3(0.8, 0.9, 1.0);
+        color = mix(color, color * blueShift * 1.5, dopplerFactor * 1.5);
+    } else {
+        vec3 redShift = vec3(1.2, 0.6, 0.3);
+        color = mix(color, color * redShift * 0.7, abs(dopplerFactor) * 1.2);
+    }
+    
+    color *= 0.3 + 0.7 * diskNoise;
+    float brightness = (1.0 - t) * (0.2 + 0.8 * diskNoise) * beaming;
+    
+    return color * brightness * 2.0;
+}
+
+// ============================================================================
+// GEODESICS - Per-ray light paths, independent of time
+// ============================================================================
+
+// Disk-plane crossings kept per ray, in every path (direct, cached, compute
+// and CpuTracer); further (ever thinner) images are dropped. Unused slots
+// are (0, 0), which lies inside the horizon.
+const int MAX_DISK_CROSSINGS = 4;
+
+// Path of one camera ray: everything about it that doesn't change while the
+// camera and the black hole geometry stay put. Crossings are the xz of the
+// hits on the disk plane that fall within the disk's radial extent.
+struct Geodesic {
+    bool hitHorizon;
+    vec3 exitDir;
+    float lensingAmount;
+    vec2 crossings[MAX_DISK_CROSSINGS];
+};
+
+bool onDisk(float distToCenter) {
+    return distToCenter >= u_DiskInnerRadius && distToCenter <= u_DiskOuterRadius;
+}
+
+// ============================================================================
+// DEFLECTION LUT - Precomputed light paths
+// Every ray stays in the plane spanned by the camera position and its initial
+// direction, so its path only depends on the angle off the black hole and the
+// camera distance. Disk crossings are where that plane meets y = 0.
+// ============================================================================
+
+const int LUT_DISK_CROSSINGS = 3;
+
+float lutCoord(float t, int size) {
+    return (clamp(t, 0.0, 1.0) * float(size - 1) + 0.5) / float(size);
+}
+
+void traceDeflectionLUT(vec3 ro, vec3 rd, inout Geodesic g) {
+    vec3 e1 = normalize(ro);
+    float cosAlpha = clamp(dot(rd, -e1), -1.0, 1.0);
+    float alpha = acos(cosAlpha);
+    vec3 perp = rd + e1 * cosAlpha;
+    float perpLen = length(perp);
+    vec3 e2 = perpLen > 1e-6 ? perp / perpLen : normalize(cross(e1, vec3(1.0, 0.0, 0.0)));
+    
+    ivec2 exitSize = textureSize(u_DeflectionExit, 0);
+    vec2 lutUV = vec2(
+        lutCoord(sqrt(alpha / u_DeflectionRange.x), exitSize.x),
+        lutCoord((u_CameraDistance - u_DeflectionRange.y) / (u_DeflectionRange.z - u_DeflectionRange.y), exitSize.y));
+    
+    vec4 exitData = texture(u_DeflectionExit, lutUV);
+    g.hitHorizon = exitData.g > 0.5;
+    g.exitDir = cos(exitData.r) * e1 + sin(exitData.r) * e2;
+    g.lensingAmount = clamp(exitData.b * 10.0, 0.0, 1.0);
+    float endPhi = exitData.a;
+    
+    // Polar angles where the ray plane meets the disk plane, one per image order
+    int phiSize = textureSize(u_DeflectionOrbit, 0).x;
+    float phi = atan(-e1.y, e2.y);
+    if (phi <= 0.0) phi += PI;
+    
+    int count = 0;
+    for (int k = 0; k < LUT_DISK_CROSSINGS; k++) {
+        if (phi > endPhi) break;
+        
+        float invR = texture(u_DeflectionOrbit, vec3(lutCoord(phi / u_DeflectionRange.w, phiSize), lutUV)).r;
+        vec3 intersect = (cos(phi) * e1 + sin(phi) * e2) / invR;
+        if (onDisk(length(intersect.xz))) {
+            g.crossings[count++] = intersect.xz;
+        }
+        phi += PI;
+    }
+}
+
+// March of one ray between steps, so a tracer can advance it in slices
+// (compute_trace.glsl)
+struct MarchRay {
+    vec3 pos;
+    vec3 vel;
+    float totalDist;
+    float accumulatedLensing;
+    float prevY;
+    int crossings; // Used slots of Geodesic.crossings
+    int steps;
+};
+
+MarchRay beginMarch(vec3 ro, vec3 rd) {
+    MarchRay r;
+    r.pos = ro;
+    r.vel = rd;
+    r.totalDist = 0.0;
+    r.accumulatedLensing = 0.0;
+    r.prevY = ro.y;
+    r.crossings = 0;
+    r.steps = 0;
+    return r;
+}
+
+// Advance one step; false once the ray is done (horizon, escape, distance
+// or step budget), with nothing changed
+bool marchStep(inout MarchRay r, inout Geodesic g) {
+    if (r.steps >= MAX_STEPS) return false;
+    
+    float distToCenter = length(r.pos);
+    
+    if (distToCenter < u_BlackHoleRadius) {
+        g.hitHorizon = true;
+        return false;
+    }
+    
+    if (r.totalDist > MAX_DIST) return false;
+    
+    if (distToCenter > u_DiskOuterRadius * 2.5 && dot(r.vel, r.pos) > 0.0) {
+        return false;
+    }
+    
+    vec3 toCenter = -normalize(r.pos);
+    float gravity = u_BlackHoleRadius * SCHWARZSCHILD_FACTOR / (distToCenter * distToCenter);
+    
+    // Bending and lensing per step scale with the step length, so the
+    // tiers trace the same path at different resolutions
+    vec3 oldVel = r.vel;
+    r.vel = normalize(r.vel + toCenter * gravity * (0.15 * MARCH_STEP_SCALE));
+    r.accumulatedLensing += (1.0 - dot(oldVel, r.vel)) / MARCH_STEP_SCALE;
+    
+    float stepSize = clamp((distToCenter - u_BlackHoleRadius) * (0.08 * MARCH_STEP_SCALE),
+                           0.005 * MARCH_STEP_SCALE, 0.4 * MARCH_STEP_SCALE);
+    
+    vec3 newPos = r.pos + r.vel * stepSize;
+    float newY = newPos.y;
+    
+    if (r.prevY * newY < 0.0 && abs(newY) < u_DiskThickness) {
+        float interpT = r.prevY / (r.prevY - newY);
+        vec3 intersect = r.pos + r.vel * stepSize * interpT;
+        if (r.crossings < MAX_DISK_CROSSINGS && onDisk(length(intersect.xz))) {
+            g.crossings[r.crossings++] = intersect.xz;
+        }
+    }
+    
+    r.prevY = newY;
+    r.pos = newPos;
+    r.totalDist += stepSize;
+    r.steps++;
+    return true;
+}
+
+void endMarch(MarchRay r, inout Geodesic g) {
+    g.exitDir = r.vel;
+    g.lensingAmount = clamp(r.accumulatedLensing * 10.0, 0.0, 1.0);
+}
+
+void marchGeodesic(vec3 ro, vec3 rd, inout Geodesic g) {
+    MarchRay r = beginMarch(ro, rd);
+    while (marchStep(r, g)) {}
+    endMarch(r, g);
+}
+
+// ============================================================================
+// BINET INTEGRATOR - Schwarzschild null geodesics in the orbit plane
+// With u = 1/r as a function of the polar angle phi, light obeys
+// u'' + u = 3 M u^2, M being half the horizon radius. Integrated with an
+// adaptive Cash-Karp RK45; once the ray heads out of the strong field it is
+// finished with the weak-field deflection of the remaining straight path.
+// ============================================================================
+
+const int BINET_MAX_STEPS = BINET_STEPS; // Accepted and rejected
+const float BINET_TOLERANCE = BINET_TOL; // Per step, relative to the state
+const float BINET_MAX_STEP = 0.5;        // Radians of polar angle
+const float BINET_EXIT_RADIUS = 40.0;    // Horizon radii; tail error < 1e-3 rad
+
+vec2 binetDerivative(vec2 y, float horizon) {
+    return vec2(y.y, 1.5 * horizon * y.x * y.x - y.x);
+}
+
+// One Cash-Karp step of h radians; returns the 5th order solution and the
+// difference to the embedded 4th order one in err
+vec2 binetStep(vec2 y, float h, float horizon, out vec2 err) {
+    vec2 k1 = binetDerivative(y, horizon);
+    vec2 k2 = binetDerivative(y + h * (0.2 * k1), horizon);
+    vec2 k3 = binetDerivative(y + h * (3.0 / 40.0 * k1 + 9.0 / 40.0 * k2), horizon);
+    vec2 k4 = binetDerivative(y + h * (0.3 * k1 - 0.9 * k2 + 1.2 * k3), horizon);
+    vec2 k5 = binetDerivative(y + h * (-11.0 / 54.0 * k1 + 2.5 * k2 - 70.0 / 27.0 * k3 +
+                                       35.0 / 27.0 * k4), horizon);
+    vec2 k6 = binetDerivative(y + h * (1631.0 / 55296.0 * k1 + 175.0 / 512.0 * k2 +
+                                       575.0 / 13824.0 * k3 + 44275.0 / 110592.0 * k4 +
+                                       253.0 / 4096.0 * k5), horizon);
+    vec2 y5 = y + h * (37.0 / 378.0 * k1 + 250.0 / 621.0 * k3 + 125.0 / 594.0 * k4 +
+                       512.0 / 1771.0 * k6);
+    vec2 y4 = y + h * (2825.0 / 27648.0 * k1 + 18575.0 / 48384.0 * k3 +
+                       13525.0 / 55296.0 * k4 + 277.0 / 14336.0 * k5 + 0.25 * k6);
+    err = abs(y5 - y4);
+    return y5;
+}
+
+// u at fraction t of a step from (u0, u0') to (u1, u1')
+float binetInterpolate(vec2 y0, vec2 y1, float h, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return (2.0 * t3 - 3.0 * t2 + 1.0) * y0.x + (t3 - 2.0 * t2 + t) * h * y0.y +
+           (3.0 * t2 - 2.0 * t3) * y1.x + (t3 - t2) * h * y1.y;
+}
+
+void integrateBinet(vec3 ro, vec3 rd, inout Geodesic g) {
+    float horizon = u_BlackHoleRadius;
+    vec3 e1 = normalize(ro);
+    float cosAlpha = dot(rd, e1);
+    vec3 perp = rd - e1 * cosAlpha;
+    float perpLen = length(perp);
+    if (perpLen < 1e-6) {
+        // Radial ray: straight in or out
+        g.hitHorizon = cosAlpha < 0.0;
+        return;
+    }
+    vec3 e2 = perp / perpLen;
+    
+    // State (u, du/dphi); phi grows along the ray from the camera at phi = 0
+    vec2 y = vec2(1.0 / length(ro), 0.0);
+    y.y = -y.x * cosAlpha / perpLen;
+    float phi = 0.0;
+    float h = 0.1;
+    float uHorizon = 1.0 / horizon;
+    float uExit = 1.0 / max(u_DiskOuterRadius, BINET_EXIT_RADIUS * horizon);
+    
+    // The disk plane cuts the orbit plane along a line, so crossings are at
+    // fixed polar angles, pi apart
+    float crossPhi = atan(-e1.y, e2.y);
+    if (crossPhi <= 0.0) crossPhi += PI;
+    int count = 0;
+    
+    bool escaped = false;
+    for (int i = 0; i < BINET_MAX_STEPS; i++) {
+        if (y.x >= uHorizon) break;
+        if (y.y < 0.0 && y.x < uExit) {
+            escaped = true;
+            break;
+        }
+        
+        vec2 err;
+        vec2 next = binetStep(y, h, horizon, err);
+        float e = max(err.x, err.y) / (BINET_TOLERANCE * max(y.x, abs(y.y)));
+        // Stepping past the asymptote (u <= 0) would leave the orbit
+        if (next.x <= 0.0) {
+            h *= 0.5;
+            continue;
+        }
+        if (e > 1.0 && h > 1e-4) {
+            h *= max(0.9 * pow(e, -0.25), 0.2);
+            continue;
+        }
+        
+        for (; crossPhi <= phi + h && count < MAX_DISK_CROSSINGS; crossPhi += PI) {
+            float u = binetInterpolate(y, next, h, (crossPhi - phi) / h);
+            vec3 intersect = (cos(crossPhi) * e1 + sin(crossPhi) * e2) / u;
+            if (u > 0.0 && u < uHorizon && onDisk(length(intersect.xz))) {
+                g.crossings[count++] = intersect.xz;
+            }
+        }
+        
+        phi += h;
+        y = next;
+        h = min(h * min(0.9 * pow(max(e, 1e-6), -0.2), 5.0), BINET_MAX_STEP);
+    }
+    
+    // Captured, or still circling the photon sphere after all steps
+    if (!escaped) {
+        g.hitHorizon = true;
+        return;
+    }
+    
+    // Direction angle in the orbit plane, then the rest of the bending of a
+    // straight line with impact parameter b from here to infinity:
+    // (2M / b) * (1 - s / r), s being the distance past closest approach
+    float u = y.x, w = y.y;
+    float psi = phi + atan(u, -w);
+    float invB = sqrt(max(w * w + u * u - horizon * u * u * u, 0.0));
+    psi += horizon * invB * (1.0 + w * inversesqrt(w * w + u * u));
+    g.exitDir = cos(psi) * e1 + sin(psi) * e2;
+    // lensingAmount stays 0: getLensedStars() works from exitDir alone
+}
+
+// ============================================================================
+// CAMERA AND TRACING
+// Traces rays from the camera through curved spacetime around the black hole.
+// Uses a simplified Schwarzschild metric approximation for light bending.
+// ============================================================================
+
+vec3 cameraOrigin() {
+    return rotateX(vec3(0.0, 0.0, u_CameraDistance), u_CameraAngle);
+}
+
+vec3 cameraRay(vec3 ro, vec2 fragCoord) {
+    vec2 uv = (fragCoord + u_TileOffset - 0.5 * u_Resolution) / min(u_Resolution.x, u_Resolution.y);
+    
+    vec3 forward = normalize(-ro);
+    vec3 right = normalize(cross(vec3(0.0, 1.0, 0.0), forward));
+    vec3 up = cross(forward, right);
+    return normalize(forward + uv.x * right + uv.y * up);
+}
+
+// Bounding Sphere Check
+// If the ray doesn't pass near the black hole system, skip the expensive integration.
+// Not with the Binet integrator: its rays still bend by ~2 rs / b out there.
+bool missesBounds(vec3 ro, vec3 rd) {
+    if (u_Integrator == INTEGRATOR_BINET) return false;
+    
+    float boundRadius = max(u_DiskOuterRadius * 1.5, u_BlackHoleRadius * 15.0);
+    float b = dot(ro, rd);
+    float c = dot(ro, ro) - boundRadius * boundRadius;
+    float h = b*b - c;
+    
+    // If ray misses the bounding sphere and we are outside it
+    return h < 0.0 && c > 0.0;
+}
+
+// A ray that goes straight and hits nothing, until traced
+Geodesic newGeodesic(vec3 rd) {
+    Geodesic g;
+    g.hitHorizon = false;
+    g.exitDir = rd;
+    g.lensingAmount = 0.0;
+    for (int k = 0; k < MAX_DISK_CROSSINGS; k++) {
+        g.crossings[k] = vec2(0.0);
+    }
+    return g;
+}
+
+Geodesic traceGeodesic(vec3 ro, vec3 rd) {
+    Geodesic g = newGeodesic(rd);
+
+    bool useLUT = u_UseDeflectionLUT &&
+                  u_CameraDistance >= u_DeflectionRange.y &&
+                  u_CameraDistance <= u_DeflectionRange.z;
+    
+    if (useLUT) {
+        traceDeflectionLUT(ro, rd, g);
+    } else if (u_Integrator == INTEGRATOR_BINET) {
+        integrateBinet(ro, rd, g);
+    } else {
+        marchGeodesic(ro, rd, g);
+    }
+    return g;
+}
+
+// Final color (rgb) and bloom mask (a) of a traced ray. Only this part
+// depends on time and the disk phase.
+vec4 shadeGeodesic(vec3 ro, vec3 rd, Geodesic g) {
+    vec3 color = vec3(0.0);
+    float bloomMask = 0.0;
+    
+    for (int k = 0; k < MAX_DISK_CROSSINGS; k++) {
+        vec2 c = g.crossings[k];
+        if (c == vec2(0.0)) break;
+        
+        vec3 diskColor = sampleDisk(vec3(c.x, 0.0, c.y), length(c));
+        if (length(diskColor) > 0.0) {
+            color += diskColor;
+            bloomMask = 1.0;
+        }
+    }
+    
+    if (!g.hitHorizon) {
+        color += u_Integrator == INTEGRATOR_BINET ? getLensedStars(g.exitDir, rd, ro)
+                                                  : getStars(g.exitDir, g.lensingAmount, rd, ro);
+    }
+    
+    float angularDist = acos(clamp(dot(normalize(rd), normalize(-ro)), -1.0, 1.0));
+    float glowRadius = atan(u_BlackHoleRadius * 10.0 / u_CameraDistance);
+    
+    if (angularDist < glowRadius && !g.hitHorizon) {
+        float glow = 1.0 - smoothstep(0.0, glowRadius, angularDist);
+        glow = pow(glow, 1.5);
+        color += vec3(1.0, 0.5, 0.2) * glow * u_GlowIntensity;
+        bloomMask = max(bloomMask, glow);
+    }
+    
+    // The Binet shadow edge is the critical impact parameter, 3 sqrt(3) M
+    float ringImpact = u_Integrator == INTEGRATOR_BINET ? 2.598 : 1.5;
+    float photonRingRadius = atan(u_BlackHoleRadius * ringImpact / u_CameraDistance);
+    float photonRing = smoothstep(0.03, 0.0, abs(angularDist - photonRingRadius));
+    if (!g.hitHorizon) {
+        color += vec3(1.0, 0.9, 0.7) * photonRing * u_GlowIntensity;
+        bloomMask = max(bloomMask, photonRing);
+    }
+    
+    return vec4(color, bloomMask);
+}
@@ -0,0 +1,24 @@
+// Parameter blocks shared by the scene and bloom shaders (std140, mirrored
+// by the structs in src/UniformBuffer.h). Members are read as globals.
+
+layout(std140) uniform BlackHoleBlock {
+    float u_BlackHoleRadius;
+    float u_DiskInnerRadius;
+    float u_DiskOuterRadius;
+    float u_DiskThickness;
+    vec3 u_DiskColor1;
+    float u_GlowIntensity;
+    vec3 u_DiskColor2;
+};
+
+layout(std140) uniform CameraBlock {
+    float u_CameraDistance;
+    float u_CameraAngle;
+};
+
+layout(std140) uniform BloomBlock {
+    float u_BloomThreshold;
+    float u_BloomIntensity;
+    float u_BloomStrength; // 0 when bloom is off
+    float u_Exposure;
+};
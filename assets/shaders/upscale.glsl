@@ -0,0 +1,54 @@
+/*
+ * Scene Upscale Shader
+ * Scales the reduced-resolution ray-march result up to the full scene
+ * target. Catmull-Rom keeps the photon ring and disk edges sharp; clamping
+ * to the four nearest source texels removes the kernel's ringing, so edges
+ * don't pick up dark or bright halos. The bloom input is taken from the
+ * upscaled color, as the scene shaders do at full resolution.
+ */
+#version 330 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D u_Source;
+uniform vec2 u_SourceSize; // Rendered region in texels, from the origin
+
+#include "uniform_blocks.glsl"
+#include "bloom_bright.glsl"
+
+vec4 fetch(ivec2 p) {
+    return texelFetch(u_Source, clamp(p, ivec2(0), ivec2(u_SourceSize) - 1), 0);
+}
+
+void main() {
+    vec2 pos = TexCoord * u_SourceSize - 0.5;
+    vec2 base = floor(pos);
+    vec2 f = pos - base;
+    ivec2 p = ivec2(base);
+
+    // Catmull-Rom weights for taps at -1, 0, 1, 2
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    float wx[4] = float[](w0.x, w1.x, w2.x, w3.x);
+    float wy[4] = float[](w0.y, w1.y, w2.y, w3.y);
+
+    vec4 sum = vec4(0.0);
+    for (int y = 0; y < 4; y++) {
+        vec4 row = vec4(0.0);
+        for (int x = 0; x < 4; x++) {
+            row += wx[x] * fetch(p + ivec2(x - 1, y - 1));
+        }
+        sum += wy[y] * row;
+    }
+
+    vec4 a = fetch(p);
+    vec4 b = fetch(p + ivec2(1, 0));
+    vec4 c = fetch(p + ivec2(0, 1));
+    vec4 d = fetch(p + ivec2(1, 1));
+    FragColor = clamp(sum, min(min(a, b), min(c, d)), max(max(a, b), max(c, d)));
+    BrightColor = bloomBright(FragColor);
+}
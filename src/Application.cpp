@@ -4,12 +4,31 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <vector>
 
 // Static instance pointer for GLFW callbacks
 static Application *s_instance = nullptr;
 
+// Frames drawn after an input event: ImGui shows the effect of input (hover,
+// opening popups) a frame late, and some widgets take another to settle
+static const int INPUT_FRAMES = 3;
+// Longest idle block in glfwWaitEventsTimeout, and the shorter one while
+// exports are still being read back and encoded
+static const double IDLE_TIMEOUT = 0.5;
+static const double EXPORT_POLL_INTERVAL = 1.0 / 30.0;
+static const char *SHARED_OUTPUT_NAME = "/blackhole";
+
+bool Application::SceneState::operator==(const SceneState &other) const {
+  return params == other.params && camera == other.camera &&
+         options == other.options && bloom == other.bloom &&
+         width == other.width && height == other.height && time == other.time;
+}
+
 Application::Application() { s_instance = this; }
 
 Application::~Application() {
@@ -44,7 +63,11 @@ bool Application::init(int width, int height, const char *title) {
   glfwSetScrollCallback(m_window, scrollCallback);
   glfwSetCursorPosCallback(m_window, cursorPosCallback);
   glfwSetMouseButtonCallback(m_window, mouseButtonCallback);
-  glfwSwapInterval(1);
+  glfwSetKeyCallback(m_window, keyCallback);
+  glfwSetCharCallback(m_window, charCallback);
+  glfwSetWindowRefreshCallback(m_window, windowRefreshCallback);
+  m_swapInterval = m_framePacer.getSwapInterval();
+  glfwSwapInterval(m_swapInterval);
 
   // Initialize GLAD
   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -71,38 +94,114 @@ bool Application::init(int width, int height, const char *title) {
   m_bloomRenderer.init(width, height);
   m_screenshotExporter.init();
   m_blackHoleRenderer.init(width, height);
+  m_blackHoleRenderer.setProfiler(&m_gpuProfiler);
+  m_bloomRenderer.setProfiler(&m_gpuProfiler);
 
   return true;
 }
 
 void Application::run() {
   while (!glfwWindowShouldClose(m_window)) {
-    float currentTime = (float)glfwGetTime();
-    m_frameTime = currentTime - m_lastFrameTime;
-    m_lastFrameTime = currentTime;
-    m_fps = 1.0f / m_frameTime;
+    // Idle: nothing animates and no input asked for a frame. The last frame
+    // stays on screen; only queued exports make progress.
+    if (m_renderOnDemand && m_pendingFrames == 0 && !isAnimating()) {
+      m_framePacer.pause();
+      glfwWaitEventsTimeout(m_screenshotExporter.getPendingCount() > 0 ||
+                                    m_sharedOutput.getPendingCount() > 0
+                                ? EXPORT_POLL_INTERVAL
+                                : IDLE_TIMEOUT);
+      m_screenshotExporter.update();
+      m_sharedOutput.update();
+      continue;
+    }
+
+    if (m_swapInterval != m_framePacer.getSwapInterval()) {
+      m_swapInterval = m_framePacer.getSwapInterval();
+      glfwSwapInterval(m_swapInterval);
+    }
+    // Fixed rate: input arriving in the meantime is handled while waiting
+    double wait;
+    while ((wait = m_framePacer.getWaitTime(glfwGetTime())) > 0.0) {
+      glfwWaitEventsTimeout(wait);
+    }
+    float frameTime = m_framePacer.beginFrame(glfwGetTime());
+    if (isAnimating()) {
+      m_sceneTime += frameTime;
+    }
 
     // Update simulation
-    m_blackHoleRenderer.update(m_frameTime);
+    m_blackHoleRenderer.update(frameTime);
 
     processInput();
+    m_gpuProfiler.beginFrame();
+    updateResolutionScale();
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
     renderUI();
-    renderScene();
+
+    // An unchanged scene is only composited again under the UI
+    SceneState scene = getSceneState();
+    bool sceneChanged = !m_sceneValid || scene != m_lastScene;
+    if (sceneChanged) {
+      renderScene();
+      m_lastScene = scene;
+      m_sceneValid = true;
+      if (m_sharedOutputEnabled)
+        publishSharedFrame();
+    } else {
+      m_bloomRenderer.recomposite(m_bloomParams,
+                                  m_blackHoleRenderer.getQuadVAO());
+    }
+    m_screenshotExporter.update();
+    m_sharedOutput.update();
 
     ImGui::Render();
+    m_gpuProfiler.beginPass("imgui");
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    m_gpuProfiler.endPass();
+    m_gpuProfiler.endFrame();
 
     glfwSwapBuffers(m_window);
+
+    // A held widget keeps frames coming, and a changed scene is drawn once
+    // more in case it is still moving (e.g. dynamic resolution)
+    if (m_pendingFrames > 0)
+      m_pendingFrames--;
+    if (sceneChanged || ImGui::IsAnyItemActive())
+      requestFrames(1);
     glfwPollEvents();
   }
 }
 
+// Scene time runs unless render-on-demand may stop it
+bool Application::isAnimating() const {
+  return !m_renderOnDemand ||
+         m_blackHoleRenderer.getParams().diskSpeed != 0.0f;
+}
+
+void Application::requestFrames(int count) {
+  m_pendingFrames = std::max(m_pendingFrames, count);
+}
+
+Application::SceneState Application::getSceneState() const {
+  SceneState state;
+  state.params = m_blackHoleRenderer.getParams();
+  state.camera = m_blackHoleRenderer.getCameraParams();
+  state.options = m_blackHoleRenderer.getOptions();
+  state.bloom = m_bloomParams;
+  state.width = m_width;
+  state.height = m_height;
+  state.time = m_sceneTime;
+  return state;
+}
+
 void Application::shutdown() {
+  m_screenshotExporter.shutdown();
+  m_sharedOutput.close();
+  m_gpuProfiler.shutdown();
   m_blackHoleRenderer.shutdown();
   
   ImGui_ImplOpenGL3_Shutdown();
@@ -119,6 +218,7 @@ void Application::shutdown() {
 void Application::framebufferSizeCallback(GLFWwindow *window, int width,
                                           int height) {
   if (s_instance) {
+    s_instance->requestFrames(INPUT_FRAMES);
     s_instance->m_width = width;
     s_instance->m_height = height;
     glViewport(0, 0, width, height);
@@ -128,6 +228,8 @@ void Application::framebufferSizeCallback(GLFWwindow *window, int width,
 
 void Application::scrollCallback(GLFWwindow *window, double xoffset,
                                  double yoffset) {
+  if (s_instance)
+    s_instance->requestFrames(INPUT_FRAMES);
   ImGuiIO &io = ImGui::GetIO();
   if (io.WantCaptureMouse)
     return;
@@ -141,6 +243,8 @@ void Application::scrollCallback(GLFWwindow *window, double xoffset,
 
 void Application::cursorPosCallback(GLFWwindow *window, double xpos,
                                     double ypos) {
+  if (s_instance)
+    s_instance->requestFrames(INPUT_FRAMES);
   ImGuiIO &io = ImGui::GetIO();
   if (io.WantCaptureMouse)
     return;
@@ -161,6 +265,8 @@ void Application::cursorPosCallback(GLFWwindow *window, double xpos,
 
 void Application::mouseButtonCallback(GLFWwindow *window, int button,
                                       int action, int mods) {
+  if (s_instance)
+    s_instance->requestFrames(INPUT_FRAMES);
   ImGuiIO &io = ImGui::GetIO();
   if (io.WantCaptureMouse)
     return;
@@ -176,6 +282,25 @@ void Application::mouseButtonCallback(GLFWwindow *window, int button,
   }
 }
 
+// Keys and text only matter to ImGui (which chains these callbacks) and
+// processInput(), but they need frames to be seen
+void Application::keyCallback(GLFWwindow *window, int key, int scancode,
+                              int action, int mods) {
+  if (s_instance)
+    s_instance->requestFrames(INPUT_FRAMES);
+}
+
+void Application::charCallback(GLFWwindow *window, unsigned int codepoint) {
+  if (s_instance)
+    s_instance->requestFrames(INPUT_FRAMES);
+}
+
+// The window system lost the contents (e.g. the window was uncovered)
+void Application::windowRefreshCallback(GLFWwindow *window) {
+  if (s_instance)
+    s_instance->requestFrames(1);
+}
+
 void Application::processInput() {
   if (glfwGetKey(m_window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
     glfwSetWindowShouldClose(m_window, true);
@@ -207,49 +332,243 @@ void Application::renderUI() {
   ImGui::SliderFloat("Angle", &camParams.angle, -1.57f, 1.57f);
   ImGui::Text("(Drag to orbit, Scroll to zoom)");
 
+  ImGui::SeparatorText("Performance");
+  const char *qualities[] = {"Low", "Medium", "High", "Ultra"};
+  int quality = (int)m_blackHoleRenderer.getOptions().quality;
+  if (ImGui::Combo("Quality", &quality, qualities, 4)) {
+    m_blackHoleRenderer.getOptions().quality = (SceneQuality)quality;
+  }
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Shader variant: march step budget, disk noise layers\n"
+                      "and star sampling");
+  }
+  const char *integrators[] = {"March", "Binet (RK45)"};
+  int integrator = (int)m_blackHoleRenderer.getOptions().integrator;
+  if (ImGui::Combo("Light Paths", &integrator, integrators, 2)) {
+    m_blackHoleRenderer.getOptions().integrator = (GeodesicIntegrator)integrator;
+  }
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Binet: Schwarzschild orbits with adaptive steps;\n"
+                      "ignores the deflection LUT and tile classification");
+  }
+  ImGui::Checkbox("Deflection LUT", &m_blackHoleRenderer.getOptions().deflectionLUT);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Use baked light paths instead of per-pixel ray marching");
+  }
+  ImGui::Checkbox("Tile Classification", &m_blackHoleRenderer.getOptions().tileClassification);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Ray march only screen tiles near the black hole;\n"
+                      "the rest are drawn with a stars-only shader");
+  }
+  ImGui::Checkbox("Compute Tracer", &m_blackHoleRenderer.getOptions().computeTracer);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip(ComputeTracer::isSupported()
+                          ? "March in a compute pass that compacts live rays between\n"
+                            "slices; march integrator without LUT or geodesic cache"
+                          : "Needs OpenGL 4.3 compute shaders");
+  }
+  ImGui::Checkbox("Geodesic Cache", &m_blackHoleRenderer.getOptions().geodesicCache);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Trace light paths only when the camera or geometry changes;\n"
+                      "other frames just re-shade the disk and stars");
+  }
+
+  // Changing the format rebuilds the cubemap on the next frame
+  const char *starfieldFormats[] = {"RGB16F", "RGB9_E5 + mips", "BC6H + mips"};
+  int starfieldFormat = (int)m_blackHoleRenderer.getOptions().starfieldFormat;
+  if (ImGui::Combo("Starfield", &starfieldFormat, starfieldFormats, 3)) {
+    m_blackHoleRenderer.getOptions().starfieldFormat = (StarfieldFormat)starfieldFormat;
+  }
+  RenderOptions &options = m_blackHoleRenderer.getOptions();
+  if (ImGui::Checkbox("Dynamic Resolution", &m_dynamicResolution)) {
+    if (m_dynamicResolution)
+      m_resolutionController.reset(options.resolutionScale);
+    else
+      options.resolutionScale = 1.0f;
+  }
+  if (m_dynamicResolution) {
+    float budget = m_resolutionController.getBudget();
+    if (ImGui::SliderFloat("GPU Budget (ms)", &budget, 4.0f, 50.0f, "%.1f")) {
+      m_resolutionController.setBudget(budget);
+    }
+  } else {
+    ImGui::SliderFloat("Resolution Scale", &options.resolutionScale, 0.25f,
+                       1.0f, "%.2f");
+  }
+  ImGui::Text("Ray march: %.0f%% (%dx%d)", options.resolutionScale * 100.0f,
+              (int)(m_width * options.resolutionScale),
+              (int)(m_height * options.resolutionScale));
+
+  ImGui::Text("Starfield memory: %.1f MB",
+              m_blackHoleRenderer.getStarfieldCubemap().getMemoryBytes() / (1024.0 * 1024.0));
+  if (m_blackHoleRenderer.usedComputeTracer()) {
+    ImGui::Text("Scene: compute tracer");
+  } else if (m_blackHoleRenderer.getOptions().tileClassification &&
+             m_blackHoleRenderer.getOptions().integrator == GeodesicIntegrator::March) {
+    ImGui::Text("March tiles: %.0f%% of screen",
+                m_blackHoleRenderer.getTileClassifier().getMarchFraction() * 100.0f);
+  }
+  if (m_blackHoleRenderer.getOptions().geodesicCache) {
+    ImGui::Text("Geodesic cache: %.1f MB",
+                m_blackHoleRenderer.getGeodesicCache().getMemoryBytes() / (1024.0 * 1024.0));
+  }
+
   ImGui::SeparatorText("Bloom");
   ImGui::Checkbox("Enable Bloom", &m_bloomParams.enabled);
   ImGui::SliderFloat("Threshold", &m_bloomParams.threshold, 0.0f, 2.0f);
   ImGui::SliderFloat("Intensity", &m_bloomParams.intensity, 0.0f, 3.0f);
   ImGui::SliderFloat("Strength", &m_bloomParams.strength, 0.0f, 2.0f);
+  ImGui::SliderFloat("Bloom Radius", &m_bloomParams.radius, 0.25f, 4.0f);
   ImGui::SliderFloat("Exposure", &m_bloomParams.exposure, 0.5f, 3.0f);
 
   ImGui::Separator();
-  ImGui::Checkbox("Show FPS", &m_showFPS);
-  if (m_showFPS) {
-    ImGui::Text("FPS: %.1f (%.2f ms)", m_fps, m_frameTime * 1000.0f);
+  renderFramePacingUI();
+  ImGui::Checkbox("GPU Profiler", &m_showProfiler);
+  if (m_showProfiler) {
+    renderProfilerUI();
+  }
+  if (ImGui::Checkbox("Shared Memory Output", &m_sharedOutputEnabled)) {
+    if (m_sharedOutputEnabled)
+      m_sceneValid = false;
+    else
+      m_sharedOutput.close();
+  }
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Publish each new frame (HDR scene and tone-mapped\n"
+                      "output, without the UI) to shared memory %s",
+                      SHARED_OUTPUT_NAME);
   }
 
   ImGui::Separator();
   if (ImGui::Button("Export Image (1920x1080)", ImVec2(-1, 40))) {
-    Shader compositeShader("assets/shaders/vertex.glsl",
-                           "assets/shaders/bloom_composite.glsl");
-    m_screenshotExporter.capture(1920, 1080, *m_blackHoleRenderer.getShader(),
-                                 compositeShader, params, camParams, m_blackHoleRenderer.getDiskPhase(),
-                                 m_bloomParams.exposure);
+    m_screenshotExporter.capture(1920, 1080, m_blackHoleRenderer, m_sceneTime,
+                                 m_bloomParams);
     glViewport(0, 0, m_width, m_height);
   }
   if (ImGui::Button("Export Image (4K)", ImVec2(-1, 40))) {
-    Shader compositeShader("assets/shaders/vertex.glsl",
-                           "assets/shaders/bloom_composite.glsl");
-    m_screenshotExporter.capture(3840, 2160, *m_blackHoleRenderer.getShader(),
-                                 compositeShader, params, camParams, m_blackHoleRenderer.getDiskPhase(),
-                                 m_bloomParams.exposure);
+    m_screenshotExporter.capture(3840, 2160, m_blackHoleRenderer, m_sceneTime,
+                                 m_bloomParams);
+    glViewport(0, 0, m_width, m_height);
+  }
+  if (ImGui::Button("Export Poster (16K, tiled)", ImVec2(-1, 40))) {
+    m_screenshotExporter.captureTiled(15360, 8640, 1024, m_blackHoleRenderer,
+                                      m_sceneTime, m_bloomParams);
     glViewport(0, 0, m_width, m_height);
   }
 
   ImGui::End();
 }
 
+// The controller is fed the GPU time of the newest frame the profiler has
+// collected (two frames old), once per collected frame. A still scene keeps
+// its scale: its frames mostly just recomposite and would read as cheap.
+void Application::updateResolutionScale() {
+  if (!m_dynamicResolution || !isAnimating())
+    return;
+  uint64_t frame = m_gpuProfiler.getLastFrame();
+  if (frame == 0 || frame == m_lastControlledFrame)
+    return;
+  m_lastControlledFrame = frame;
+  m_blackHoleRenderer.getOptions().resolutionScale =
+      m_resolutionController.update(m_gpuProfiler.getLastFrameMs());
+}
+
+void Application::renderFramePacingUI() {
+  const char *pacings[] = {"VSync", "Fixed Rate", "Uncapped"};
+  int pacing = (int)m_framePacer.getPacing();
+  if (ImGui::Combo("Frame Pacing", &pacing, pacings, 3)) {
+    m_framePacer.setPacing((FramePacing)pacing);
+    m_framePacer.reset();
+  }
+  if (m_framePacer.getPacing() == FramePacing::FixedRate) {
+    float fps = m_framePacer.getTargetFps();
+    if (ImGui::SliderFloat("Target FPS", &fps, 5.0f, 240.0f, "%.0f")) {
+      m_framePacer.setTargetFps(fps);
+    }
+  }
+  ImGui::Checkbox("Render On Demand", &m_renderOnDemand);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Draw only on input or when something changes; at disk\n"
+                      "speed 0 the scene clock stops and the app sleeps");
+  }
+
+  // Rolling frame intervals; idle periods are not counted
+  ImGui::Checkbox("Show FPS", &m_showFPS);
+  if (m_showFPS) {
+    FramePacer::Stats stats = m_framePacer.getStats();
+    std::vector<float> samples;
+    m_framePacer.getHistory(samples);
+    ImGui::Text("FPS: %.1f (avg %.2f ms, p99 %.2f ms)",
+                stats.avgMs > 0.0f ? 1000.0f / stats.avgMs : 0.0f,
+                stats.avgMs, stats.p99Ms);
+    ImGui::PlotHistogram("##frames", samples.data(), (int)samples.size(), 0,
+                         nullptr, 0.0f, stats.p99Ms * 1.25f + 1e-3f,
+                         ImVec2(280, 36));
+  }
+}
+
+void Application::renderProfilerUI() {
+  // Rolling GPU time per pass; the histogram is scaled to the window's p99
+  std::vector<float> samples;
+  float totalAvg = 0.0f;
+  for (int i = 0; i < m_gpuProfiler.getPassCount(); i++) {
+    GpuProfiler::Stats stats = m_gpuProfiler.getStats(i);
+    m_gpuProfiler.getHistory(i, samples);
+    totalAvg += stats.avgMs;
+
+    char overlay[96];
+    snprintf(overlay, sizeof(overlay), "min %.2f  avg %.2f  p99 %.2f ms",
+             stats.minMs, stats.avgMs, stats.p99Ms);
+    ImGui::Text("%s", m_gpuProfiler.getPassName(i).c_str());
+    ImGui::PushID(i);
+    ImGui::PlotHistogram("##history", samples.data(), (int)samples.size(), 0,
+                         overlay, 0.0f, stats.p99Ms * 1.25f + 1e-3f,
+                         ImVec2(280, 36));
+    ImGui::PopID();
+  }
+  ImGui::Text("GPU total: %.2f ms avg", totalAvg);
+
+  if (ImGui::Button("Export Profile CSV")) {
+    m_gpuProfiler.writeCSV("blackhole_gpu_profile.csv");
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Reset")) {
+    m_gpuProfiler.reset();
+  }
+}
+
+// Queue the frame renderScene() just drew, before the UI goes on top. The
+// ring is recreated when the window size changes.
+void Application::publishSharedFrame() {
+  if (!m_sharedOutput.isOpen() || m_sharedOutput.getWidth() != m_width ||
+      m_sharedOutput.getHeight() != m_height) {
+    if (!m_sharedOutput.open(SHARED_OUTPUT_NAME, m_width, m_height,
+                             SHARED_FRAME_HDR | SHARED_FRAME_LDR)) {
+      m_sharedOutputEnabled = false;
+      return;
+    }
+  }
+
+  SharedFrameSlot info = {};
+  info.frameIndex = m_sharedFrameIndex++;
+  info.paramsHash = hashFrameParams(m_blackHoleRenderer.getParams(),
+                                    m_blackHoleRenderer.getCameraParams(),
+                                    m_bloomParams);
+  info.timestampNs = (uint64_t)std::chrono::duration_cast<
+                         std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+  info.time = m_sceneTime;
+  info.diskPhase = m_blackHoleRenderer.getDiskPhase();
+  m_sharedOutput.capture(m_bloomRenderer.getSceneTexture(), 0, info);
+}
+
 void Application::renderScene() {
   // Render scene to bloom FBO
-  glBindFramebuffer(GL_FRAMEBUFFER, m_bloomRenderer.getSceneFBO());
-  glViewport(0, 0, m_width, m_height);
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
+  m_bloomRenderer.beginScene(m_bloomParams);
 
   // Render the black hole
-  m_blackHoleRenderer.render((float)glfwGetTime(), m_width, m_height);
+  m_blackHoleRenderer.render(m_sceneTime, m_width, m_height);
 
   // Apply post-processing
   unsigned int quadVAO = m_blackHoleRenderer.getQuadVAO();
@@ -7,7 +7,11 @@
 #include <glm/glm.hpp>
 
 #include "BloomRenderer.h"
+#include "FramePacer.h"
+#include "GpuProfiler.h"
+#include "ResolutionController.h"
 #include "ScreenshotExporter.h"
+#include "SharedFrameOutput.h"
 #include "BlackHoleRenderer.h" // Includes Shader.h, NoiseTexture.h, StarfieldCubemap.h
 
 class Application {
@@ -24,10 +28,35 @@ private:
   static void scrollCallback(GLFWwindow *window, double xoffset, double yoffset);
   static void cursorPosCallback(GLFWwindow *window, double xpos, double ypos);
   static void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
+  static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+  static void charCallback(GLFWwindow *window, unsigned int codepoint);
+  static void windowRefreshCallback(GLFWwindow *window);
+
+  // Everything the scene image depends on; a frame whose state equals the
+  // last rendered one only recomposites it under the UI
+  struct SceneState {
+    BlackHoleParams params;
+    CameraParams camera;
+    RenderOptions options;
+    BloomParams bloom;
+    int width = 0;
+    int height = 0;
+    float time = 0.0f;
+
+    bool operator==(const SceneState &other) const;
+    bool operator!=(const SceneState &other) const { return !(*this == other); }
+  };
 
   void processInput();
   void renderUI();
   void renderScene();
+  void publishSharedFrame();
+  void renderFramePacingUI();
+  bool isAnimating() const;
+  void requestFrames(int count);
+  SceneState getSceneState() const;
+  void renderProfilerUI();
+  void updateResolutionScale();
 
   GLFWwindow *m_window = nullptr;
   int m_width = 1280;
@@ -37,16 +66,36 @@ private:
   BlackHoleRenderer m_blackHoleRenderer;
   BloomRenderer m_bloomRenderer;
   ScreenshotExporter m_screenshotExporter;
+  GpuProfiler m_gpuProfiler;
+
+  // Dynamic resolution: scales the ray march to hold a GPU frame budget
+  ResolutionController m_resolutionController;
+  bool m_dynamicResolution = false;
+  uint64_t m_lastControlledFrame = 0;
 
   // Parameters
   BloomParams m_bloomParams;
 
-  // Timing
-  float m_fps = 0.0f;
-  float m_frameTime = 0.0f;
-  float m_lastFrameTime = 0.0f;
+  // Timing. The scene clock (u_Time) stops while render-on-demand is on
+  // and the disk doesn't spin, so a still scene stays still.
+  FramePacer m_framePacer;
+  int m_swapInterval = 1;
+  float m_sceneTime = 0.0f;
   bool m_showFPS = false;
 
+  // Render on demand: with nothing animating, the loop blocks until input
+  // and only draws the frames it asks for
+  bool m_renderOnDemand = true;
+  int m_pendingFrames = 1;
+  SceneState m_lastScene;
+  bool m_sceneValid = false;
+  bool m_showProfiler = false;
+
+  // Rendered frames also go to a shared-memory ring for other processes
+  SharedFrameOutput m_sharedOutput;
+  bool m_sharedOutputEnabled = false;
+  uint64_t m_sharedFrameIndex = 0;
+
   // Mouse camera control
   bool m_isDragging = false;
   double m_lastMouseX = 0.0;
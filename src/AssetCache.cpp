@@ -0,0 +1,228 @@
+#include "AssetCache.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char ASSET_CACHE_MAGIC[8] = {'B', 'H', 'C', 'A', 'C', 'H', 'E', 0};
+
+AssetCacheHeader makeAssetCacheHeader() {
+  AssetCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ASSET_CACHE_MAGIC, sizeof(header.magic));
+  header.version = ASSET_CACHE_VERSION;
+  header.headerSize = sizeof(AssetCacheHeader);
+  return header;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+uint64_t hashFile(const std::string &path, uint64_t seed) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file)
+    return seed;
+
+  uint64_t hash = seed;
+  char buffer[16384];
+  size_t n;
+  while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    hash = hashBytes(buffer, n, hash);
+  }
+  std::fclose(file);
+  return hash;
+}
+
+#if !defined(_WIN32)
+
+static std::string cacheDirectory() {
+  if (const char *dir = std::getenv("BLACKHOLE_CACHE_DIR"))
+    return dir;
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"))
+    if (*xdg)
+      return std::string(xdg) + "/blackhole";
+  if (const char *home = std::getenv("HOME"))
+    if (*home)
+      return std::string(home) + "/.cache/blackhole";
+  return "";
+}
+
+// mkdir -p
+static bool makeDirectories(const std::string &path) {
+  for (size_t pos = 1; pos <= path.size(); pos++) {
+    if (pos != path.size() && path[pos] != '/')
+      continue;
+    std::string prefix = path.substr(0, pos);
+    if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+      return false;
+  }
+  return true;
+}
+
+std::string assetCachePath(const std::string &name) {
+  std::string dir = cacheDirectory();
+  if (dir.empty())
+    return "";
+  return dir + "/" + name;
+}
+
+MappedAssetCache::~MappedAssetCache() { close(); }
+
+bool MappedAssetCache::open(const std::string &path,
+                            const AssetCacheHeader &expected) {
+  close();
+  if (path.empty())
+    return false;
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AssetCacheHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  size_t size = (size_t)st.st_size;
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  // Header must match field for field, except for the payload size which
+  // must match the file instead
+  AssetCacheHeader header;
+  memcpy(&header, mapping, sizeof(header));
+  AssetCacheHeader want = expected;
+  want.payloadSize = header.payloadSize;
+  if (memcmp(&header, &want, sizeof(header)) != 0 ||
+      header.payloadSize != size - sizeof(AssetCacheHeader) ||
+      (expected.payloadSize != 0 &&
+       header.payloadSize != expected.payloadSize)) {
+    munmap(mapping, size);
+    return false;
+  }
+
+  // The payload is read once, front to back, by the upload
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  m_mapping = mapping;
+  m_mappingSize = size;
+  m_payload = static_cast<const char *>(mapping) + sizeof(AssetCacheHeader);
+  m_payloadSize = header.payloadSize;
+  return true;
+}
+
+void MappedAssetCache::close() {
+  if (m_mapping)
+    munmap(m_mapping, m_mappingSize);
+  m_mapping = nullptr;
+  m_mappingSize = 0;
+  m_payload = nullptr;
+  m_payloadSize = 0;
+}
+
+AssetCacheWriter::~AssetCacheWriter() { abort(); }
+
+bool AssetCacheWriter::begin(const std::string &path,
+                             const AssetCacheHeader &header) {
+  abort();
+  if (path.empty())
+    return false;
+
+  size_t slash = path.rfind('/');
+  if (slash != std::string::npos && !makeDirectories(path.substr(0, slash))) {
+    std::cerr << "Asset cache: cannot create directory for " << path
+              << std::endl;
+    return false;
+  }
+
+  m_path = path;
+  m_tempPath = path + ".tmp." + std::to_string((long)getpid());
+  m_file = std::fopen(m_tempPath.c_str(), "wb");
+  if (!m_file) {
+    std::cerr << "Asset cache: cannot write " << m_tempPath << std::endl;
+    return false;
+  }
+
+  m_expectedSize = header.payloadSize;
+  m_written = 0;
+  if (std::fwrite(&header, sizeof(header), 1, m_file) != 1) {
+    abort();
+    return false;
+  }
+  return true;
+}
+
+bool AssetCacheWriter::write(const void *data, size_t size) {
+  if (!m_file)
+    return false;
+  if (std::fwrite(data, 1, size, m_file) != size) {
+    std::cerr << "Asset cache: write failed for " << m_tempPath << std::endl;
+    abort();
+    return false;
+  }
+  m_written += size;
+  return true;
+}
+
+bool AssetCacheWriter::commit() {
+  if (!m_file)
+    return false;
+
+  bool ok = m_written == m_expectedSize;
+  ok = std::fclose(m_file) == 0 && ok;
+  m_file = nullptr;
+  if (ok && std::rename(m_tempPath.c_str(), m_path.c_str()) == 0)
+    return true;
+
+  std::cerr << "Asset cache: failed to store " << m_path << std::endl;
+  std::remove(m_tempPath.c_str());
+  return false;
+}
+
+void AssetCacheWriter::abort() {
+  if (!m_file)
+    return;
+  std::fclose(m_file);
+  m_file = nullptr;
+  std::remove(m_tempPath.c_str());
+}
+
+#else
+
+// No mmap on Windows; the cache is simply disabled there
+
+std::string assetCachePath(const std::string &) { return ""; }
+
+MappedAssetCache::~MappedAssetCache() {}
+bool MappedAssetCache::open(const std::string &, const AssetCacheHeader &) {
+  return false;
+}
+void MappedAssetCache::close() {}
+
+AssetCacheWriter::~AssetCacheWriter() {}
+bool AssetCacheWriter::begin(const std::string &, const AssetCacheHeader &) {
+  return false;
+}
+bool AssetCacheWriter::write(const void *, size_t) { return false; }
+bool AssetCacheWriter::commit() { return false; }
+void AssetCacheWriter::abort() {}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// On-disk cache for baked textures (noise volume, starfield faces).
+//
+// A cache file is a fixed-size header followed by the raw texel payload in
+// the exact layout glTexImage* expects, so a warm start maps the file and
+// hands the pointer straight to the driver. Any header mismatch (version,
+// generator parameters, texel format, source hash) is treated as a miss and
+// the caller regenerates and rewrites the file.
+//
+// The directory is $BLACKHOLE_CACHE_DIR, else $XDG_CACHE_HOME/blackhole,
+// else ~/.cache/blackhole. Setting BLACKHOLE_CACHE_DIR to an empty string
+// disables the cache.
+
+static const uint32_t ASSET_CACHE_VERSION = 1;
+
+struct AssetCacheHeader {
+  char magic[8];          // "BHCACHE\0"
+  uint32_t version;       // ASSET_CACHE_VERSION
+  uint32_t headerSize;    // sizeof(AssetCacheHeader)
+  uint32_t internalFormat; // GL internal format, e.g. GL_RGBA16F
+  uint32_t format;        // GL pixel format of the payload
+  uint32_t type;          // GL pixel type of the payload
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;         // Volume depth or number of cube faces
+  uint32_t levels;        // Mip levels stored back to back
+  uint32_t reserved;
+  float params[4];        // Generator parameters, asset specific
+  uint64_t sourceHash;    // Hash of whatever produced the texels
+  uint64_t payloadSize;   // Bytes following the header
+};
+static_assert(sizeof(AssetCacheHeader) == 80,
+              "AssetCacheHeader must not contain padding");
+
+// Fill in magic/version/headerSize; everything else is zeroed
+AssetCacheHeader makeAssetCacheHeader();
+
+// 64-bit FNV-1a, chainable through 'seed'
+uint64_t hashBytes(const void *data, size_t size,
+                   uint64_t seed = 0xcbf29ce484222325ull);
+
+// Hash a file's contents. Returns 'seed' unchanged if it can't be read.
+uint64_t hashFile(const std::string &path,
+                  uint64_t seed = 0xcbf29ce484222325ull);
+
+// Full path for a cache entry, or empty if caching is disabled
+std::string assetCachePath(const std::string &name);
+
+// Read-only memory mapping of a cache file whose header matches 'expected'
+class MappedAssetCache {
+public:
+  MappedAssetCache() = default;
+  ~MappedAssetCache();
+
+  MappedAssetCache(const MappedAssetCache &) = delete;
+  MappedAssetCache &operator=(const MappedAssetCache &) = delete;
+
+  // Returns false (and stays closed) on a missing, short or mismatched file
+  bool open(const std::string &path, const AssetCacheHeader &expected);
+  void close();
+
+  const void *getPayload() const { return m_payload; }
+  uint64_t getPayloadSize() const { return m_payloadSize; }
+
+private:
+  void *m_mapping = nullptr;
+  size_t m_mappingSize = 0;
+  const void *m_payload = nullptr;
+  uint64_t m_payloadSize = 0;
+};
+
+// Streams a cache file to a temporary name and renames it into place on
+// commit, so concurrent readers never see a half-written entry.
+class AssetCacheWriter {
+public:
+  AssetCacheWriter() = default;
+  ~AssetCacheWriter();
+
+  AssetCacheWriter(const AssetCacheWriter &) = delete;
+  AssetCacheWriter &operator=(const AssetCacheWriter &) = delete;
+
+  bool begin(const std::string &path, const AssetCacheHeader &header);
+  bool write(const void *data, size_t size);
+  bool commit();
+  void abort();
+
+  bool isOpen() const { return m_file != nullptr; }
+
+private:
+  std::FILE *m_file = nullptr;
+  std::string m_path;
+  std::string m_tempPath;
+  uint64_t m_expectedSize = 0;
+  uint64_t m_written = 0;
+};
+
+#endif // ASSET_CACHE_H
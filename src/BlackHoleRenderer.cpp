@@ -1,8 +1,69 @@
 #include "BlackHoleRenderer.h"
+#include "GpuProfiler.h"
+#include "ShaderCache.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 
+const char* geodesicIntegratorName(GeodesicIntegrator integrator) {
+    return integrator == GeodesicIntegrator::Binet ? "binet" : "march";
+}
+
+bool parseGeodesicIntegrator(const std::string& name, GeodesicIntegrator& integrator) {
+    for (GeodesicIntegrator i : {GeodesicIntegrator::March, GeodesicIntegrator::Binet}) {
+        if (name == geodesicIntegratorName(i)) {
+            integrator = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* sceneQualityName(SceneQuality quality) {
+    switch (quality) {
+    case SceneQuality::Low:
+        return "low";
+    case SceneQuality::Medium:
+        return "medium";
+    case SceneQuality::Ultra:
+        return "ultra";
+    default:
+        return "high";
+    }
+}
+
+bool parseSceneQuality(const std::string& name, SceneQuality& quality) {
+    for (SceneQuality q : {SceneQuality::Low, SceneQuality::Medium, SceneQuality::High,
+                           SceneQuality::Ultra}) {
+        if (name == sceneQualityName(q)) {
+            quality = q;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BlackHoleParams::operator==(const BlackHoleParams& other) const {
+    return radius == other.radius && diskInnerRadius == other.diskInnerRadius &&
+           diskOuterRadius == other.diskOuterRadius && diskThickness == other.diskThickness &&
+           diskColor1 == other.diskColor1 && diskColor2 == other.diskColor2 &&
+           glowIntensity == other.glowIntensity && diskSpeed == other.diskSpeed;
+}
+
+bool CameraParams::operator==(const CameraParams& other) const {
+    return distance == other.distance && angle == other.angle;
+}
+
+bool RenderOptions::operator==(const RenderOptions& other) const {
+    return quality == other.quality && integrator == other.integrator &&
+           deflectionLUT == other.deflectionLUT && starfieldFormat == other.starfieldFormat &&
+           resolutionScale == other.resolutionScale && geodesicCache == other.geodesicCache &&
+           tileClassification == other.tileClassification &&
+           computeTracer == other.computeTracer;
+}
+
 BlackHoleRenderer::BlackHoleRenderer() {}
 
 BlackHoleRenderer::~BlackHoleRenderer() {
@@ -12,17 +73,32 @@ BlackHoleRenderer::~BlackHoleRenderer() {
 void BlackHoleRenderer::init(int width, int height) {
     if (m_initialized) return;
 
+    auto elapsedMs = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - since).count();
+    };
+
     // Load shaders
-    m_shader = new Shader("assets/shaders/vertex.glsl", "assets/shaders/fragment.glsl");
+    auto start = std::chrono::steady_clock::now();
+    updateShaders();
+    m_startupTimings.shaderMs = elapsedMs(start);
 
     // Initialize quad for rendering
     initQuad();
+    m_upscaler.init();
+    m_tileClassifier.init();
+    m_blackHoleBlock.init(BLACK_HOLE_BLOCK_BINDING, sizeof(BlackHoleBlock));
+    m_cameraBlock.init(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
 
     // Generate 3D noise texture (128^3 RGBA)
+    start = std::chrono::steady_clock::now();
     m_noiseTexture.generate(128);
+    m_startupTimings.noiseMs = elapsedMs(start);
 
     // Generate starfield cubemap (2048x2048 per face)
-    m_starfieldCubemap.init(2048);
+    start = std::chrono::steady_clock::now();
+    m_starfieldCubemap.init(2048, m_options.starfieldFormat);
+    m_startupTimings.starfieldMs = elapsedMs(start);
 
     m_initialized = true;
 }
@@ -56,29 +132,171 @@ void BlackHoleRenderer::update(float deltaTime) {
     m_diskPhase += deltaTime * m_params.diskSpeed;
 }
 
+bool BlackHoleRenderer::updateAssets() {
+    if (!m_initialized) return false;
+    return m_starfieldCubemap.setFormat(m_options.starfieldFormat);
+}
+
 void BlackHoleRenderer::render(float time, int width, int height) {
     if (!m_initialized) return;
 
-    m_shader->use();
-    m_shader->setVec2("u_Resolution", glm::vec2(width, height));
-    m_shader->setFloat("u_Time", time);
-    m_shader->setFloat("u_BlackHoleRadius", m_params.radius);
-    m_shader->setFloat("u_DiskInnerRadius", m_params.diskInnerRadius);
-    m_shader->setFloat("u_DiskOuterRadius", m_params.diskOuterRadius);
-    m_shader->setFloat("u_DiskThickness", m_params.diskThickness);
-    m_shader->setVec3("u_DiskColor1", m_params.diskColor1);
-    m_shader->setVec3("u_DiskColor2", m_params.diskColor2);
-    m_shader->setFloat("u_GlowIntensity", m_params.glowIntensity);
-    m_shader->setFloat("u_DiskPhase", m_diskPhase);
-    m_shader->setFloat("u_CameraDistance", m_cameraParams.distance);
-    m_shader->setFloat("u_CameraAngle", m_cameraParams.angle);
+    updateAssets();
+    updateShaders();
+    updateUniformBlocks();
+
+    // Reduced-resolution march; the full-size output is restored by the
+    // upscale below
+    float scale = glm::clamp(m_options.resolutionScale, 0.25f, 1.0f);
+    bool scaled = scale < 1.0f;
+    if (scaled) {
+        glm::ivec2 size = m_upscaler.begin(width, height, scale);
+        width = size.x;
+        height = size.y;
+    }
+
+    m_usedComputeTracer = useComputeTracer() && m_computeTracer.begin();
+    if (!m_usedComputeTracer && useTileClassification()) {
+        // Same bound as missesBounds() in scene_common.glsl
+        float boundRadius = std::max(m_params.diskOuterRadius * 1.5f, m_params.radius * 15.0f);
+        m_tileClassifier.update(glm::vec2(width, height), m_tileOffset, m_cameraParams.distance,
+                                m_cameraParams.angle, boundRadius);
+    }
+
+    if (m_usedComputeTracer) {
+        GpuProfileScope scope(m_profiler, "scene");
+        setSceneUniforms(*m_computeTracer.getShader(), time, width, height);
+        m_computeTracer.dispatch();
+    } else if (m_options.geodesicCache) {
+        GeodesicKey key;
+        key.resolution = glm::vec2(width, height);
+        key.tileOffset = m_tileOffset;
+        key.cameraDistance = m_cameraParams.distance;
+        key.cameraAngle = m_cameraParams.angle;
+        key.radius = m_params.radius;
+        key.diskInnerRadius = m_params.diskInnerRadius;
+        key.diskOuterRadius = m_params.diskOuterRadius;
+        key.diskThickness = m_params.diskThickness;
+        key.deflectionLUT = useDeflectionLUT();
+        key.integrator = (int)m_options.integrator;
+        key.quality = (int)m_options.quality;
+
+        // Background texels of the G-buffer are never read
+        if (m_geodesicCache.beginTrace(key)) {
+            GpuProfileScope scope(m_profiler, "geodesics");
+            drawScene(*m_geodesicCache.getTraceShader(), false, time, width, height);
+            m_geodesicCache.endTrace();
+        }
+
+        GpuProfileScope scope(m_profiler, "scene");
+        m_geodesicCache.bind();
+        drawScene(*m_geodesicCache.getShadeShader(), true, time, width, height);
+    } else {
+        GpuProfileScope scope(m_profiler, "scene");
+        drawScene(*m_shader, true, time, width, height);
+    }
+
+    if (scaled) {
+        GpuProfileScope scope(m_profiler, "upscale");
+        m_upscaler.end(m_quadVAO);
+    }
+}
+
+// Scene shader variants for the quality tier. Switching back to a tier
+// used before is a registry lookup or a program binary load.
+void BlackHoleRenderer::updateShaders() {
+    if (m_shader && m_shaderQuality == m_options.quality) return;
+
+    m_shaderQuality = m_options.quality;
+    ShaderDefines defines = {"QUALITY_TIER " + std::to_string((int)m_shaderQuality)};
+    m_shader = ShaderCache::get("assets/shaders/vertex.glsl", "assets/shaders/fragment.glsl",
+                                defines);
+    m_backgroundShader = ShaderCache::get("assets/shaders/vertex.glsl",
+                                          "assets/shaders/background.glsl", defines);
+    m_geodesicCache.init(defines);
+    m_computeTracer.init(defines);
+}
+
+// Parameter blocks of uniform_blocks.glsl; uploaded only when they change
+void BlackHoleRenderer::updateUniformBlocks() {
+    BlackHoleBlock blackHole = {};
+    blackHole.radius = m_params.radius;
+    blackHole.diskInnerRadius = m_params.diskInnerRadius;
+    blackHole.diskOuterRadius = m_params.diskOuterRadius;
+    blackHole.diskThickness = m_params.diskThickness;
+    blackHole.diskColor1 = m_params.diskColor1;
+    blackHole.glowIntensity = m_params.glowIntensity;
+    blackHole.diskColor2 = m_params.diskColor2;
+    m_blackHoleBlock.update(blackHole);
+
+    CameraBlock camera = {};
+    camera.distance = m_cameraParams.distance;
+    camera.angle = m_cameraParams.angle;
+    m_cameraBlock.update(camera);
+}
+
+// Per-frame uniforms and textures of the scene shaders (scene_common.glsl)
+void BlackHoleRenderer::setSceneUniforms(Shader& shader, float time, int width, int height) {
+    shader.use();
+    shader.setVec2("u_Resolution", glm::vec2(width, height));
+    shader.setVec2("u_TileOffset", m_tileOffset);
+    shader.setFloat("u_Time", time);
+    shader.setFloat("u_DiskPhase", m_diskPhase);
+    shader.setInt("u_Integrator", (int)m_options.integrator);
 
     m_noiseTexture.bind(2);
-    m_shader->setInt("u_NoiseTexture", 2);
+    shader.setInt("u_NoiseTexture", 2);
 
     m_starfieldCubemap.bind(3);
-    m_shader->setInt("u_StarfieldCubemap", 3);
+    shader.setInt("u_StarfieldCubemap", 3);
+
+    // Baked light paths, rebuilt only when the horizon radius changes.
+    // Sampler units are set even when unused: samplers of different types
+    // left on the same unit make the draw invalid.
+    shader.setBool("u_UseDeflectionLUT", useDeflectionLUT());
+    shader.setInt("u_DeflectionExit", 4);
+    shader.setInt("u_DeflectionOrbit", 5);
+    if (useDeflectionLUT()) {
+        m_deflectionLUT.update(m_params.radius);
+        m_deflectionLUT.bind(4, 5);
+        shader.setVec4("u_DeflectionRange",
+                       glm::vec4(DeflectionLUT::kMaxAlpha, DeflectionLUT::kMinDistance,
+                                 DeflectionLUT::kMaxDistance, DeflectionLUT::kMaxPhi));
+    }
+}
 
+// Full-screen 'shader', or with tile classification only its tiles that
+// need the march, plus the stars-only shader elsewhere if 'background'
+void BlackHoleRenderer::drawScene(Shader& shader, bool background, float time, int width,
+                                  int height) {
+    setSceneUniforms(shader, time, width, height);
+    if (!useTileClassification()) {
+        drawQuad();
+        return;
+    }
+
+    m_tileClassifier.drawMarchTiles();
+    if (background) {
+        setSceneUniforms(*m_backgroundShader, time, width, height);
+        m_tileClassifier.drawBackgroundTiles();
+    }
+}
+
+// Only the march is sliced (marchStep() in scene_common.glsl)
+bool BlackHoleRenderer::useComputeTracer() const {
+    return m_options.computeTracer && m_options.integrator == GeodesicIntegrator::March &&
+           !useDeflectionLUT() && !m_options.geodesicCache && ComputeTracer::isSupported();
+}
+
+bool BlackHoleRenderer::useDeflectionLUT() const {
+    return m_options.deflectionLUT && m_options.integrator == GeodesicIntegrator::March;
+}
+
+// Binet rays are integrated everywhere (missesBounds() in scene_common.glsl)
+bool BlackHoleRenderer::useTileClassification() const {
+    return m_options.tileClassification && m_options.integrator == GeodesicIntegrator::March;
+}
+
+void BlackHoleRenderer::drawQuad() {
     glBindVertexArray(m_quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
@@ -87,10 +305,15 @@ void BlackHoleRenderer::render(float time, int width, int height) {
 void BlackHoleRenderer::shutdown() {
     if (!m_initialized) return;
 
-    if (m_shader) {
-        delete m_shader;
-        m_shader = nullptr;
-    }
+    m_shader.reset();
+    m_backgroundShader.reset();
+
+    m_upscaler.shutdown();
+    m_geodesicCache.shutdown();
+    m_tileClassifier.shutdown();
+    m_computeTracer.shutdown();
+    m_blackHoleBlock.shutdown();
+    m_cameraBlock.shutdown();
 
     if (m_quadVAO) {
         glDeleteVertexArrays(1, &m_quadVAO);
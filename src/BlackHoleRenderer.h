@@ -2,9 +2,19 @@
 #define BLACK_HOLE_RENDERER_H
 
 #include <glm/glm.hpp>
+#include <memory>
+#include <string>
 #include "Shader.h"
 #include "NoiseTexture.h"
 #include "StarfieldCubemap.h"
+#include "DeflectionLUT.h"
+#include "SceneUpscaler.h"
+#include "GeodesicCache.h"
+#include "TileClassifier.h"
+#include "ComputeTracer.h"
+#include "UniformBuffer.h"
+
+class GpuProfiler;
 
 struct BlackHoleParams {
     float radius = 0.5f;
@@ -15,11 +25,76 @@ struct BlackHoleParams {
     glm::vec3 diskColor2 = glm::vec3(0.8f, 0.2f, 0.05f);
     float glowIntensity = 1.0f;
     float diskSpeed = 0.5f;
+
+    bool operator==(const BlackHoleParams& other) const;
+    bool operator!=(const BlackHoleParams& other) const { return !(*this == other); }
 };
 
 struct CameraParams {
     float distance = 10.0f;
     float angle = 0.5f;
+
+    bool operator==(const CameraParams& other) const;
+    bool operator!=(const CameraParams& other) const { return !(*this == other); }
+};
+
+// How each pixel's light path is found (scene_common.glsl)
+enum class GeodesicIntegrator {
+    March, // Fixed-rule 3D march with an approximate bending term
+    Binet  // Schwarzschild orbit equation, adaptive RK45 in the orbit plane
+};
+
+// "march", "binet"
+const char* geodesicIntegratorName(GeodesicIntegrator integrator);
+bool parseGeodesicIntegrator(const std::string& name, GeodesicIntegrator& integrator);
+
+// Compile-time variants of the scene shaders (QUALITY_TIER in
+// scene_common.glsl)
+enum class SceneQuality {
+    Low,    // Coarse march, one disk noise layer, blurrier stars
+    Medium, // Fewer march steps, two noise layers
+    High,   // Reference
+    Ultra   // Fine march, tighter RK45 tolerance, supersampled stars
+};
+
+// "low", "medium", "high", "ultra"
+const char* sceneQualityName(SceneQuality quality);
+bool parseSceneQuality(const std::string& name, SceneQuality& quality);
+
+// How the scene is rendered, as opposed to what is rendered
+struct RenderOptions {
+    SceneQuality quality = SceneQuality::High;
+    GeodesicIntegrator integrator = GeodesicIntegrator::March;
+    // Replace the per-pixel march with baked light paths (DeflectionLUT).
+    // The tables are baked from the march, so the Binet integrator ignores it.
+    bool deflectionLUT = false;
+    // Starfield texel storage; the compact formats are mipmapped and
+    // sampled at a level chosen from the lensing stretch. BC6H is opt-in:
+    // software rasterizers decode it per sample and run at half speed.
+    StarfieldFormat starfieldFormat = StarfieldFormat::SharedExponent;
+    // Ray-march resolution per axis; below 1 the scene is marched into a
+    // smaller target and upscaled (SceneUpscaler)
+    float resolutionScale = 1.0f;
+    // Trace geodesics into a G-buffer only when the camera or geometry
+    // changes, and re-shade from it otherwise (GeodesicCache)
+    bool geodesicCache = false;
+    // Run the march only on screen tiles that can reach the black hole
+    // system; the rest get the stars-only shader (TileClassifier)
+    bool tileClassification = true;
+    // Run the march as a compute pass with ray compaction (ComputeTracer)
+    // when the context supports it. Only the march integrator without the
+    // LUT or geodesic cache; tile classification is then unnecessary.
+    bool computeTracer = false;
+
+    bool operator==(const RenderOptions& other) const;
+    bool operator!=(const RenderOptions& other) const { return !(*this == other); }
+};
+
+// Wall-clock cost of init(), for benchmarks
+struct StartupTimings {
+    double shaderMs = 0.0;
+    double noiseMs = 0.0;
+    double starfieldMs = 0.0;
 };
 
 class BlackHoleRenderer {
@@ -30,28 +105,71 @@ public:
     void init(int width, int height);
     void render(float time, int width, int height);
     void update(float deltaTime);
+    // Rebuild baked assets that depend on the options. Called by render();
+    // returns true if anything was rebuilt.
+    bool updateAssets();
     void shutdown();
 
     BlackHoleParams& getParams() { return m_params; }
     CameraParams& getCameraParams() { return m_cameraParams; }
-    Shader* getShader() { return m_shader; } // For screenshot export
+    RenderOptions& getOptions() { return m_options; }
+    const BlackHoleParams& getParams() const { return m_params; }
+    const CameraParams& getCameraParams() const { return m_cameraParams; }
+    const RenderOptions& getOptions() const { return m_options; }
     float getDiskPhase() const { return m_diskPhase; }
+    void setDiskPhase(float phase) { m_diskPhase = phase; }
+    // Pixel offset of the viewport within the full image, for tiled renders.
+    // render()'s width/height are then the full image size.
+    void setTileOffset(const glm::vec2& offset) { m_tileOffset = offset; }
+    // Time the scene pass (null disables)
+    void setProfiler(GpuProfiler* profiler) { m_profiler = profiler; }
     unsigned int getQuadVAO() const { return m_quadVAO; }
+    const NoiseTexture& getNoiseTexture() const { return m_noiseTexture; }
+    const StarfieldCubemap& getStarfieldCubemap() const { return m_starfieldCubemap; }
+    const StartupTimings& getStartupTimings() const { return m_startupTimings; }
+    const GeodesicCache& getGeodesicCache() const { return m_geodesicCache; }
+    const TileClassifier& getTileClassifier() const { return m_tileClassifier; }
+    // Whether the last render() marched with the compute tracer; it falls
+    // back when off, unsupported, not applicable to the options, or when
+    // the target can't be written as an image
+    bool usedComputeTracer() const { return m_usedComputeTracer; }
 
 private:
     void initQuad();
+    void updateShaders();
+    void updateUniformBlocks();
+    void setSceneUniforms(Shader& shader, float time, int width, int height);
+    void drawScene(Shader& shader, bool background, float time, int width, int height);
+    void drawQuad();
+    bool useDeflectionLUT() const;
+    bool useTileClassification() const;
+    bool useComputeTracer() const;
 
     BlackHoleParams m_params;
     CameraParams m_cameraParams;
+    RenderOptions m_options;
 
-    Shader* m_shader = nullptr;
+    std::shared_ptr<Shader> m_shader;
+    std::shared_ptr<Shader> m_backgroundShader;
+    SceneQuality m_shaderQuality = SceneQuality::High;
     NoiseTexture m_noiseTexture;
     StarfieldCubemap m_starfieldCubemap;
+    DeflectionLUT m_deflectionLUT;
+    SceneUpscaler m_upscaler;
+    GeodesicCache m_geodesicCache;
+    TileClassifier m_tileClassifier;
+    ComputeTracer m_computeTracer;
+    UniformBuffer m_blackHoleBlock;
+    UniformBuffer m_cameraBlock;
 
     unsigned int m_quadVAO = 0;
     unsigned int m_quadVBO = 0;
 
     float m_diskPhase = 0.0f;
+    glm::vec2 m_tileOffset = glm::vec2(0.0f);
+    GpuProfiler* m_profiler = nullptr;
+    StartupTimings m_startupTimings;
+    bool m_usedComputeTracer = false;
     bool m_initialized = false;
 };
 
@@ -1,4 +1,61 @@
 #include "BloomRenderer.h"
+#include "GpuProfiler.h"
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// The bright target only holds thresholded light (no mask), so it is
+// stored at half the bandwidth of the scene
+static const GLenum BRIGHT_FORMAT = GL_R11F_G11F_B10F;
+
+static void createTexture(unsigned int &texture, GLenum format, int width,
+                          int height) {
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_FLOAT,
+               NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+static void createTarget(unsigned int &fbo, unsigned int &texture, int width,
+                         int height) {
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  createTexture(texture, GL_RGBA16F, width, height);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         texture, 0);
+}
+
+// HDR scene color plus the bright target as attachment 1
+static void createSceneTarget(unsigned int &fbo, unsigned int &texture,
+                              unsigned int &brightTexture, int width,
+                              int height) {
+  createTarget(fbo, texture, width, height);
+  createTexture(brightTexture, BRIGHT_FORMAT, width, height);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D,
+                         brightTexture, 0);
+}
+
+// Clear both targets, then leave the bright one enabled only if 'bright'
+static void clearSceneTarget(bool bright) {
+  const GLenum both[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+  const GLenum sceneOnly[2] = {GL_COLOR_ATTACHMENT0, GL_NONE};
+  glDrawBuffers(2, both);
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glDrawBuffers(2, bright ? both : sceneOnly);
+}
+
+bool BloomParams::operator==(const BloomParams &other) const {
+  return threshold == other.threshold && intensity == other.intensity &&
+         strength == other.strength && exposure == other.exposure &&
+         radius == other.radius && enabled == other.enabled;
+}
 
 BloomRenderer::BloomRenderer() {}
 
@@ -9,57 +66,27 @@ void BloomRenderer::init(int width, int height) {
   m_height = height;
 
   // Load shaders
-  m_extractShader = new Shader("assets/shaders/vertex.glsl",
-                               "assets/shaders/bloom_extract.glsl");
-  m_blurShader = new Shader("assets/shaders/vertex.glsl",
-                            "assets/shaders/bloom_blur.glsl");
-  m_kawaseShader = new Shader("assets/shaders/vertex.glsl",
-                              "assets/shaders/bloom_kawase.glsl");
-  m_compositeShader = new Shader("assets/shaders/vertex.glsl",
-                                 "assets/shaders/bloom_composite.glsl");
-
-  // Scene FBO (full resolution, HDR)
-  glGenFramebuffers(1, &m_sceneFBO);
-  glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
-  glGenTextures(1, &m_sceneTexture);
-  glBindTexture(GL_TEXTURE_2D, m_sceneTexture);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA,
-               GL_FLOAT, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         m_sceneTexture, 0);
+  m_extractShader = ShaderCache::get("assets/shaders/vertex.glsl",
+                                     "assets/shaders/bloom_extract.glsl");
+  m_downsampleShader = ShaderCache::get("assets/shaders/vertex.glsl",
+                                        "assets/shaders/bloom_downsample.glsl");
+  m_upsampleShader = ShaderCache::get("assets/shaders/vertex.glsl",
+                                      "assets/shaders/bloom_upsample.glsl");
+  m_compositeShader = ShaderCache::get("assets/shaders/vertex.glsl",
+                                       "assets/shaders/bloom_composite.glsl");
+  m_block.init(BLOOM_BLOCK_BINDING, sizeof(BloomBlock));
 
-  // Bright pass FBO (half resolution)
-  glGenFramebuffers(1, &m_brightFBO);
-  glBindFramebuffer(GL_FRAMEBUFFER, m_brightFBO);
-  glGenTextures(1, &m_brightTexture);
-  glBindTexture(GL_TEXTURE_2D, m_brightTexture);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width / 2, height / 2, 0, GL_RGBA,
-               GL_FLOAT, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         m_brightTexture, 0);
-
-  // Ping-pong FBOs for Gaussian blur (half resolution)
-  glGenFramebuffers(2, m_pingpongFBO);
-  glGenTextures(2, m_pingpongTextures);
-  for (int i = 0; i < 2; i++) {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_pingpongFBO[i]);
-    glBindTexture(GL_TEXTURE_2D, m_pingpongTextures[i]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width / 2, height / 2, 0,
-                 GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           m_pingpongTextures[i], 0);
+  // Scene FBO (full resolution, HDR, plus the bright target)
+  createSceneTarget(m_sceneFBO, m_sceneTexture, m_brightTexture, width,
+                    height);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    std::cerr << "Bloom scene framebuffer not complete!" << std::endl;
+
+  // Pyramid levels; storage is allocated at first use, once the radius is
+  // known
+  for (int i = 0; i < LEVELS; i++) {
+    createTarget(m_levelFBO[i], m_levelTextures[i], 1, 1);
+    m_levelSize[i] = glm::ivec2(0);
   }
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -76,90 +103,206 @@ void BloomRenderer::resize(int width, int height) {
   glBindTexture(GL_TEXTURE_2D, m_sceneTexture);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA,
                GL_FLOAT, NULL);
-
   glBindTexture(GL_TEXTURE_2D, m_brightTexture);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width / 2, height / 2, 0, GL_RGBA,
+  glTexImage2D(GL_TEXTURE_2D, 0, BRIGHT_FORMAT, width, height, 0, GL_RGBA,
                GL_FLOAT, NULL);
+}
 
-  for (int i = 0; i < 2; i++) {
-    glBindTexture(GL_TEXTURE_2D, m_pingpongTextures[i]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width / 2, height / 2, 0,
-                 GL_RGBA, GL_FLOAT, NULL);
-  }
+void BloomRenderer::beginScene(const BloomParams &params) {
+  // The scene shaders read the threshold and intensity
+  updateUniformBlock(params, params.enabled ? params.strength : 0.0f);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+  glViewport(0, 0, m_width, m_height);
+  clearSceneTarget(params.enabled);
 }
 
-void BloomRenderer::applyBloom(const BloomParams &params,
-                               unsigned int quadVAO) {
+void BloomRenderer::extractBright(const BloomParams &params,
+                                  unsigned int quadVAO) {
+  updateUniformBlock(params, params.strength);
+  GpuProfileScope scope(m_profiler, "bloom extract");
   glBindVertexArray(quadVAO);
-
-  // Pass 1: Extract bright areas
-  glBindFramebuffer(GL_FRAMEBUFFER, m_brightFBO);
-  glViewport(0, 0, m_width / 2, m_height / 2);
-  glClear(GL_COLOR_BUFFER_BIT);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFBO);
+  glViewport(0, 0, m_width, m_height);
+  const GLenum brightOnly[2] = {GL_NONE, GL_COLOR_ATTACHMENT1};
+  glDrawBuffers(2, brightOnly);
 
   m_extractShader->use();
   m_extractShader->setInt("u_Scene", 0);
-  m_extractShader->setFloat("u_BloomThreshold", params.threshold);
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, m_sceneTexture);
   glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void BloomRenderer::shutdown() { deleteResources(); }
+
+glm::ivec2 BloomRenderer::pyramidSize(int imageWidth, int imageHeight,
+                                      const BloomParams &params) {
+  float radius = glm::clamp(params.radius, 0.25f, 4.0f);
+  // Outputs under BASE_HEIGHT rows never blur a pyramid larger than they are
+  int height =
+      (int)std::lround(std::min((int)BASE_HEIGHT, imageHeight) / radius);
+  int width = (int)std::lround((double)height * imageWidth / imageHeight);
+  return glm::ivec2(std::max(width, 1), std::max(height, 1));
+}
+
+void BloomRenderer::allocatePyramid(const glm::ivec2 &size) {
+  if (m_levelSize[0] == size)
+    return;
 
-  // Pass 2: Kawase blur (4 iterations with increasing offsets)
-  // More efficient than 6-pass Gaussian: 4 passes × 5 taps vs 6 passes × 18
-  // taps
-  float offsets[] = {0.0f, 1.0f, 2.0f, 3.0f};
-  int kawasePasses = 4;
-  m_kawaseShader->use();
-  m_kawaseShader->setFloat("u_BloomIntensity", params.intensity);
-
-  for (int i = 0; i < kawasePasses; i++) {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_pingpongFBO[i % 2]);
-    glClear(GL_COLOR_BUFFER_BIT);
-    m_kawaseShader->setFloat("u_Offset", offsets[i]);
-    m_kawaseShader->setInt("u_Image", 0);
-    glBindTexture(GL_TEXTURE_2D,
-                  i == 0 ? m_brightTexture : m_pingpongTextures[(i + 1) % 2]);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+  for (int i = 0; i < LEVELS; i++) {
+    m_levelSize[i] = glm::max(glm::ivec2(glm::round(glm::vec2(size) /
+                                                    float(1 << i))),
+                              glm::ivec2(1));
+    glBindTexture(GL_TEXTURE_2D, m_levelTextures[i]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_levelSize[i].x,
+                 m_levelSize[i].y, 0, GL_RGBA, GL_FLOAT, NULL);
   }
+}
 
-  // Pass 3: Composite
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glViewport(0, 0, m_width, m_height);
-  glClear(GL_COLOR_BUFFER_BIT);
+void BloomRenderer::updateUniformBlock(const BloomParams &params,
+                                       float strength) {
+  BloomBlock block = {};
+  block.threshold = params.threshold;
+  block.intensity = params.intensity;
+  block.strength = strength;
+  block.exposure = params.exposure;
+  m_block.update(block);
+}
 
-  m_compositeShader->use();
-  m_compositeShader->setInt("u_Scene", 0);
-  m_compositeShader->setInt("u_Bloom", 1);
-  m_compositeShader->setFloat("u_BloomStrength", params.strength);
-  m_compositeShader->setFloat("u_Exposure", params.exposure);
+void BloomRenderer::applyBloom(const BloomParams &params,
+                               unsigned int quadVAO) {
+  updateUniformBlock(params, params.strength);
+  allocatePyramid(pyramidSize(m_width, m_height, params));
+  blurPyramid(m_brightTexture, glm::ivec2(m_width, m_height), quadVAO);
+  composite(m_levelTextures[0], glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), quadVAO);
+}
 
+void BloomRenderer::blurPyramid(unsigned int source,
+                                const glm::ivec2 &sourceSize,
+                                unsigned int quadVAO) {
+  glBindVertexArray(quadVAO);
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, m_sceneTexture);
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, m_pingpongTextures[0]);
 
-  glDrawArrays(GL_TRIANGLES, 0, 6);
+  // Pass 1: Downsample level by level, starting from the full-resolution
+  // bright texture, whose ratio to the base varies with the image size and
+  // radius (see bloom_downsample.glsl).
+  // Every level is fully overwritten, so nothing needs clearing.
+  {
+    GpuProfileScope scope(m_profiler, "bloom downsample");
+    m_downsampleShader->use();
+    m_downsampleShader->setInt("u_Image", 0);
+    for (int i = 0; i < LEVELS; i++) {
+      glBindFramebuffer(GL_FRAMEBUFFER, m_levelFBO[i]);
+      glViewport(0, 0, m_levelSize[i].x, m_levelSize[i].y);
+      m_downsampleShader->setVec2("u_TexelSize",
+                                  1.0f / glm::vec2(m_levelSize[i]));
+      m_downsampleShader->setVec2(
+          "u_SourceTexelSize",
+          1.0f / glm::vec2(i == 0 ? sourceSize : m_levelSize[i - 1]));
+      glBindTexture(GL_TEXTURE_2D, i == 0 ? source : m_levelTextures[i - 1]);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+  }
+
+  // Pass 2: Upsample back to the base. Level i keeps 1 / (LEVELS - i) of
+  // its own contents, so it ends up as the mean of levels i..LEVELS-1 and
+  // the bloom has the brightness of the extracted light at any depth.
+  {
+    GpuProfileScope scope(m_profiler, "bloom upsample");
+    m_upsampleShader->use();
+    m_upsampleShader->setInt("u_Image", 0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+    for (int i = LEVELS - 2; i >= 0; i--) {
+      glBlendColor(0.0f, 0.0f, 0.0f, float(LEVELS - 1 - i) / (LEVELS - i));
+      glBindFramebuffer(GL_FRAMEBUFFER, m_levelFBO[i]);
+      glViewport(0, 0, m_levelSize[i].x, m_levelSize[i].y);
+      glBindTexture(GL_TEXTURE_2D, m_levelTextures[i + 1]);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    glDisable(GL_BLEND);
+  }
 }
 
-void BloomRenderer::renderWithoutBloom(const BloomParams &params,
-                                       unsigned int quadVAO) {
+// Tone map the scene texture into the output FBO, adding 'bloomTexture'
+// sampled over 'bloomRect' (see bloom_composite.glsl)
+void BloomRenderer::composite(unsigned int bloomTexture,
+                              const glm::vec4 &bloomRect,
+                              unsigned int quadVAO) {
+  GpuProfileScope scope(m_profiler, "composite");
   glBindVertexArray(quadVAO);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
   glViewport(0, 0, m_width, m_height);
   glClear(GL_COLOR_BUFFER_BIT);
 
   m_compositeShader->use();
   m_compositeShader->setInt("u_Scene", 0);
   m_compositeShader->setInt("u_Bloom", 1);
-  m_compositeShader->setFloat("u_BloomStrength", 0.0f);
-  m_compositeShader->setFloat("u_Exposure", params.exposure);
+  m_compositeShader->setVec4("u_BloomRect", bloomRect);
 
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, m_sceneTexture);
   glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, m_sceneTexture); // Dummy, not used
+  glBindTexture(GL_TEXTURE_2D, bloomTexture);
 
   glDrawArrays(GL_TRIANGLES, 0, 6);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void BloomRenderer::renderWithoutBloom(const BloomParams &params,
+                                       unsigned int quadVAO) {
+  updateUniformBlock(params, 0.0f);
+  // Dummy bloom texture, not used
+  composite(m_sceneTexture, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), quadVAO);
+}
+
+// The pyramid and scene texture are left as the last frame wrote them
+void BloomRenderer::recomposite(const BloomParams &params,
+                                unsigned int quadVAO) {
+  if (!params.enabled) {
+    renderWithoutBloom(params, quadVAO);
+    return;
+  }
+  updateUniformBlock(params, params.strength);
+  composite(m_levelTextures[0], glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), quadVAO);
+}
+
+glm::ivec2 BloomRenderer::beginPyramid(int imageWidth, int imageHeight,
+                                       const BloomParams &params) {
+  glm::ivec2 size = pyramidSize(imageWidth, imageHeight, params);
+  if (m_sourceSize != size) {
+    if (m_sourceFBO) {
+      glDeleteFramebuffers(1, &m_sourceFBO);
+      glDeleteTextures(1, &m_sourceTexture);
+      glDeleteTextures(1, &m_sourceBrightTexture);
+    }
+    createSceneTarget(m_sourceFBO, m_sourceTexture, m_sourceBrightTexture,
+                      size.x, size.y);
+    m_sourceSize = size;
+  }
+
+  updateUniformBlock(params, params.strength);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_sourceFBO);
+  glViewport(0, 0, size.x, size.y);
+  clearSceneTarget(true);
+  return size;
+}
+
+void BloomRenderer::buildPyramid(const BloomParams &params,
+                                 unsigned int quadVAO) {
+  updateUniformBlock(params, params.strength);
+  allocatePyramid(m_sourceSize);
+  blurPyramid(m_sourceBrightTexture, m_sourceSize, quadVAO);
+}
+
+void BloomRenderer::compositeTile(const BloomParams &params,
+                                  unsigned int quadVAO,
+                                  const glm::vec2 &origin,
+                                  const glm::vec2 &imageSize) {
+  updateUniformBlock(params, params.strength);
+  glm::vec2 window(m_width, m_height);
+  composite(m_levelTextures[0],
+            glm::vec4(origin / imageSize, window / imageSize), quadVAO);
 }
 
 void BloomRenderer::deleteResources() {
@@ -167,16 +310,24 @@ void BloomRenderer::deleteResources() {
     return;
 
   glDeleteFramebuffers(1, &m_sceneFBO);
-  glDeleteFramebuffers(1, &m_brightFBO);
-  glDeleteFramebuffers(2, m_pingpongFBO);
   glDeleteTextures(1, &m_sceneTexture);
   glDeleteTextures(1, &m_brightTexture);
-  glDeleteTextures(2, m_pingpongTextures);
+  glDeleteFramebuffers(LEVELS, m_levelFBO);
+  glDeleteTextures(LEVELS, m_levelTextures);
+  if (m_sourceFBO) {
+    glDeleteFramebuffers(1, &m_sourceFBO);
+    glDeleteTextures(1, &m_sourceTexture);
+    glDeleteTextures(1, &m_sourceBrightTexture);
+    m_sourceFBO = 0;
+    m_sourceTexture = 0;
+    m_sourceSize = glm::ivec2(0);
+  }
 
-  delete m_extractShader;
-  delete m_blurShader;
-  delete m_kawaseShader;
-  delete m_compositeShader;
+  m_extractShader.reset();
+  m_downsampleShader.reset();
+  m_upsampleShader.reset();
+  m_compositeShader.reset();
+  m_block.shutdown();
 
   m_initialized = false;
 }
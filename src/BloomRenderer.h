@@ -2,18 +2,38 @@
 #define BLOOM_RENDERER_H
 
 #include "Shader.h"
+#include "UniformBuffer.h"
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+
+class GpuProfiler;
 
 struct BloomParams {
   float threshold = 0.8f;
   float intensity = 1.0f;
   float strength = 0.5f;
   float exposure = 1.2f;
+  // Spread relative to the image height (0.25-4); the pyramid base is
+  // min(BASE_HEIGHT, image height) / radius rows
+  float radius = 1.0f;
   bool enabled = true;
+
+  bool operator==(const BloomParams &other) const;
+  bool operator!=(const BloomParams &other) const { return !(*this == other); }
 };
 
+// Bloom over a mip pyramid. The scene shaders write the bright parts of the
+// scene to a second target (bloom_bright.glsl); they are box filtered to a
+// base level of fixed height, halved LEVELS - 1 times with a dual-filter
+// downsample, then tent-upsampled back with each level blended in. Sizes
+// follow the image height rather than its pixel count, so the bloom covers
+// the same part of the image at any resolution and costs about the same.
 class BloomRenderer {
 public:
+  static const int LEVELS = 6;
+  static const int BASE_HEIGHT = 540;
+
   BloomRenderer();
   ~BloomRenderer();
 
@@ -23,33 +43,84 @@ public:
   // Resize FBOs when window size changes
   void resize(int width, int height);
 
-  // Render the scene to the internal HDR FBO
-  // Returns the scene texture ID for further processing
+  void shutdown();
+
+  // Bind, clear and size the internal HDR scene FBO for the scene pass.
+  // Its second draw buffer takes the bright output of the scene shaders
+  // when bloom is enabled.
+  void beginScene(const BloomParams &params);
   unsigned int getSceneFBO() const { return m_sceneFBO; }
   unsigned int getSceneTexture() const { return m_sceneTexture; }
 
+  // Fill the bright target from the scene texture, for scenes that were
+  // uploaded rather than drawn by the scene shaders
+  void extractBright(const BloomParams &params, unsigned int quadVAO);
+
+  // Framebuffer the final composite is written to (0 = default framebuffer).
+  // Headless rendering points this at an offscreen LDR target.
+  void setOutputFBO(unsigned int fbo) { m_outputFBO = fbo; }
+
+  // Time each post-processing pass (null disables)
+  void setProfiler(GpuProfiler *profiler) { m_profiler = profiler; }
+
   // Apply bloom post-processing and render to default framebuffer
   void applyBloom(const BloomParams &params, unsigned int quadVAO);
 
   // Render without bloom (just tone mapping)
   void renderWithoutBloom(const BloomParams &params, unsigned int quadVAO);
 
+  // Composite the previous frame's scene and bloom again, skipping the
+  // pyramid, to redraw the output of an unchanged scene. 'params' must be
+  // the ones that frame used.
+  void recomposite(const BloomParams &params, unsigned int quadVAO);
+
+  // Tiled rendering. Every tile needs the pyramid of the whole image, which
+  // is small, so it is built once: beginPyramid() binds a target for the
+  // whole image at the base level size (returned), render the scene into
+  // it, call buildPyramid(), then composite each tile (a window at 'origin'
+  // of the image, bottom-left, in the scene FBO) with compositeTile().
+  glm::ivec2 beginPyramid(int imageWidth, int imageHeight,
+                          const BloomParams &params);
+  void buildPyramid(const BloomParams &params, unsigned int quadVAO);
+  void compositeTile(const BloomParams &params, unsigned int quadVAO,
+                     const glm::vec2 &origin, const glm::vec2 &imageSize);
+
+  // Base level size for an image
+  static glm::ivec2 pyramidSize(int imageWidth, int imageHeight,
+                                const BloomParams &params);
+
 private:
   void deleteResources();
+  void updateUniformBlock(const BloomParams &params, float strength);
+  void allocatePyramid(const glm::ivec2 &size);
+  // Downsample the bright texture 'source' into the base level, then run
+  // the pyramid
+  void blurPyramid(unsigned int source, const glm::ivec2 &sourceSize,
+                   unsigned int quadVAO);
+  void composite(unsigned int bloomTexture, const glm::vec4 &bloomRect,
+                 unsigned int quadVAO);
 
   // FBO and texture handles
   unsigned int m_sceneFBO = 0;
   unsigned int m_sceneTexture = 0;
-  unsigned int m_brightFBO = 0;
   unsigned int m_brightTexture = 0;
-  unsigned int m_pingpongFBO[2] = {0, 0};
-  unsigned int m_pingpongTextures[2] = {0, 0};
+  unsigned int m_levelFBO[LEVELS] = {};
+  unsigned int m_levelTextures[LEVELS] = {};
+  glm::ivec2 m_levelSize[LEVELS];
+  // Whole-image scene for tiled rendering, created by beginPyramid()
+  unsigned int m_sourceFBO = 0;
+  unsigned int m_sourceTexture = 0;
+  unsigned int m_sourceBrightTexture = 0;
+  glm::ivec2 m_sourceSize = glm::ivec2(0);
+  unsigned int m_outputFBO = 0;
+  GpuProfiler *m_profiler = nullptr;
 
   // Shaders
-  Shader *m_extractShader = nullptr;
-  Shader *m_blurShader = nullptr;
-  Shader *m_kawaseShader = nullptr;
-  Shader *m_compositeShader = nullptr;
+  std::shared_ptr<Shader> m_extractShader;
+  std::shared_ptr<Shader> m_downsampleShader;
+  std::shared_ptr<Shader> m_upsampleShader;
+  std::shared_ptr<Shader> m_compositeShader;
+  UniformBuffer m_block;
 
   int m_width = 0;
   int m_height = 0;
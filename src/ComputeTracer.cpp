@@ -0,0 +1,100 @@
+#include "ComputeTracer.h"
+#include "ShaderCache.h"
+
+#include <glad/glad.h>
+
+// Texture on 'attachment' of the bound draw framebuffer if it is a float
+// format with 'redBits' red bits, else 0
+static unsigned int attachedTexture(GLenum attachment, int redBits,
+                                    int &level) {
+  GLint type = GL_NONE;
+  glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment,
+                                        GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE,
+                                        &type);
+  if (type != GL_TEXTURE)
+    return 0;
+
+  GLint componentType = GL_NONE, red = 0, name = 0;
+  glGetFramebufferAttachmentParameteriv(
+      GL_DRAW_FRAMEBUFFER, attachment,
+      GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &componentType);
+  glGetFramebufferAttachmentParameteriv(
+      GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_RED_SIZE,
+      &red);
+  if (componentType != GL_FLOAT || red != redBits)
+    return 0;
+
+  glGetFramebufferAttachmentParameteriv(
+      GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME,
+      &name);
+  glGetFramebufferAttachmentParameteriv(
+      GL_DRAW_FRAMEBUFFER, attachment,
+      GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LEVEL, &level);
+  return (unsigned int)name;
+}
+
+ComputeTracer::ComputeTracer() {}
+
+ComputeTracer::~ComputeTracer() { shutdown(); }
+
+bool ComputeTracer::isSupported() {
+  static int supported = -1;
+  if (supported < 0) {
+    supported =
+        GLAD_GL_ARB_compute_shader && GLAD_GL_ARB_shader_image_load_store;
+  }
+  return supported != 0;
+}
+
+void ComputeTracer::init(const ShaderDefines &defines) {
+  if (defines != m_defines)
+    m_shader.reset();
+  m_defines = defines;
+}
+
+void ComputeTracer::shutdown() { m_shader.reset(); }
+
+bool ComputeTracer::begin() {
+  if (!isSupported())
+    return false;
+
+  GLint fbo = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+  if (!fbo)
+    return false;
+  m_sceneTexture = attachedTexture(GL_COLOR_ATTACHMENT0, 16, m_sceneLevel);
+  if (!m_sceneTexture)
+    return false;
+
+  GLint drawBuffer = GL_NONE;
+  glGetIntegerv(GL_DRAW_BUFFER1, &drawBuffer);
+  m_brightTexture =
+      drawBuffer == GL_COLOR_ATTACHMENT1
+          ? attachedTexture(GL_COLOR_ATTACHMENT1, 11, m_brightLevel)
+          : 0;
+  glGetIntegerv(GL_VIEWPORT, m_viewport);
+
+  if (!m_shader)
+    m_shader =
+        ShaderCache::getCompute("assets/shaders/compute_trace.glsl", m_defines);
+  return true;
+}
+
+void ComputeTracer::dispatch() {
+  glUniform4i(m_shader->getUniformLocation("u_Viewport"), m_viewport[0],
+              m_viewport[1], m_viewport[2], m_viewport[3]);
+  m_shader->setBool("u_WriteBright", m_brightTexture != 0);
+
+  glBindImageTexture(0, m_sceneTexture, m_sceneLevel, GL_FALSE, 0,
+                     GL_WRITE_ONLY, GL_RGBA16F);
+  if (m_brightTexture)
+    glBindImageTexture(1, m_brightTexture, m_brightLevel, GL_FALSE, 0,
+                       GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+
+  int blocks = ((m_viewport[2] + 7) / 8) * ((m_viewport[3] + 7) / 8);
+  glDispatchCompute((blocks + kBatchBlocks - 1) / kBatchBlocks, 1, 1);
+
+  // The images are read next as textures (bloom, composite) or rendered to
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT |
+                  GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
@@ -0,0 +1,52 @@
+#ifndef COMPUTE_TRACER_H
+#define COMPUTE_TRACER_H
+
+#include <memory>
+
+#include "Shader.h"
+
+// The march as a compute pass (compute_trace.glsl) instead of a full-screen
+// draw. Each work group keeps its lanes on a batch of pixel blocks and
+// marches their rays in short slices, compacting the live ones between
+// slices, so the long rays near the photon sphere don't hold up lanes whose
+// rays have already ended. Results are written as images into the textures
+// of the bound framebuffer, so the pass is a drop-in for the scene draw.
+// Needs GL 4.3 or the compute shader and image load/store extensions.
+class ComputeTracer {
+public:
+  // 8x8 pixel blocks per work group (BATCH_BLOCKS in the shader)
+  static const int kBatchBlocks = 16;
+
+  ComputeTracer();
+  ~ComputeTracer();
+
+  // Whether the current context can run the tracer
+  static bool isSupported();
+
+  // The program is only built on the first begin() after 'defines' (the
+  // renderer's quality tier) change
+  void init(const ShaderDefines &defines = ShaderDefines());
+  void shutdown();
+
+  // Look up the scene (RGBA16F) and bloom input (R11F_G11F_B10F, if draw
+  // buffer 1 is enabled) textures of the bound draw framebuffer and the
+  // viewport. False if they can't be written as images; the caller then
+  // draws the fragment path.
+  bool begin();
+  // Trace the viewport with the program's uniforms already set
+  void dispatch();
+
+  Shader *getShader() const { return m_shader.get(); }
+
+private:
+  std::shared_ptr<Shader> m_shader;
+  ShaderDefines m_defines;
+
+  unsigned int m_sceneTexture = 0;
+  int m_sceneLevel = 0;
+  unsigned int m_brightTexture = 0;
+  int m_brightLevel = 0;
+  int m_viewport[4] = {0, 0, 0, 0};
+};
+
+#endif // COMPUTE_TRACER_H
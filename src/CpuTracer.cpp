@@ -0,0 +1,610 @@
+#include "CpuTracer.h"
+#include "HalfFloat.h"
+#include "SimdFloat.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Must match scene_common.glsl
+static const float PI = 3.14159265359f;
+static const float SCHWARZSCHILD_FACTOR = 3.0f;
+static const float MAX_DIST = 80.0f;
+static const int MAX_DISK_CROSSINGS = 4;
+
+// The shader's QUALITY_TIER defines, indexed by SceneQuality
+struct TraceTier {
+  int marchSteps;
+  float marchStepScale;
+  int diskNoiseLayers;
+  int starSamples;
+  float starLodBias;
+};
+
+static const TraceTier TRACE_TIERS[] = {
+    {100, 2.0f, 1, 1, 1.0f}, // Low
+    {140, 1.4f, 2, 1, 0.0f}, // Medium
+    {200, 1.0f, 3, 1, 0.0f}, // High
+    {400, 0.5f, 3, 4, 0.0f}, // Ultra
+};
+
+// Rays per tile; the width is a multiple of every supported SIMD width
+static const int kTileWidth = 32;
+static const int kTileHeight = 8;
+
+// ============================================================================
+// GLSL helpers
+// ============================================================================
+
+static inline float clampf(float x, float lo, float hi) {
+  return std::min(std::max(x, lo), hi);
+}
+
+static inline float smoothstepf(float edge0, float edge1, float x) {
+  float t = clampf((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+  return t * t * (3.0f - 2.0f * t);
+}
+
+static inline int wrapIndex(int i, int n) {
+  i %= n;
+  return i < 0 ? i + n : i;
+}
+
+// Per-frame constants shared by every ray (the shader's uniforms)
+struct TraceFrame {
+  BlackHoleParams params;
+  float time;
+  float diskPhase;
+  float cameraDistance;
+  float cameraAngle;
+  int width;
+  int height;
+  TraceTier tier;
+
+  glm::vec3 ro;
+  glm::vec3 forward;
+  glm::vec3 right;
+  glm::vec3 up;
+
+  const float *noise;
+  int noiseSize;
+  // Starfield mip levels: 6 faces of RGB halves each
+  const uint16_t *const *starfieldLevels;
+  int starfieldLevelCount;
+  int faceSize;
+};
+
+// texture(sampler3D) with GL_LINEAR + GL_REPEAT
+static glm::vec4 sampleNoise3D(const TraceFrame &f, glm::vec3 p) {
+  const int n = f.noiseSize;
+  float x = p.x * n - 0.5f;
+  float y = p.y * n - 0.5f;
+  float z = p.z * n - 0.5f;
+  float fx0 = std::floor(x), fy0 = std::floor(y), fz0 = std::floor(z);
+  float tx = x - fx0, ty = y - fy0, tz = z - fz0;
+  int x0 = wrapIndex((int)fx0, n), x1 = wrapIndex((int)fx0 + 1, n);
+  int y0 = wrapIndex((int)fy0, n), y1 = wrapIndex((int)fy0 + 1, n);
+  int z0 = wrapIndex((int)fz0, n), z1 = wrapIndex((int)fz0 + 1, n);
+
+  const float *d = f.noise;
+  auto texel = [&](int xi, int yi, int zi) {
+    return d + ((size_t)(zi * n + yi) * n + xi) * 4;
+  };
+
+  glm::vec4 result(0.0f);
+  const float wx[2] = {1.0f - tx, tx};
+  const float wy[2] = {1.0f - ty, ty};
+  const float wz[2] = {1.0f - tz, tz};
+  const int xs[2] = {x0, x1}, ys[2] = {y0, y1}, zs[2] = {z0, z1};
+  for (int k = 0; k < 2; k++) {
+    for (int j = 0; j < 2; j++) {
+      for (int i = 0; i < 2; i++) {
+        float w = wx[i] * wy[j] * wz[k];
+        const float *t = texel(xs[i], ys[j], zs[k]);
+        result += glm::vec4(t[0], t[1], t[2], t[3]) * w;
+      }
+    }
+  }
+  return result;
+}
+
+// Bilinear fetch from one level of the cubemap, GL_CLAMP_TO_EDGE,
+// non-seamless
+static glm::vec3 sampleStarfieldLevel(const TraceFrame &f, glm::vec3 r,
+                                      int level) {
+  float ax = std::fabs(r.x), ay = std::fabs(r.y), az = std::fabs(r.z);
+  int face;
+  float sc, tc, ma;
+  // Face selection per the GL spec cube map table
+  if (ax >= ay && ax >= az) {
+    ma = ax;
+    face = r.x > 0.0f ? 0 : 1;
+    sc = r.x > 0.0f ? -r.z : r.z;
+    tc = -r.y;
+  } else if (ay >= az) {
+    ma = ay;
+    face = r.y > 0.0f ? 2 : 3;
+    sc = r.x;
+    tc = r.y > 0.0f ? r.z : -r.z;
+  } else {
+    ma = az;
+    face = r.z > 0.0f ? 4 : 5;
+    sc = r.z > 0.0f ? r.x : -r.x;
+    tc = -r.y;
+  }
+  float s = 0.5f * (sc / ma + 1.0f);
+  float t = 0.5f * (tc / ma + 1.0f);
+
+  const int n = std::max(f.faceSize >> level, 1);
+  float x = s * n - 0.5f;
+  float y = t * n - 0.5f;
+  float fx0 = std::floor(x), fy0 = std::floor(y);
+  float tx = x - fx0, ty = y - fy0;
+  int x0 = std::min(std::max((int)fx0, 0), n - 1);
+  int x1 = std::min(std::max((int)fx0 + 1, 0), n - 1);
+  int y0 = std::min(std::max((int)fy0, 0), n - 1);
+  int y1 = std::min(std::max((int)fy0 + 1, 0), n - 1);
+
+  const uint16_t *d = f.starfieldLevels[level] + (size_t)face * n * n * 3;
+  auto texel = [&](int xi, int yi) {
+    const uint16_t *t = d + ((size_t)yi * n + xi) * 3;
+    return glm::vec3(halfToFloat(t[0]), halfToFloat(t[1]), halfToFloat(t[2]));
+  };
+
+  glm::vec3 top = texel(x0, y0) * (1.0f - tx) + texel(x1, y0) * tx;
+  glm::vec3 bottom = texel(x0, y1) * (1.0f - tx) + texel(x1, y1) * tx;
+  return top * (1.0f - ty) + bottom * ty;
+}
+
+// textureLod(samplerCube) with GL_LINEAR_MIPMAP_LINEAR
+static glm::vec3 sampleStarfield(const TraceFrame &f, glm::vec3 r, float lod) {
+  lod = clampf(lod, 0.0f, (float)(f.starfieldLevelCount - 1));
+  int level = (int)lod;
+  float t = lod - (float)level;
+  glm::vec3 col = sampleStarfieldLevel(f, r, level);
+  if (t > 0.0f) {
+    col = col * (1.0f - t) + sampleStarfieldLevel(f, r, level + 1) * t;
+  }
+  return col;
+}
+
+// ============================================================================
+// STARFIELD
+// ============================================================================
+
+static glm::vec3 getStars(const TraceFrame &f, glm::vec3 rd,
+                          float lensingAmount, glm::vec3 initialDir,
+                          glm::vec3 cameraPos) {
+  const float radius = f.params.radius;
+  glm::vec3 toBlackHole = glm::normalize(-cameraPos);
+  float distFromCamera = glm::length(cameraPos);
+  float angularDistToCenter = std::acos(
+      clampf(glm::dot(glm::normalize(initialDir), toBlackHole), -1.0f, 1.0f));
+
+  float apparentSize = radius * 3.0f / distFromCamera;
+  float innerZone = clampf(apparentSize * 0.8f, 0.05f, 0.2f);
+  float outerZone = clampf(apparentSize * 2.5f, 0.15f, 0.6f);
+
+  float proximityStretch;
+  if (angularDistToCenter < innerZone) {
+    proximityStretch = 1.0f;
+  } else if (angularDistToCenter < outerZone) {
+    float t = (angularDistToCenter - innerZone) / (outerZone - innerZone);
+    proximityStretch = 1.0f - smoothstepf(0.0f, 1.0f, t);
+    proximityStretch = std::pow(proximityStretch, 0.5f);
+  } else {
+    proximityStretch = 0.0f;
+  }
+
+  float radiusScale = radius * 2.0f;
+  float totalStretch =
+      std::max(lensingAmount * 2.0f, proximityStretch) * radiusScale;
+  float stretch = 1.0f + totalStretch * 20.0f;
+
+  glm::vec3 sampleDir = rd;
+  glm::vec3 radialDir =
+      glm::normalize(toBlackHole - rd * glm::dot(rd, toBlackHole));
+  float radialPull = totalStretch * 0.4f;
+  sampleDir = glm::normalize(sampleDir + radialDir * radialPull);
+
+  sampleDir.y /= stretch;
+  sampleDir = glm::normalize(sampleDir);
+
+  float lod = std::log2(stretch) * 0.5f + f.tier.starLodBias;
+  glm::vec3 col;
+  if (f.tier.starSamples > 1) {
+    // Rotated-grid supersampling over the pixel's footprint
+    glm::vec3 side = glm::normalize(glm::cross(
+        sampleDir, std::fabs(sampleDir.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f)
+                                                  : glm::vec3(1.0f, 0.0f, 0.0f)));
+    glm::vec3 up = glm::cross(sampleDir, side);
+    float pixel = 1.0f / (float)std::min(f.width, f.height);
+    static const float taps[4][2] = {{0.125f, 0.375f},
+                                     {-0.375f, 0.125f},
+                                     {-0.125f, -0.375f},
+                                     {0.375f, -0.125f}};
+    col = glm::vec3(0.0f);
+    for (int i = 0; i < f.tier.starSamples; i++) {
+      glm::vec3 dir = glm::normalize(
+          sampleDir + (side * taps[i][0] + up * taps[i][1]) * pixel);
+      col += sampleStarfield(f, dir, lod);
+    }
+    col /= (float)f.tier.starSamples;
+  } else {
+    col = sampleStarfield(f, sampleDir, lod);
+  }
+  col *= 1.0f + totalStretch * 1.5f;
+  return col;
+}
+
+// ============================================================================
+// ACCRETION DISK
+// ============================================================================
+
+static glm::vec3 sampleDisk(const TraceFrame &f, glm::vec3 pos,
+                            float distToCenter) {
+  const BlackHoleParams &p = f.params;
+  if (distToCenter < p.diskInnerRadius || distToCenter > p.diskOuterRadius) {
+    return glm::vec3(0.0f);
+  }
+
+  float t = (distToCenter - p.diskInnerRadius) /
+            (p.diskOuterRadius - p.diskInnerRadius);
+  float angle = std::atan2(pos.z, pos.x);
+
+  float rotAngle = angle - f.diskPhase * 0.2f;
+  float u = rotAngle / (2.0f * PI);
+  float v = t;
+
+  // Layer 1: Base Flow
+  float warp =
+      sampleNoise3D(f, glm::vec3(u * 2.0f, v * 1.5f, f.time * 0.05f)).z * 0.15f;
+  glm::vec3 baseCoord(u * 3.0f + warp, v * 4.0f + warp, 0.0f);
+  float baseFlow = sampleNoise3D(f, baseCoord).x;
+  baseFlow = smoothstepf(0.2f, 0.8f, baseFlow);
+
+  // Layer 2: Engraved Streaks (the layer's mean on lower tiers)
+  float streaks = 0.33f;
+  if (f.tier.diskNoiseLayers >= 2) {
+    glm::vec3 streakCoord(u * 8.0f + warp * 2.0f, v * 12.0f, f.time * 0.1f);
+    streaks = sampleNoise3D(f, streakCoord).y;
+    streaks = std::pow(streaks, 2.0f);
+  }
+
+  // Layer 3: Hotspots/Clumps
+  float clumps = 0.5f;
+  if (f.tier.diskNoiseLayers >= 3)
+    clumps = sampleNoise3D(f, glm::vec3(u * 4.0f, v * 3.0f, 5.0f)).z;
+
+  float noiseVal = baseFlow * 0.6f + streaks * 0.4f;
+  noiseVal *= (0.7f + 0.3f * clumps);
+  float diskNoise = 0.3f + 0.7f * noiseVal;
+
+  float edgeFade = smoothstepf(0.0f, 0.15f, t) * smoothstepf(1.0f, 0.85f, t);
+  diskNoise = diskNoise * edgeFade + (1.0f - edgeFade) * 0.1f;
+
+  // Temperature gradient
+  float temperature = std::pow(1.0f - t, 0.5f);
+  glm::vec3 baseColor = glm::mix(p.diskColor2, p.diskColor1, temperature);
+
+  // Relativistic Doppler beaming
+  float orbitalSpeed = 0.4f * (1.0f - t * 0.5f);
+  glm::vec3 tangent =
+      glm::normalize(glm::vec3(-std::sin(angle), 0.0f, std::cos(angle)));
+  glm::vec3 velocity = tangent * orbitalSpeed;
+  glm::vec3 viewDir = glm::normalize(
+      glm::vec3(0.0f, std::sin(f.cameraAngle), std::cos(f.cameraAngle)));
+
+  float dopplerFactor = glm::dot(velocity, viewDir);
+  float beaming = std::pow(1.0f + dopplerFactor * 2.0f, 3.0f);
+  beaming = clampf(beaming, 0.1f, 5.0f);
+
+  glm::vec3 color = baseColor;
+  if (dopplerFactor > 0.0f) {
+    glm::vec3 blueShift(0.8f, 0.9f, 1.0f);
+    color = glm::mix(color, color * blueShift * 1.5f, dopplerFactor * 1.5f);
+  } else {
+    glm::vec3 redShift(1.2f, 0.6f, 0.3f);
+    color = glm::mix(color, color * redShift * 0.7f,
+                     std::fabs(dopplerFactor) * 1.2f);
+  }
+
+  color *= 0.3f + 0.7f * diskNoise;
+  float brightness = (1.0f - t) * (0.2f + 0.8f * diskNoise) * beaming;
+
+  return color * brightness * 2.0f;
+}
+
+// ============================================================================
+// MAIN - one packet of kSimdWidth horizontally adjacent pixels
+// ============================================================================
+
+static inline glm::vec3 laneVec(const float *x, const float *y, const float *z,
+                                int lane) {
+  return glm::vec3(x[lane], y[lane], z[lane]);
+}
+
+static void tracePacket(const TraceFrame &f, int px, int py, float *out) {
+  const BlackHoleParams &p = f.params;
+  const float minRes = (float)std::min(f.width, f.height);
+  const int lanes = std::min(kSimdWidth, f.width - px);
+
+  // Ray setup
+  float uvx[kSimdWidth];
+  for (int l = 0; l < kSimdWidth; l++) {
+    uvx[l] = ((float)(px + l) + 0.5f - 0.5f * f.width) / minRes;
+  }
+  float uvy = ((float)py + 0.5f - 0.5f * f.height) / minRes;
+
+  SimdFloat ux = simdLoad(uvx);
+  SimdVec3 rd = {f.forward.x + ux * f.right.x + uvy * f.up.x,
+                 f.forward.y + ux * f.right.y + uvy * f.up.y,
+                 f.forward.z + ux * f.right.z + uvy * f.up.z};
+  rd = simdNormalize(rd);
+
+  const SimdVec3 ro = {f.ro.x, f.ro.y, f.ro.z};
+  SimdVec3 pos = ro;
+  SimdVec3 vel = rd;
+
+  SimdVec3 color = {0.0f, 0.0f, 0.0f};
+  SimdFloat bloomMask = 0.0f;
+  SimdFloat totalDist = 0.0f;
+  SimdFloat accumulatedLensing = 0.0f;
+  SimdFloat prevY = pos.y;
+  SimdMask hitHorizon;
+
+  // Bounding Sphere Check
+  float boundRadius = std::max(p.diskOuterRadius * 1.5f, p.radius * 15.0f);
+  SimdFloat b = simdDot(ro, rd);
+  SimdFloat c = glm::dot(f.ro, f.ro) - boundRadius * boundRadius;
+  SimdFloat h = b * b - c;
+  SimdMask missed = (h < SimdFloat(0.0f)) & (c > SimdFloat(0.0f));
+  SimdMask active = ~missed;
+
+  const SimdFloat radius = p.radius;
+  const SimdFloat zero = 0.0f;
+  const SimdFloat escapeRadius = p.diskOuterRadius * 2.5f;
+  const SimdFloat thickness = p.diskThickness;
+
+  const float stepScale = f.tier.marchStepScale;
+  const SimdFloat invStepScale = 1.0f / stepScale;
+  float laneBuf[8][kSimdWidth];
+  int diskCrossings[kSimdWidth] = {};
+
+  for (int i = 0; i < f.tier.marchSteps && simdAny(active); i++) {
+    SimdFloat distToCenter = simdLength(pos);
+
+    SimdMask horizon = active & (distToCenter < radius);
+    hitHorizon |= horizon;
+    active &= ~horizon;
+
+    active &= ~(totalDist > SimdFloat(MAX_DIST));
+    active &= ~((distToCenter > escapeRadius) & (simdDot(vel, pos) > zero));
+    if (!simdAny(active))
+      break;
+
+    SimdFloat invDist = SimdFloat(1.0f) / distToCenter;
+    SimdVec3 toCenter = pos * -invDist;
+    SimdFloat gravity =
+        radius * SCHWARZSCHILD_FACTOR * (invDist * invDist);
+
+    SimdVec3 newVel =
+        simdNormalize(vel + toCenter * (gravity * (0.15f * stepScale)));
+    accumulatedLensing += simdSelect(
+        active, (SimdFloat(1.0f) - simdDot(vel, newVel)) * invStepScale, zero);
+    vel = simdSelect(active, newVel, vel);
+
+    SimdFloat stepSize = simdClamp((distToCenter - radius) * (0.08f * stepScale),
+                                   SimdFloat(0.005f * stepScale),
+                                   SimdFloat(0.4f * stepScale));
+
+    SimdVec3 newPos = pos + vel * stepSize;
+    SimdFloat newY = newPos.y;
+
+    SimdMask crossing = active & (prevY * newY < zero) &
+                        (simdAbs(newY) < thickness);
+    if (simdAny(crossing)) {
+      // Disk shading is texture-heavy and rare; do it per lane
+      simdStore(laneBuf[0], pos.x);
+      simdStore(laneBuf[1], pos.y);
+      simdStore(laneBuf[2], pos.z);
+      simdStore(laneBuf[3], vel.x * stepSize);
+      simdStore(laneBuf[4], vel.y * stepSize);
+      simdStore(laneBuf[5], vel.z * stepSize);
+      simdStore(laneBuf[6], prevY);
+      simdStore(laneBuf[7], newY);
+
+      float addR[kSimdWidth] = {}, addG[kSimdWidth] = {}, addB[kSimdWidth] = {};
+      float hit[kSimdWidth] = {};
+      for (int l = 0; l < lanes; l++) {
+        if (!simdLane(crossing, l) || diskCrossings[l] == MAX_DISK_CROSSINGS)
+          continue;
+        float interpT = laneBuf[6][l] / (laneBuf[6][l] - laneBuf[7][l]);
+        glm::vec3 intersect =
+            laneVec(laneBuf[0], laneBuf[1], laneBuf[2], l) +
+            laneVec(laneBuf[3], laneBuf[4], laneBuf[5], l) * interpT;
+        float discDist = std::sqrt(intersect.x * intersect.x +
+                                   intersect.z * intersect.z);
+        if (discDist < p.diskInnerRadius || discDist > p.diskOuterRadius)
+          continue;
+        diskCrossings[l]++;
+        glm::vec3 diskColor = sampleDisk(f, intersect, discDist);
+        if (glm::length(diskColor) > 0.0f) {
+          addR[l] = diskColor.x;
+          addG[l] = diskColor.y;
+          addB[l] = diskColor.z;
+          hit[l] = 1.0f;
+        }
+      }
+      color.x += simdLoad(addR);
+      color.y += simdLoad(addG);
+      color.z += simdLoad(addB);
+      bloomMask = simdMax(bloomMask, simdLoad(hit));
+    }
+
+    prevY = simdSelect(active, newY, prevY);
+    pos = simdSelect(active, newPos, pos);
+    totalDist += simdSelect(active, stepSize, zero);
+  }
+
+  // Per-lane shading of the final ray state
+  float rdx[kSimdWidth], rdy[kSimdWidth], rdz[kSimdWidth];
+  float vx[kSimdWidth], vy[kSimdWidth], vz[kSimdWidth];
+  float cr[kSimdWidth], cg[kSimdWidth], cb[kSimdWidth];
+  float mask[kSimdWidth], lensing[kSimdWidth];
+  simdStore(rdx, rd.x);
+  simdStore(rdy, rd.y);
+  simdStore(rdz, rd.z);
+  simdStore(vx, vel.x);
+  simdStore(vy, vel.y);
+  simdStore(vz, vel.z);
+  simdStore(cr, color.x);
+  simdStore(cg, color.y);
+  simdStore(cb, color.z);
+  simdStore(mask, bloomMask);
+  simdStore(lensing, accumulatedLensing);
+
+  const glm::vec3 toCenter = glm::normalize(-f.ro);
+  const float glowRadius = std::atan(p.radius * 10.0f / f.cameraDistance);
+  const float photonRingRadius = std::atan(p.radius * 1.5f / f.cameraDistance);
+
+  for (int l = 0; l < lanes; l++) {
+    float *o = out + l * 4;
+    glm::vec3 dir = laneVec(rdx, rdy, rdz, l);
+
+    if (simdLane(missed, l)) {
+      glm::vec3 stars = getStars(f, dir, 0.0f, dir, f.ro);
+      o[0] = stars.x;
+      o[1] = stars.y;
+      o[2] = stars.z;
+      o[3] = 0.0f;
+      continue;
+    }
+
+    bool horizon = simdLane(hitHorizon, l);
+    glm::vec3 col(cr[l], cg[l], cb[l]);
+    float bloom = mask[l];
+
+    float lensingAmount = clampf(lensing[l] * 10.0f, 0.0f, 1.0f);
+    if (!horizon) {
+      col += getStars(f, laneVec(vx, vy, vz, l), lensingAmount, dir, f.ro);
+    }
+
+    float angularDist =
+        std::acos(clampf(glm::dot(glm::normalize(dir), toCenter), -1.0f, 1.0f));
+
+    if (angularDist < glowRadius && !horizon) {
+      float glow = 1.0f - smoothstepf(0.0f, glowRadius, angularDist);
+      glow = std::pow(glow, 1.5f);
+      col += glm::vec3(1.0f, 0.5f, 0.2f) * glow * p.glowIntensity;
+      bloom = std::max(bloom, glow);
+    }
+
+    float photonRing =
+        smoothstepf(0.03f, 0.0f, std::fabs(angularDist - photonRingRadius));
+    if (!horizon) {
+      col += glm::vec3(1.0f, 0.9f, 0.7f) * photonRing * p.glowIntensity;
+      bloom = std::max(bloom, photonRing);
+    }
+
+    o[0] = col.x;
+    o[1] = col.y;
+    o[2] = col.z;
+    o[3] = bloom;
+  }
+}
+
+// ============================================================================
+// CpuTracer
+// ============================================================================
+
+CpuTracer::CpuTracer(unsigned int threadCount) : m_pool(threadCount) {}
+
+CpuTracer::~CpuTracer() {}
+
+bool CpuTracer::loadTextures(const NoiseTexture &noise,
+                             const StarfieldCubemap &starfield) {
+  if (noise.getTextureID() == 0 || starfield.getTextureID() == 0) {
+    std::cerr << "CpuTracer: textures not generated yet" << std::endl;
+    return false;
+  }
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  m_noiseSize = noise.getSize();
+  m_noise.resize((size_t)m_noiseSize * m_noiseSize * m_noiseSize * 4);
+  glBindTexture(GL_TEXTURE_3D, noise.getTextureID());
+  glGetTexImage(GL_TEXTURE_3D, 0, GL_RGBA, GL_FLOAT, m_noise.data());
+  glBindTexture(GL_TEXTURE_3D, 0);
+
+  // Compact formats are decoded by the driver on readback
+  m_faceSize = starfield.getFaceResolution();
+  m_starfield.assign(starfield.getLevelCount(), std::vector<uint16_t>());
+  m_starfieldLevels.clear();
+  glBindTexture(GL_TEXTURE_CUBE_MAP, starfield.getTextureID());
+  for (int level = 0; level < starfield.getLevelCount(); level++) {
+    int n = std::max(m_faceSize >> level, 1);
+    size_t faceTexels = (size_t)n * n * 3;
+    m_starfield[level].resize(faceTexels * 6);
+    for (int i = 0; i < 6; i++) {
+      glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, GL_RGB,
+                    GL_HALF_FLOAT, m_starfield[level].data() + faceTexels * i);
+    }
+    m_starfieldLevels.push_back(m_starfield[level].data());
+  }
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  std::cout << "CPU tracer ready (" << kSimdWidth << "-wide packets, "
+            << m_pool.getThreadCount() << " threads)" << std::endl;
+  return true;
+}
+
+void CpuTracer::render(const BlackHoleParams &params,
+                       const CameraParams &camParams, float time,
+                       float diskPhase, int width, int height,
+                       SceneQuality quality, std::vector<float> &rgba) {
+  rgba.assign((size_t)width * height * 4, 0.0f);
+  if (!isReady())
+    return;
+
+  TraceFrame f;
+  f.params = params;
+  f.time = time;
+  f.diskPhase = diskPhase;
+  f.cameraDistance = camParams.distance;
+  f.cameraAngle = camParams.angle;
+  f.width = width;
+  f.height = height;
+  f.tier = TRACE_TIERS[(int)quality];
+
+  // rotateX(vec3(0, 0, distance), angle)
+  f.ro = glm::vec3(0.0f, -std::sin(camParams.angle) * camParams.distance,
+                   std::cos(camParams.angle) * camParams.distance);
+  f.forward = glm::normalize(-f.ro);
+  f.right = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), f.forward));
+  f.up = glm::cross(f.forward, f.right);
+
+  f.noise = m_noise.data();
+  f.noiseSize = m_noiseSize;
+  f.starfieldLevels = m_starfieldLevels.data();
+  f.starfieldLevelCount = (int)m_starfieldLevels.size();
+  f.faceSize = m_faceSize;
+
+  int tilesX = (width + kTileWidth - 1) / kTileWidth;
+  int tilesY = (height + kTileHeight - 1) / kTileHeight;
+
+  m_pool.parallelFor(tilesX * tilesY, [&](int tile) {
+    int x0 = (tile % tilesX) * kTileWidth;
+    int y0 = (tile / tilesX) * kTileHeight;
+    int x1 = std::min(x0 + kTileWidth, width);
+    int y1 = std::min(y0 + kTileHeight, height);
+
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x += kSimdWidth) {
+        tracePacket(f, x, y, &rgba[((size_t)y * width + x) * 4]);
+      }
+    }
+  });
+}
@@ -0,0 +1,48 @@
+#ifndef CPU_TRACER_H
+#define CPU_TRACER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BlackHoleRenderer.h"
+#include "ThreadPool.h"
+
+// C++ port of the fragment.glsl ray march (main, sampleDisk, getStars).
+// Traces packets of kSimdWidth rays (AVX-512 / AVX2 / scalar) over image
+// tiles spread across all cores. Samples CPU copies of the same baked noise
+// volume and starfield cubemap, so it serves both as a fast path on
+// GPU-less hosts and as a deterministic reference image.
+class CpuTracer {
+public:
+  // threadCount = 0 uses every hardware core
+  explicit CpuTracer(unsigned int threadCount = 0);
+  ~CpuTracer();
+
+  // Copy the baked textures into system memory. Needs a current GL context.
+  bool loadTextures(const NoiseTexture &noise,
+                    const StarfieldCubemap &starfield);
+
+  // Trace one frame into tightly packed RGBA floats, bottom row first (the
+  // same layout as the HDR scene texture, alpha = bloom mask). 'quality'
+  // picks the same march and shading tier as the scene shader.
+  void render(const BlackHoleParams &params, const CameraParams &camParams,
+              float time, float diskPhase, int width, int height,
+              SceneQuality quality, std::vector<float> &rgba);
+
+  bool isReady() const { return m_noiseSize > 0 && m_faceSize > 0; }
+  unsigned int getThreadCount() const { return m_pool.getThreadCount(); }
+
+private:
+  ThreadPool m_pool;
+
+  // 3D noise volume, RGBA float, size^3
+  std::vector<float> m_noise;
+  int m_noiseSize = 0;
+
+  // Starfield cubemap per mip level, 6 faces of RGB half floats each
+  std::vector<std::vector<uint16_t>> m_starfield;
+  std::vector<const uint16_t *> m_starfieldLevels;
+  int m_faceSize = 0;
+};
+
+#endif // CPU_TRACER_H
@@ -0,0 +1,217 @@
+#include "DeflectionLUT.h"
+#include "HalfFloat.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Must match the march in scene_common.glsl
+static const float SCHWARZSCHILD_FACTOR = 3.0f;
+
+// The march stops once a ray heads outward beyond diskOuterRadius * 2.5; the
+// tables use the largest disk the UI allows so they don't depend on it.
+static const float EXIT_RADIUS = 20.0f;
+static const int MAX_TRACE_STEPS = 20000;
+
+namespace {
+
+struct PathSample {
+  float phi;
+  float radius;
+};
+
+struct TracedRay {
+  float exitAngle;
+  bool captured;
+  float lensing;
+  float endPhi;
+};
+
+} // namespace
+
+// Planar version of the scene_common.glsl march: the camera sits on the x axis
+// and the ray starts alpha radians off the direction to the hole.
+static TracedRay traceRay(float radius, float cameraDistance, float alpha,
+                          std::vector<PathSample> &path) {
+  float px = cameraDistance, py = 0.0f;
+  float vx = -std::cos(alpha), vy = std::sin(alpha);
+
+  TracedRay ray = {0.0f, false, 0.0f, 0.0f};
+  float phi = 0.0f;
+  float prevAngle = 0.0f;
+  float rayRadius = cameraDistance;
+
+  path.clear();
+  path.push_back({0.0f, cameraDistance});
+
+  for (int i = 0; i < MAX_TRACE_STEPS; i++) {
+    float dist = std::sqrt(px * px + py * py);
+    if (dist < radius) {
+      ray.captured = true;
+      break;
+    }
+    if (dist > EXIT_RADIUS && vx * px + vy * py > 0.0f)
+      break;
+
+    float gravity = radius * SCHWARZSCHILD_FACTOR / (dist * dist);
+    float nx = vx - px / dist * gravity * 0.15f;
+    float ny = vy - py / dist * gravity * 0.15f;
+    float len = std::sqrt(nx * nx + ny * ny);
+    nx /= len;
+    ny /= len;
+    ray.lensing += 1.0f - (vx * nx + vy * ny);
+    vx = nx;
+    vy = ny;
+
+    float stepSize = std::fmin(std::fmax((dist - radius) * 0.08f, 0.005f), 0.4f);
+    px += vx * stepSize;
+    py += vy * stepSize;
+
+    // Unwrapped polar angle; angular momentum keeps it monotonic
+    float angle = std::atan2(py, px);
+    float delta = angle - prevAngle;
+    if (delta < -3.14159265f)
+      delta += 6.28318531f;
+    else if (delta > 3.14159265f)
+      delta -= 6.28318531f;
+    phi += delta;
+    prevAngle = angle;
+    rayRadius = std::sqrt(px * px + py * py);
+    path.push_back({phi, rayRadius});
+  }
+
+  // Unwrapped direction angle, continuous with the polar angle
+  float dirAngle = std::atan2(vy, vx);
+  ray.exitAngle = dirAngle + 6.28318531f * std::round((phi - dirAngle) /
+                                                       6.28318531f);
+  ray.endPhi = phi;
+  return ray;
+}
+
+DeflectionLUT::DeflectionLUT() {}
+
+DeflectionLUT::~DeflectionLUT() { deleteResources(); }
+
+bool DeflectionLUT::update(float blackHoleRadius) {
+  if (m_initialized && blackHoleRadius == m_builtRadius)
+    return false;
+
+  build(blackHoleRadius);
+  return true;
+}
+
+void DeflectionLUT::build(float blackHoleRadius) {
+  auto start = std::chrono::steady_clock::now();
+
+  const int na = kAlphaSamples, nd = kDistanceSamples, np = kPhiSamples;
+  std::vector<float> exitData((size_t)na * nd * 4);
+  std::vector<uint16_t> orbitData((size_t)np * na * nd);
+
+  ThreadPool pool;
+  pool.parallelFor(nd, [&](int d) {
+    float cameraDistance =
+        kMinDistance + (kMaxDistance - kMinDistance) * d / (nd - 1);
+    std::vector<PathSample> path;
+    int firstEscaped = -1;
+
+    for (int a = 0; a < na; a++) {
+      // Quadratic spacing puts most samples near the capture boundary
+      float x = (float)a / (na - 1);
+      float alpha = x * x * kMaxAlpha;
+      TracedRay ray = traceRay(blackHoleRadius, cameraDistance, alpha, path);
+
+      float *texel = &exitData[((size_t)d * na + a) * 4];
+      texel[0] = ray.exitAngle;
+      texel[1] = ray.captured ? 1.0f : 0.0f;
+      texel[2] = ray.lensing;
+      texel[3] = ray.endPhi;
+      if (!ray.captured && firstEscaped < 0)
+        firstEscaped = a;
+
+      // Resample the path onto the polar angle grid. Past the end of the
+      // ray hold its last distance: either inside the horizon or beyond the
+      // disk, so interpolated lookups never land on the disk by accident.
+      uint16_t *orbit = &orbitData[((size_t)d * na + a) * np];
+      size_t s = 0;
+      for (int p = 0; p < np; p++) {
+        float phi = kMaxPhi * p / (np - 1);
+        while (s + 1 < path.size() && path[s + 1].phi < phi)
+          s++;
+        float r;
+        if (s + 1 >= path.size()) {
+          r = path.back().radius;
+        } else {
+          float span = path[s + 1].phi - path[s].phi;
+          float t = span > 0.0f ? (phi - path[s].phi) / span : 0.0f;
+          t = std::fmin(std::fmax(t, 0.0f), 1.0f);
+          r = path[s].radius + (path[s + 1].radius - path[s].radius) * t;
+        }
+        orbit[p] = floatToHalf(1.0f / r);
+      }
+    }
+
+    // Captured rays have no meaningful exit direction; copy the first
+    // escaping one so filtering across the boundary stays smooth
+    if (firstEscaped > 0) {
+      for (int a = 0; a < firstEscaped; a++) {
+        float *texel = &exitData[((size_t)d * na + a) * 4];
+        texel[0] = exitData[((size_t)d * na + firstEscaped) * 4];
+      }
+    }
+  });
+
+  if (!m_initialized) {
+    glGenTextures(1, &m_exitTexture);
+    glGenTextures(1, &m_orbitTexture);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, m_exitTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, na, nd, 0, GL_RGBA, GL_FLOAT,
+               exitData.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glBindTexture(GL_TEXTURE_3D, m_orbitTexture);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, np, na, nd, 0, GL_RED,
+               GL_HALF_FLOAT, orbitData.data());
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_3D, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  m_builtRadius = blackHoleRadius;
+  m_initialized = true;
+
+  auto elapsed = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << "Deflection LUT built for radius " << blackHoleRadius << " ("
+            << elapsed.count() << " ms)" << std::endl;
+}
+
+void DeflectionLUT::bind(unsigned int exitUnit, unsigned int orbitUnit) const {
+  glActiveTexture(GL_TEXTURE0 + exitUnit);
+  glBindTexture(GL_TEXTURE_2D, m_exitTexture);
+  glActiveTexture(GL_TEXTURE0 + orbitUnit);
+  glBindTexture(GL_TEXTURE_3D, m_orbitTexture);
+}
+
+void DeflectionLUT::deleteResources() {
+  if (!m_initialized)
+    return;
+
+  glDeleteTextures(1, &m_exitTexture);
+  glDeleteTextures(1, &m_orbitTexture);
+  m_exitTexture = 0;
+  m_orbitTexture = 0;
+  m_initialized = false;
+}
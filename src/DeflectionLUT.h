@@ -0,0 +1,53 @@
+#ifndef DEFLECTION_LUT_H
+#define DEFLECTION_LUT_H
+
+#include <glad/glad.h>
+
+// Light paths around the black hole are planar and, for a given horizon
+// radius, depend only on the camera distance and the angle between the ray
+// and the direction to the hole. This bakes those paths on the CPU so the
+// scene shader can replace its per-pixel march with a few texture fetches.
+//
+// Exit texture (2D, RGBA32F), x = sqrt(alpha / maxAlpha), y = camera distance:
+//   R = in-plane direction angle of the ray when it leaves the system
+//   G = 1 if the ray falls into the horizon
+//   B = accumulated lensing (same measure as the march)
+//   A = in-plane polar angle reached when the ray terminates
+//
+// Orbit texture (3D, R16F), x = polar angle, y/z as above:
+//   R = inverse distance from the hole at that polar angle (smooth near the
+//   horizon). Used to find where the ray crosses the disk plane for each
+//   image order.
+class DeflectionLUT {
+public:
+  static constexpr int kAlphaSamples = 512;
+  static constexpr int kDistanceSamples = 32;
+  static constexpr int kPhiSamples = 256;
+
+  static constexpr float kMaxAlpha = 1.5707963f; // 90 degrees off-axis
+  static constexpr float kMinDistance = 5.0f;    // Camera distance range
+  static constexpr float kMaxDistance = 30.0f;
+  static constexpr float kMaxPhi = 3.0f * 3.14159265f; // Three image orders
+
+  DeflectionLUT();
+  ~DeflectionLUT();
+
+  // Rebuild the tables if the horizon radius changed. Returns true if rebuilt.
+  bool update(float blackHoleRadius);
+
+  // Bind exit and orbit textures to consecutive units
+  void bind(unsigned int exitUnit, unsigned int orbitUnit) const;
+
+  bool isReady() const { return m_initialized; }
+
+private:
+  void build(float blackHoleRadius);
+  void deleteResources();
+
+  unsigned int m_exitTexture = 0;
+  unsigned int m_orbitTexture = 0;
+  float m_builtRadius = -1.0f;
+  bool m_initialized = false;
+};
+
+#endif // DEFLECTION_LUT_H
@@ -0,0 +1,68 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+
+FramePacer::FramePacer(int historySize)
+    : m_history(std::max(historySize, 1)),
+      m_historySize(std::max(historySize, 1)) {}
+
+double FramePacer::getWaitTime(double now) const {
+  if (m_pacing != FramePacing::FixedRate || m_paused)
+    return 0.0;
+  return std::max(m_nextStart - now, 0.0);
+}
+
+float FramePacer::beginFrame(double now) {
+  float step = 0.0f;
+  if (!m_paused) {
+    step = (float)(now - m_lastStart);
+    m_history[m_next] = step * 1000.0f;
+    m_next = (m_next + 1) % m_historySize;
+    m_count = std::min(m_count + 1, m_historySize);
+  }
+
+  // Start times advance by the period rather than from 'now', so wake-up
+  // latency doesn't lower the rate; once the schedule has slipped a whole
+  // period (a frame ran over) it restarts one period from now instead of
+  // letting the next frames run uncapped
+  double period = 1.0 / std::max(m_targetFps, 1.0f);
+  double scheduled = m_nextStart + period;
+  m_nextStart = m_paused || scheduled <= now ? now + period : scheduled;
+  m_lastStart = now;
+  m_paused = false;
+  return step;
+}
+
+void FramePacer::reset() {
+  m_next = 0;
+  m_count = 0;
+}
+
+FramePacer::Stats FramePacer::getStats() const {
+  Stats stats;
+  std::vector<float> samples;
+  getHistory(samples);
+  if (samples.empty())
+    return stats;
+
+  double sum = 0.0;
+  for (float ms : samples)
+    sum += ms;
+  stats.samples = (int)samples.size();
+  stats.avgMs = (float)(sum / samples.size());
+
+  std::sort(samples.begin(), samples.end());
+  stats.minMs = samples.front();
+  stats.maxMs = samples.back();
+  // Nearest-rank percentile
+  size_t rank = (size_t)(0.99 * samples.size() + 0.999);
+  stats.p99Ms = samples[std::min(std::max(rank, (size_t)1), samples.size()) - 1];
+  return stats;
+}
+
+void FramePacer::getHistory(std::vector<float> &samples) const {
+  samples.resize(m_count);
+  int first = (m_next - m_count + m_historySize) % m_historySize;
+  for (int i = 0; i < m_count; i++)
+    samples[i] = m_history[(first + i) % m_historySize];
+}
@@ -0,0 +1,68 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <vector>
+
+// When the interactive view starts a frame
+enum class FramePacing {
+  VSync,     // Swap interval 1; the display sets the rate
+  FixedRate, // No vsync; frames start at most getTargetFps() per second
+  Uncapped   // No vsync, no waiting
+};
+
+// Frame pacing and a rolling window of frame intervals (start to start).
+// Idle periods of the render-on-demand loop are not frames: after pause()
+// the next interval is dropped instead of recorded.
+class FramePacer {
+public:
+  struct Stats {
+    float minMs = 0.0f;
+    float avgMs = 0.0f;
+    float p99Ms = 0.0f;
+    float maxMs = 0.0f;
+    int samples = 0;
+  };
+
+  // historySize = intervals kept (the rolling window)
+  explicit FramePacer(int historySize = 240);
+
+  void setPacing(FramePacing pacing) { m_pacing = pacing; }
+  FramePacing getPacing() const { return m_pacing; }
+  void setTargetFps(float fps) { m_targetFps = fps; }
+  float getTargetFps() const { return m_targetFps; }
+
+  // glfwSwapInterval() value for the pacing mode
+  int getSwapInterval() const { return m_pacing == FramePacing::VSync ? 1 : 0; }
+
+  // Seconds to wait at time 'now' before the next frame may start; only
+  // FixedRate waits
+  double getWaitTime(double now) const;
+
+  // Start a frame at time 'now' (seconds). Returns the simulation step:
+  // the interval since the previous frame, or 0 for the first frame after
+  // pause().
+  float beginFrame(double now);
+  void pause() { m_paused = true; }
+
+  void reset();
+
+  Stats getStats() const;
+  // Intervals oldest first, in milliseconds
+  void getHistory(std::vector<float> &samples) const;
+
+private:
+  FramePacing m_pacing = FramePacing::VSync;
+  float m_targetFps = 60.0f;
+
+  std::vector<float> m_history; // Ring of m_historySize
+  int m_historySize;
+  int m_next = 0;
+  int m_count = 0;
+
+  double m_lastStart = 0.0;
+  // Start time the cap allows for the next frame
+  double m_nextStart = 0.0;
+  bool m_paused = true;
+};
+
+#endif // FRAME_PACER_H
@@ -0,0 +1,118 @@
+#include "GeodesicCache.h"
+#include "ShaderCache.h"
+
+#include <cstring>
+
+bool GeodesicKey::operator==(const GeodesicKey &other) const {
+  return resolution == other.resolution && tileOffset == other.tileOffset &&
+         cameraDistance == other.cameraDistance &&
+         cameraAngle == other.cameraAngle && radius == other.radius &&
+         diskInnerRadius == other.diskInnerRadius &&
+         diskOuterRadius == other.diskOuterRadius &&
+         diskThickness == other.diskThickness &&
+         deflectionLUT == other.deflectionLUT &&
+         integrator == other.integrator && quality == other.quality;
+}
+
+GeodesicCache::GeodesicCache() {}
+
+GeodesicCache::~GeodesicCache() { shutdown(); }
+
+void GeodesicCache::init(const ShaderDefines &defines) {
+  m_traceShader = ShaderCache::get("assets/shaders/vertex.glsl",
+                                   "assets/shaders/geodesic_trace.glsl",
+                                   defines);
+  m_shadeShader = ShaderCache::get("assets/shaders/vertex.glsl",
+                                   "assets/shaders/geodesic_shade.glsl",
+                                   defines);
+}
+
+void GeodesicCache::shutdown() {
+  deleteTargets();
+  m_traceShader.reset();
+  m_shadeShader.reset();
+}
+
+void GeodesicCache::ensureTargets(int width, int height) {
+  if (m_fbo != 0 && width == m_width && height == m_height)
+    return;
+  deleteTargets();
+
+  // Full float throughout: with half-float crossings, points on the disk's
+  // edges round across it and the cached frame no longer matches a direct
+  // render exactly
+  const GLenum formats[3] = {GL_RGBA32F, GL_RGBA32F, GL_RGBA32F};
+  const GLenum attachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
+                                 GL_COLOR_ATTACHMENT2};
+
+  glGenFramebuffers(1, &m_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  glGenTextures(3, m_textures);
+  for (int i = 0; i < 3; i++) {
+    glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+    glTexImage2D(GL_TEXTURE_2D, 0, formats[i], width, height, 0, GL_RGBA,
+                 GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachments[i], GL_TEXTURE_2D,
+                           m_textures[i], 0);
+  }
+  glDrawBuffers(3, attachments);
+
+  m_width = width;
+  m_height = height;
+  m_valid = false;
+}
+
+void GeodesicCache::deleteTargets() {
+  if (m_fbo != 0) {
+    glDeleteFramebuffers(1, &m_fbo);
+    glDeleteTextures(3, m_textures);
+    m_fbo = 0;
+    memset(m_textures, 0, sizeof(m_textures));
+  }
+  m_width = m_height = 0;
+  m_valid = false;
+}
+
+bool GeodesicCache::beginTrace(const GeodesicKey &key) {
+  int viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  if (m_valid && key == m_key &&
+      memcmp(viewport, m_viewport, sizeof(viewport)) == 0)
+    return false;
+
+  // Texels are addressed by gl_FragCoord, so the targets cover the
+  // viewport's far corner
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFBO);
+  ensureTargets(viewport[0] + viewport[2], viewport[1] + viewport[3]);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+  m_key = key;
+  memcpy(m_viewport, viewport, sizeof(viewport));
+  m_valid = true;
+  return true;
+}
+
+void GeodesicCache::endTrace() {
+  glBindFramebuffer(GL_FRAMEBUFFER, m_previousFBO);
+}
+
+void GeodesicCache::bind() const {
+  // Set here rather than in init() so the compile isn't waited for there
+  m_shadeShader->use();
+  m_shadeShader->setInt("u_GeodesicExit", kFirstUnit);
+  m_shadeShader->setInt("u_GeodesicCrossings01", kFirstUnit + 1);
+  m_shadeShader->setInt("u_GeodesicCrossings23", kFirstUnit + 2);
+  for (int i = 0; i < 3; i++) {
+    glActiveTexture(GL_TEXTURE0 + kFirstUnit + i);
+    glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+size_t GeodesicCache::getMemoryBytes() const {
+  return (size_t)m_width * m_height * 3 * 16;
+}
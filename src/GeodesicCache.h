@@ -0,0 +1,79 @@
+#ifndef GEODESIC_CACHE_H
+#define GEODESIC_CACHE_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "Shader.h"
+
+// Everything a ray's path depends on. Time, disk phase, colors and glow
+// only affect shading.
+struct GeodesicKey {
+  glm::vec2 resolution = glm::vec2(0.0f);
+  glm::vec2 tileOffset = glm::vec2(0.0f);
+  float cameraDistance = 0.0f;
+  float cameraAngle = 0.0f;
+  float radius = 0.0f;
+  float diskInnerRadius = 0.0f;
+  float diskOuterRadius = 0.0f;
+  float diskThickness = 0.0f;
+  bool deflectionLUT = false;
+  int integrator = 0;
+  int quality = 0;
+
+  bool operator==(const GeodesicKey &other) const;
+  bool operator!=(const GeodesicKey &other) const { return !(*this == other); }
+};
+
+// G-buffer of per-pixel geodesics for a still camera: exit direction,
+// lensing, horizon flag and up to four disk-plane crossings (see
+// geodesic_trace.glsl). beginTrace() binds it only when the key or the
+// viewport changed; otherwise frames just run the shade shader over it.
+class GeodesicCache {
+public:
+  // Texture units of the G-buffer in the shade shader (three from here)
+  static const int kFirstUnit = 6;
+
+  GeodesicCache();
+  ~GeodesicCache();
+
+  // Load the trace and shade shaders with 'defines' (the renderer's
+  // quality tier); called again when the tier changes
+  void init(const ShaderDefines &defines = ShaderDefines());
+  void shutdown();
+
+  // If the G-buffer doesn't hold 'key' at the current viewport, bind it as
+  // the render target and return true; the caller draws the trace shader
+  // and calls endTrace(). Returns false when the cached paths are valid.
+  bool beginTrace(const GeodesicKey &key);
+  // Restore the framebuffer bound before beginTrace()
+  void endTrace();
+
+  // Bind the G-buffer textures and point the shade shader's samplers at
+  // them
+  void bind() const;
+  void invalidate() { m_valid = false; }
+
+  Shader *getTraceShader() const { return m_traceShader.get(); }
+  Shader *getShadeShader() const { return m_shadeShader.get(); }
+  size_t getMemoryBytes() const;
+
+private:
+  void ensureTargets(int width, int height);
+  void deleteTargets();
+
+  std::shared_ptr<Shader> m_traceShader;
+  std::shared_ptr<Shader> m_shadeShader;
+  unsigned int m_fbo = 0;
+  unsigned int m_textures[3] = {0, 0, 0};
+  int m_width = 0;
+  int m_height = 0;
+
+  GeodesicKey m_key;
+  bool m_valid = false;
+  int m_viewport[4] = {0, 0, 0, 0};
+  int m_previousFBO = 0;
+};
+
+#endif // GEODESIC_CACHE_H
@@ -0,0 +1,191 @@
+#include "GpuProfiler.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+GpuProfiler::GpuProfiler(int historySize)
+    : m_historySize(std::max(historySize, 1)) {}
+
+GpuProfiler::~GpuProfiler() {}
+
+void GpuProfiler::shutdown() {
+  for (QuerySet &set : m_sets) {
+    if (!set.pool.empty())
+      glDeleteQueries((GLsizei)set.pool.size(), set.pool.data());
+    set.pool.clear();
+    set.issued.clear();
+  }
+  m_inFrame = false;
+  m_passDepth = 0;
+}
+
+void GpuProfiler::beginFrame() {
+  m_frame++;
+  QuerySet &set = m_sets[m_frame % 2];
+  collect(set, false);
+  set.frame = m_frame;
+  m_inFrame = true;
+}
+
+void GpuProfiler::endFrame() {
+  if (m_passDepth > 0) {
+    glEndQuery(GL_TIME_ELAPSED);
+    m_passDepth = 0;
+  }
+  m_inFrame = false;
+}
+
+void GpuProfiler::beginPass(const char *name) {
+  if (!m_inFrame)
+    return;
+  // GL has one timer query at a time: a nested pass counts towards the
+  // outermost one
+  if (m_passDepth++ > 0)
+    return;
+
+  QuerySet &set = m_sets[m_frame % 2];
+  if (set.issued.size() == set.pool.size()) {
+    unsigned int id;
+    glGenQueries(1, &id);
+    set.pool.push_back(id);
+  }
+  Query query = {set.pool[set.issued.size()], findPass(name)};
+  set.issued.push_back(query);
+
+  glBeginQuery(GL_TIME_ELAPSED, query.id);
+}
+
+void GpuProfiler::endPass() {
+  if (m_passDepth == 0 || --m_passDepth > 0)
+    return;
+  glEndQuery(GL_TIME_ELAPSED);
+}
+
+void GpuProfiler::flush() {
+  endFrame();
+  // Oldest set first, so samples stay in frame order
+  collect(m_sets[(m_frame + 1) % 2], true);
+  collect(m_sets[m_frame % 2], true);
+}
+
+void GpuProfiler::reset() {
+  for (Pass &pass : m_passes) {
+    pass.next = 0;
+    pass.count = 0;
+  }
+}
+
+int GpuProfiler::findPass(const char *name) {
+  for (size_t i = 0; i < m_passes.size(); i++) {
+    if (m_passes[i].name == name)
+      return (int)i;
+  }
+  Pass pass;
+  pass.name = name;
+  pass.history.resize(m_historySize);
+  m_passes.push_back(pass);
+  return (int)m_passes.size() - 1;
+}
+
+// Queries complete in order, so the last one being ready means all are
+void GpuProfiler::collect(QuerySet &set, bool wait) {
+  if (set.issued.empty())
+    return;
+
+  if (!wait) {
+    GLint available = 0;
+    glGetQueryObjectiv(set.issued.back().id, GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) {
+      set.issued.clear(); // Too far behind: drop rather than stall
+      return;
+    }
+  }
+
+  float frameMs = 0.0f;
+  for (const Query &query : set.issued) {
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &ns);
+    frameMs += (float)(ns / 1.0e6);
+
+    Pass &pass = m_passes[query.pass];
+    pass.history[pass.next] = {set.frame, (float)(ns / 1.0e6)};
+    pass.next = (pass.next + 1) % m_historySize;
+    pass.count = std::min(pass.count + 1, m_historySize);
+  }
+  set.issued.clear();
+
+  if (set.frame > m_lastFrame) {
+    m_lastFrame = set.frame;
+    m_lastFrameMs = frameMs;
+  }
+}
+
+GpuProfiler::Stats GpuProfiler::getStats(int pass) const {
+  Stats stats;
+  std::vector<float> samples;
+  getHistory(pass, samples);
+  if (samples.empty())
+    return stats;
+
+  double sum = 0.0;
+  for (float ms : samples)
+    sum += ms;
+  stats.samples = (int)samples.size();
+  stats.avgMs = (float)(sum / samples.size());
+
+  std::sort(samples.begin(), samples.end());
+  stats.minMs = samples.front();
+  stats.maxMs = samples.back();
+  // Nearest-rank percentile
+  size_t rank = (size_t)(0.99 * samples.size() + 0.999);
+  stats.p99Ms = samples[std::min(std::max(rank, (size_t)1), samples.size()) - 1];
+  return stats;
+}
+
+void GpuProfiler::getHistory(int pass, std::vector<float> &samples) const {
+  const Pass &p = m_passes[pass];
+  samples.resize(p.count);
+  int first = (p.next - p.count + m_historySize) % m_historySize;
+  for (int i = 0; i < p.count; i++)
+    samples[i] = p.history[(first + i) % m_historySize].ms;
+}
+
+bool GpuProfiler::writeCSV(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file) {
+    std::cerr << "Failed to open " << path << " for writing" << std::endl;
+    return false;
+  }
+
+  struct Row {
+    uint64_t frame;
+    int pass;
+    float ms;
+  };
+  std::vector<Row> rows;
+  for (size_t i = 0; i < m_passes.size(); i++) {
+    const Pass &p = m_passes[i];
+    int first = (p.next - p.count + m_historySize) % m_historySize;
+    for (int k = 0; k < p.count; k++) {
+      const Sample &sample = p.history[(first + k) % m_historySize];
+      rows.push_back({sample.frame, (int)i, sample.ms});
+    }
+  }
+  std::stable_sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+    return a.frame != b.frame ? a.frame < b.frame : a.pass < b.pass;
+  });
+
+  file << "frame,pass,gpu_ms\n";
+  for (const Row &row : rows)
+    file << row.frame << "," << m_passes[row.pass].name << "," << row.ms
+         << "\n";
+
+  std::cout << "Saved: " << path << " (" << rows.size() << " samples)"
+            << std::endl;
+  return (bool)file;
+}
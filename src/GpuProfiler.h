@@ -0,0 +1,115 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-pass GPU timings from GL_TIME_ELAPSED queries. Query sets are double
+// buffered: results of frame N are collected at the start of frame N + 2,
+// and a set that still isn't ready is dropped instead of stalling. Passes
+// must not nest (timer queries can't), and are identified by name in the
+// order they first appear.
+class GpuProfiler {
+public:
+  struct Stats {
+    float minMs = 0.0f;
+    float avgMs = 0.0f;
+    float p99Ms = 0.0f;
+    float maxMs = 0.0f;
+    int samples = 0;
+  };
+
+  // historySize = samples kept per pass (the rolling window)
+  explicit GpuProfiler(int historySize = 240);
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  void shutdown();
+
+  // Bracket every frame; beginFrame() collects the oldest query set
+  void beginFrame();
+  void endFrame();
+
+  // Passes may nest; only the outermost one is timed
+  void beginPass(const char *name);
+  void endPass();
+
+  // Block until every issued query has a result (end of a benchmark)
+  void flush();
+
+  void reset();
+
+  int getHistorySize() const { return m_historySize; }
+  int getPassCount() const { return (int)m_passes.size(); }
+  const std::string &getPassName(int pass) const { return m_passes[pass].name; }
+  Stats getStats(int pass) const;
+  // Samples oldest first, in milliseconds
+  void getHistory(int pass, std::vector<float> &samples) const;
+
+  // Sum of all passes of the most recently collected frame, and that
+  // frame's number (0 until a frame has been collected). Lags the current
+  // frame by two.
+  float getLastFrameMs() const { return m_lastFrameMs; }
+  uint64_t getLastFrame() const { return m_lastFrame; }
+
+  // One row per collected sample: frame,pass,gpu_ms
+  bool writeCSV(const std::string &path) const;
+
+private:
+  struct Sample {
+    uint64_t frame;
+    float ms;
+  };
+  struct Pass {
+    std::string name;
+    std::vector<Sample> history; // Ring of m_historySize
+    int next = 0;
+    int count = 0;
+  };
+  struct Query {
+    unsigned int id;
+    int pass;
+  };
+  struct QuerySet {
+    std::vector<unsigned int> pool;
+    std::vector<Query> issued;
+    uint64_t frame = 0;
+  };
+
+  int findPass(const char *name);
+  void collect(QuerySet &set, bool wait);
+
+  int m_historySize;
+  std::vector<Pass> m_passes;
+  QuerySet m_sets[2];
+  uint64_t m_frame = 0;
+  uint64_t m_lastFrame = 0;
+  float m_lastFrameMs = 0.0f;
+  bool m_inFrame = false;
+  int m_passDepth = 0; // Open beginPass() calls
+};
+
+// Times a scope as one pass; a null profiler makes it a no-op
+class GpuProfileScope {
+public:
+  GpuProfileScope(GpuProfiler *profiler, const char *name)
+      : m_profiler(profiler) {
+    if (m_profiler)
+      m_profiler->beginPass(name);
+  }
+  ~GpuProfileScope() {
+    if (m_profiler)
+      m_profiler->endPass();
+  }
+
+  GpuProfileScope(const GpuProfileScope &) = delete;
+  GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+  GpuProfiler *m_profiler;
+};
+
+#endif // GPU_PROFILER_H
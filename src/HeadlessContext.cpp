@@ -0,0 +1,138 @@
+#include "HeadlessContext.h"
+
+#include <glad/glad.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+HeadlessContext::HeadlessContext() {}
+
+HeadlessContext::~HeadlessContext() { shutdown(); }
+
+static bool hasExtension(const char *extensions, const char *name) {
+  if (!extensions)
+    return false;
+  size_t len = strlen(name);
+  for (const char *p = strstr(extensions, name); p; p = strstr(p + len, name)) {
+    bool startOk = (p == extensions || p[-1] == ' ');
+    bool endOk = (p[len] == ' ' || p[len] == '\0');
+    if (startOk && endOk)
+      return true;
+  }
+  return false;
+}
+
+bool HeadlessContext::init(int majorVersion, int minorVersion) {
+  if (m_initialized)
+    return true;
+
+  EGLDisplay display = EGL_NO_DISPLAY;
+
+  // Prefer the surfaceless platform: it needs neither a window system nor a
+  // DRM device and is what llvmpipe uses on GPU-less nodes.
+  const char *clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (hasExtension(clientExts, "EGL_MESA_platform_surfaceless")) {
+    auto getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+      display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+    }
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  EGLint major = 0, minor = 0;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+    std::cerr << "Failed to initialize EGL display" << std::endl;
+    return false;
+  }
+
+  const char *displayExts = eglQueryString(display, EGL_EXTENSIONS);
+  if (!hasExtension(displayExts, "EGL_KHR_surfaceless_context")) {
+    std::cerr << "EGL display does not support surfaceless contexts"
+              << std::endl;
+    eglTerminate(display);
+    return false;
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::cerr << "Failed to bind the desktop OpenGL API" << std::endl;
+    eglTerminate(display);
+    return false;
+  }
+
+  // Pick any config; we never create a surface. EGL_KHR_no_config_context
+  // lets us skip this, but not every driver exposes it.
+  EGLConfig config = nullptr;
+  EGLint numConfigs = 0;
+  const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                  EGL_NONE};
+  eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+  if (numConfigs == 0)
+    config = nullptr;
+
+  const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                   majorVersion,
+                                   EGL_CONTEXT_MINOR_VERSION,
+                                   minorVersion,
+                                   EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                   EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                   EGL_NONE};
+  EGLContext context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+  if (context == EGL_NO_CONTEXT) {
+    std::cerr << "Failed to create OpenGL " << majorVersion << "."
+              << minorVersion << " core context (EGL error 0x" << std::hex
+              << eglGetError() << std::dec << ")" << std::endl;
+    eglTerminate(display);
+    return false;
+  }
+
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    std::cerr << "Failed to make EGL context current" << std::endl;
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    return false;
+  }
+
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    std::cerr << "Failed to initialize GLAD" << std::endl;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    return false;
+  }
+
+  m_display = display;
+  m_context = context;
+  m_initialized = true;
+
+  std::cout << "Headless context: " << getRenderer() << " (EGL " << major
+            << "." << minor << ")" << std::endl;
+  return true;
+}
+
+void HeadlessContext::shutdown() {
+  if (!m_initialized)
+    return;
+
+  eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(m_display, m_context);
+  eglTerminate(m_display);
+
+  m_display = nullptr;
+  m_context = nullptr;
+  m_initialized = false;
+}
+
+const char *HeadlessContext::getRenderer() const {
+  if (!m_initialized)
+    return "";
+  return (const char *)glGetString(GL_RENDERER);
+}
@@ -0,0 +1,28 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// Opaque EGL handles, kept out of the header so callers don't need EGL/egl.h
+typedef void *HeadlessEGLDisplay;
+typedef void *HeadlessEGLContext;
+
+// Windowless OpenGL context for batch/CI rendering.
+// Uses EGL on the Mesa "surfaceless" platform, so no X server or GPU is
+// required (Mesa falls back to llvmpipe). All rendering goes to FBOs.
+class HeadlessContext {
+public:
+  HeadlessContext();
+  ~HeadlessContext();
+
+  // Create a core profile context, make it current and load GL via GLAD.
+  bool init(int majorVersion = 3, int minorVersion = 3);
+  void shutdown();
+
+  const char *getRenderer() const;
+
+private:
+  HeadlessEGLDisplay m_display = nullptr;
+  HeadlessEGLContext m_context = nullptr;
+  bool m_initialized = false;
+};
+
+#endif // HEADLESS_CONTEXT_H
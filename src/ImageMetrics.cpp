@@ -0,0 +1,122 @@
+#include "ImageMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+static const int SSIM_RADIUS = 5;
+static const float SSIM_SIGMA = 1.5f;
+static const float SSIM_C1 = (0.01f * 255.0f) * (0.01f * 255.0f);
+static const float SSIM_C2 = (0.03f * 255.0f) * (0.03f * 255.0f);
+
+static void toLuma(const uint8_t *rgb, size_t pixels, std::vector<float> &luma) {
+  luma.resize(pixels);
+  for (size_t i = 0; i < pixels; i++) {
+    luma[i] = 0.2126f * rgb[i * 3] + 0.7152f * rgb[i * 3 + 1] +
+              0.0722f * rgb[i * 3 + 2];
+  }
+}
+
+// Separable Gaussian blur with clamped edges
+static void blur(const std::vector<float> &src, int width, int height,
+                 const float *weights, std::vector<float> &dst) {
+  std::vector<float> rows(src.size());
+  for (int y = 0; y < height; y++) {
+    const float *row = &src[(size_t)y * width];
+    for (int x = 0; x < width; x++) {
+      float sum = 0.0f;
+      for (int k = -SSIM_RADIUS; k <= SSIM_RADIUS; k++)
+        sum += weights[k + SSIM_RADIUS] *
+               row[std::min(std::max(x + k, 0), width - 1)];
+      rows[(size_t)y * width + x] = sum;
+    }
+  }
+  dst.resize(src.size());
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      float sum = 0.0f;
+      for (int k = -SSIM_RADIUS; k <= SSIM_RADIUS; k++)
+        sum += weights[k + SSIM_RADIUS] *
+               rows[(size_t)std::min(std::max(y + k, 0), height - 1) * width +
+                    x];
+      dst[(size_t)y * width + x] = sum;
+    }
+  }
+}
+
+double psnrFromMSE(double mse) {
+  if (mse <= 0.0)
+    return std::numeric_limits<double>::infinity();
+  return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void computeSSIMMap(const uint8_t *image, const uint8_t *reference, int width,
+                    int height, std::vector<float> &ssim) {
+  float weights[2 * SSIM_RADIUS + 1];
+  float total = 0.0f;
+  for (int k = -SSIM_RADIUS; k <= SSIM_RADIUS; k++) {
+    weights[k + SSIM_RADIUS] =
+        std::exp(-(float)(k * k) / (2.0f * SSIM_SIGMA * SSIM_SIGMA));
+    total += weights[k + SSIM_RADIUS];
+  }
+  for (float &w : weights)
+    w /= total;
+
+  size_t pixels = (size_t)width * height;
+  std::vector<float> a, b;
+  toLuma(image, pixels, a);
+  toLuma(reference, pixels, b);
+
+  std::vector<float> aa(pixels), bb(pixels), ab(pixels);
+  for (size_t i = 0; i < pixels; i++) {
+    aa[i] = a[i] * a[i];
+    bb[i] = b[i] * b[i];
+    ab[i] = a[i] * b[i];
+  }
+
+  std::vector<float> muA, muB, sigmaAA, sigmaBB, sigmaAB;
+  blur(a, width, height, weights, muA);
+  blur(b, width, height, weights, muB);
+  blur(aa, width, height, weights, sigmaAA);
+  blur(bb, width, height, weights, sigmaBB);
+  blur(ab, width, height, weights, sigmaAB);
+
+  ssim.resize(pixels);
+  for (size_t i = 0; i < pixels; i++) {
+    float varA = sigmaAA[i] - muA[i] * muA[i];
+    float varB = sigmaBB[i] - muB[i] * muB[i];
+    float covariance = sigmaAB[i] - muA[i] * muB[i];
+    ssim[i] = ((2.0f * muA[i] * muB[i] + SSIM_C1) *
+               (2.0f * covariance + SSIM_C2)) /
+              ((muA[i] * muA[i] + muB[i] * muB[i] + SSIM_C1) *
+               (varA + varB + SSIM_C2));
+  }
+}
+
+ImageMetrics compareImages(const uint8_t *image, const uint8_t *reference,
+                           const std::vector<float> &ssim, int width,
+                           int height, const uint8_t *mask) {
+  ImageMetrics metrics;
+  double squaredError = 0.0;
+  double ssimSum = 0.0;
+  size_t pixels = (size_t)width * height;
+  for (size_t i = 0; i < pixels; i++) {
+    if (mask && !mask[i])
+      continue;
+    for (int c = 0; c < 3; c++) {
+      int error = std::abs((int)image[i * 3 + c] - (int)reference[i * 3 + c]);
+      squaredError += (double)(error * error);
+      metrics.maxError = std::max(metrics.maxError, error);
+    }
+    ssimSum += ssim[i];
+    metrics.pixels++;
+  }
+
+  if (metrics.pixels > 0) {
+    metrics.mse = squaredError / (metrics.pixels * 3.0);
+    metrics.ssim = ssimSum / metrics.pixels;
+  }
+  metrics.psnr = psnrFromMSE(metrics.mse);
+  return metrics;
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGE_METRICS_H
+#define IMAGE_METRICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Full-reference quality of a render against a reference image. Images are
+// tightly packed RGB8 of the same size and row order.
+struct ImageMetrics {
+  double mse = 0.0;  // Mean squared error per channel
+  double psnr = 0.0; // dB, peak 255; infinite for identical pixels
+  double ssim = 1.0; // Mean of the SSIM map
+  int maxError = 0;  // Largest channel difference
+  size_t pixels = 0; // Pixels scored
+};
+
+double psnrFromMSE(double mse);
+
+// Per-pixel SSIM of the Rec. 709 luma, with the usual 11x11 Gaussian
+// window (sigma 1.5) and constants for 8-bit data. Edges are clamped.
+void computeSSIMMap(const uint8_t *image, const uint8_t *reference, int width,
+                    int height, std::vector<float> &ssim);
+
+// Scores over the pixels where 'mask' is nonzero, or all if it is null.
+// 'ssim' is the map from computeSSIMMap().
+ImageMetrics compareImages(const uint8_t *image, const uint8_t *reference,
+                           const std::vector<float> &ssim, int width,
+                           int height, const uint8_t *mask = nullptr);
+
+#endif // IMAGE_METRICS_H
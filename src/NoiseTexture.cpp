@@ -1,4 +1,11 @@
 #include "NoiseTexture.h"
+#include "AssetCache.h"
+#include "HalfFloat.h"
+#include "SimdFloat.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
@@ -43,11 +50,27 @@ static const float grad3[12][3] = {
     {1, 1, 0},  {-1, 1, 0},  {1, -1, 0}, {-1, -1, 0}, {1, 0, 1},  {-1, 0, 1},
     {1, 0, -1}, {-1, 0, -1}, {0, 1, 1},  {0, -1, 1},  {0, 1, -1}, {0, -1, -1}};
 
-static inline float dot3(const float *g, float x, float y, float z) {
-  return g[0] * x + g[1] * y + g[2] * z;
+// Same as the original scalar fastfloor (x > 0 ? (int)x : (int)x - 1): a
+// true floor except that non-positive integers go down one more step
+static inline SimdFloat simdFastFloor(SimdFloat x) {
+  SimdFloat f = simdFloor(x);
+  return simdSelect((x <= SimdFloat(0.0f)) & (x == f), f - SimdFloat(1.0f), f);
+}
+
+static inline SimdFloat simdStep(SimdMask mask) {
+  return simdSelect(mask, SimdFloat(1.0f), SimdFloat(0.0f));
 }
 
-static inline int fastfloor(float x) { return x > 0 ? (int)x : (int)x - 1; }
+// Falloff contribution of one simplex corner
+static inline SimdFloat cornerContribution(SimdFloat x, SimdFloat y,
+                                           SimdFloat z, const float *gx,
+                                           const float *gy, const float *gz) {
+  SimdFloat t = SimdFloat(0.6f) - x * x - y * y - z * z;
+  t = simdMax(t, SimdFloat(0.0f));
+  t = t * t;
+  SimdFloat g = simdLoad(gx) * x + simdLoad(gy) * y + simdLoad(gz) * z;
+  return t * t * g;
+}
 
 NoiseTexture::NoiseTexture() {}
 
@@ -57,190 +80,172 @@ NoiseTexture::~NoiseTexture() {
   }
 }
 
-float NoiseTexture::snoise3D(float x, float y, float z) {
+// 3D simplex noise for kSimdWidth points at once. The lattice math runs in
+// vector registers; only the permutation lookups are done per lane.
+static SimdFloat snoise3D(SimdFloat x, SimdFloat y, SimdFloat z) {
   // Skewing factors for 3D
   const float F3 = 1.0f / 3.0f;
   const float G3 = 1.0f / 6.0f;
 
-  float s = (x + y + z) * F3;
-  int i = fastfloor(x + s);
-  int j = fastfloor(y + s);
-  int k = fastfloor(z + s);
-
-  float t = (i + j + k) * G3;
-  float X0 = i - t;
-  float Y0 = j - t;
-  float Z0 = k - t;
-  float x0 = x - X0;
-  float y0 = y - Y0;
-  float z0 = z - Z0;
-
-  int i1, j1, k1;
-  int i2, j2, k2;
-
-  if (x0 >= y0) {
-    if (y0 >= z0) {
-      i1 = 1;
-      j1 = 0;
-      k1 = 0;
-      i2 = 1;
-      j2 = 1;
-      k2 = 0;
-    } else if (x0 >= z0) {
-      i1 = 1;
-      j1 = 0;
-      k1 = 0;
-      i2 = 1;
-      j2 = 0;
-      k2 = 1;
-    } else {
-      i1 = 0;
-      j1 = 0;
-      k1 = 1;
-      i2 = 1;
-      j2 = 0;
-      k2 = 1;
-    }
-  } else {
-    if (y0 < z0) {
-      i1 = 0;
-      j1 = 0;
-      k1 = 1;
-      i2 = 0;
-      j2 = 1;
-      k2 = 1;
-    } else if (x0 < z0) {
-      i1 = 0;
-      j1 = 1;
-      k1 = 0;
-      i2 = 0;
-      j2 = 1;
-      k2 = 1;
-    } else {
-      i1 = 0;
-      j1 = 1;
-      k1 = 0;
-      i2 = 1;
-      j2 = 1;
-      k2 = 0;
+  SimdFloat s = (x + y + z) * SimdFloat(F3);
+  SimdFloat i = simdFastFloor(x + s);
+  SimdFloat j = simdFastFloor(y + s);
+  SimdFloat k = simdFastFloor(z + s);
+
+  SimdFloat t = (i + j + k) * SimdFloat(G3);
+  SimdFloat x0 = x - (i - t);
+  SimdFloat y0 = y - (j - t);
+  SimdFloat z0 = z - (k - t);
+
+  // Offsets of the second and third simplex corners, branch-free form of
+  // the usual six-way rank test
+  SimdMask xy = x0 >= y0, yz = y0 >= z0, xz = x0 >= z0;
+  SimdFloat i1 = simdStep(xy & xz);
+  SimdFloat j1 = simdStep(~xy & yz);
+  SimdFloat k1 = simdStep(~yz & ~xz);
+  SimdFloat i2 = simdStep(xy | xz);
+  SimdFloat j2 = simdStep(~xy | yz);
+  SimdFloat k2 = simdStep(~yz | (~xy & ~xz));
+
+  SimdFloat x1 = x0 - i1 + SimdFloat(G3);
+  SimdFloat y1 = y0 - j1 + SimdFloat(G3);
+  SimdFloat z1 = z0 - k1 + SimdFloat(G3);
+  SimdFloat x2 = x0 - i2 + SimdFloat(2.0f * G3);
+  SimdFloat y2 = y0 - j2 + SimdFloat(2.0f * G3);
+  SimdFloat z2 = z0 - k2 + SimdFloat(2.0f * G3);
+  SimdFloat x3 = x0 - SimdFloat(1.0f - 3.0f * G3);
+  SimdFloat y3 = y0 - SimdFloat(1.0f - 3.0f * G3);
+  SimdFloat z3 = z0 - SimdFloat(1.0f - 3.0f * G3);
+
+  // Gather gradients per lane
+  alignas(64) float cell[9][kSimdWidth];
+  simdStore(cell[0], i);
+  simdStore(cell[1], j);
+  simdStore(cell[2], k);
+  simdStore(cell[3], i1);
+  simdStore(cell[4], j1);
+  simdStore(cell[5], k1);
+  simdStore(cell[6], i2);
+  simdStore(cell[7], j2);
+  simdStore(cell[8], k2);
+
+  alignas(64) float grad[4][3][kSimdWidth];
+  for (int lane = 0; lane < kSimdWidth; lane++) {
+    int ii = (int)cell[0][lane] & 255;
+    int jj = (int)cell[1][lane] & 255;
+    int kk = (int)cell[2][lane] & 255;
+    int oi1 = (int)cell[3][lane], oj1 = (int)cell[4][lane];
+    int ok1 = (int)cell[5][lane];
+    int oi2 = (int)cell[6][lane], oj2 = (int)cell[7][lane];
+    int ok2 = (int)cell[8][lane];
+
+    int gi[4] = {perm[ii + perm[jj + perm[kk]]] % 12,
+                 perm[ii + oi1 + perm[jj + oj1 + perm[kk + ok1]]] % 12,
+                 perm[ii + oi2 + perm[jj + oj2 + perm[kk + ok2]]] % 12,
+                 perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]] % 12};
+    for (int c = 0; c < 4; c++) {
+      grad[c][0][lane] = grad3[gi[c]][0];
+      grad[c][1][lane] = grad3[gi[c]][1];
+      grad[c][2][lane] = grad3[gi[c]][2];
     }
   }
 
-  float x1 = x0 - i1 + G3;
-  float y1 = y0 - j1 + G3;
-  float z1 = z0 - k1 + G3;
-  float x2 = x0 - i2 + 2.0f * G3;
-  float y2 = y0 - j2 + 2.0f * G3;
-  float z2 = z0 - k2 + 2.0f * G3;
-  float x3 = x0 - 1.0f + 3.0f * G3;
-  float y3 = y0 - 1.0f + 3.0f * G3;
-  float z3 = z0 - 1.0f + 3.0f * G3;
-
-  int ii = i & 255;
-  int jj = j & 255;
-  int kk = k & 255;
-
-  int gi0 = perm[ii + perm[jj + perm[kk]]] % 12;
-  int gi1 = perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]] % 12;
-  int gi2 = perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]] % 12;
-  int gi3 = perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]] % 12;
-
-  float n0, n1, n2, n3;
-
-  float t0 = 0.6f - x0 * x0 - y0 * y0 - z0 * z0;
-  if (t0 < 0)
-    n0 = 0.0f;
-  else {
-    t0 *= t0;
-    n0 = t0 * t0 * dot3(grad3[gi0], x0, y0, z0);
-  }
-
-  float t1 = 0.6f - x1 * x1 - y1 * y1 - z1 * z1;
-  if (t1 < 0)
-    n1 = 0.0f;
-  else {
-    t1 *= t1;
-    n1 = t1 * t1 * dot3(grad3[gi1], x1, y1, z1);
-  }
-
-  float t2 = 0.6f - x2 * x2 - y2 * y2 - z2 * z2;
-  if (t2 < 0)
-    n2 = 0.0f;
-  else {
-    t2 *= t2;
-    n2 = t2 * t2 * dot3(grad3[gi2], x2, y2, z2);
-  }
-
-  float t3 = 0.6f - x3 * x3 - y3 * y3 - z3 * z3;
-  if (t3 < 0)
-    n3 = 0.0f;
-  else {
-    t3 *= t3;
-    n3 = t3 * t3 * dot3(grad3[gi3], x3, y3, z3);
-  }
+  SimdFloat n = cornerContribution(x0, y0, z0, grad[0][0], grad[0][1], grad[0][2]);
+  n += cornerContribution(x1, y1, z1, grad[1][0], grad[1][1], grad[1][2]);
+  n += cornerContribution(x2, y2, z2, grad[2][0], grad[2][1], grad[2][2]);
+  n += cornerContribution(x3, y3, z3, grad[3][0], grad[3][1], grad[3][2]);
 
   // Scale to [-1, 1]
-  return 32.0f * (n0 + n1 + n2 + n3);
+  return SimdFloat(32.0f) * n;
 }
 
-void NoiseTexture::generate(int size) {
-  m_size = size;
+// Bake one z-slice as RGBA half floats
+static void generateSlice(int size, int z, uint16_t *out) {
+  // Scale to create good detail (4 tiles across the texture)
+  const float scale = 4.0f;
+  const float pz = (float)z / (float)size * scale;
 
-  // RGBA: 4 channels, each with different noise characteristics
-  // R = base noise (1x frequency)
-  // G = 2x frequency
-  // B = 4x frequency
-  // A = different seed (for variation)
-  std::vector<float> data(size * size * size * 4);
+  alignas(64) float px[kSimdWidth];
+  alignas(64) float channel[4][kSimdWidth];
 
-  std::cout << "Generating " << size << "^3 RGBA noise texture..." << std::endl;
+  for (int y = 0; y < size; y++) {
+    float py = (float)y / (float)size * scale;
 
-  for (int z = 0; z < size; z++) {
-    for (int y = 0; y < size; y++) {
-      for (int x = 0; x < size; x++) {
-        // Normalized coordinates [0, 1] mapped to noise space
-        // We use a period that tiles seamlessly
-        float fx = (float)x / (float)size;
-        float fy = (float)y / (float)size;
-        float fz = (float)z / (float)size;
-
-        // Scale to create good detail (4 tiles across the texture)
-        float scale = 4.0f;
-        float px = fx * scale;
-        float py = fy * scale;
-        float pz = fz * scale;
-
-        // R: Base noise (1x frequency), range [-1, 1] -> [0, 1]
-        float r = snoise3D(px, py, pz);
-        r = r * 0.5f + 0.5f;
-
-        // G: 2x frequency
-        float g = snoise3D(px * 2.0f, py * 2.0f, pz * 2.0f);
-        g = g * 0.5f + 0.5f;
-
-        // B: 4x frequency
-        float b = snoise3D(px * 4.0f, py * 4.0f, pz * 4.0f);
-        b = b * 0.5f + 0.5f;
-
-        // A: Different seed (offset by large amount)
-        float a = snoise3D(px + 100.0f, py + 200.0f, pz + 300.0f);
-        a = a * 0.5f + 0.5f;
-
-        int idx = (z * size * size + y * size + x) * 4;
-        data[idx + 0] = r;
-        data[idx + 1] = g;
-        data[idx + 2] = b;
-        data[idx + 3] = a;
+    for (int x0 = 0; x0 < size; x0 += kSimdWidth) {
+      // Normalized coordinates [0, 1] mapped to noise space; the last batch
+      // repeats its final column if size isn't a multiple of the lane count
+      for (int lane = 0; lane < kSimdWidth; lane++) {
+        int x = x0 + lane < size ? x0 + lane : size - 1;
+        px[lane] = (float)x / (float)size * scale;
+      }
+      SimdFloat vx = simdLoad(px);
+      SimdFloat vy(py), vz(pz);
+      SimdFloat half(0.5f);
+
+      // R: Base noise (1x frequency), range [-1, 1] -> [0, 1]
+      simdStore(channel[0], snoise3D(vx, vy, vz) * half + half);
+      // G: 2x frequency
+      SimdFloat two(2.0f);
+      simdStore(channel[1], snoise3D(vx * two, vy * two, vz * two) * half + half);
+      // B: 4x frequency
+      SimdFloat four(4.0f);
+      simdStore(channel[2], snoise3D(vx * four, vy * four, vz * four) * half + half);
+      // A: Different seed (offset by large amount)
+      simdStore(channel[3], snoise3D(vx + SimdFloat(100.0f), vy + SimdFloat(200.0f),
+                                     vz + SimdFloat(300.0f)) * half + half);
+
+      int count = size - x0 < kSimdWidth ? size - x0 : kSimdWidth;
+      uint16_t *texel = out + ((size_t)y * size + x0) * 4;
+      for (int lane = 0; lane < count; lane++) {
+        texel[lane * 4 + 0] = floatToHalf(channel[0][lane]);
+        texel[lane * 4 + 1] = floatToHalf(channel[1][lane]);
+        texel[lane * 4 + 2] = floatToHalf(channel[2][lane]);
+        texel[lane * 4 + 3] = floatToHalf(channel[3][lane]);
       }
     }
   }
+}
+
+// Bump when the bake changes in a way the tables below don't capture
+static const uint32_t NOISE_GENERATOR_REVISION = 2;
+
+static AssetCacheHeader noiseCacheHeader(int size) {
+  AssetCacheHeader header = makeAssetCacheHeader();
+  header.internalFormat = GL_RGBA16F;
+  header.format = GL_RGBA;
+  header.type = GL_HALF_FLOAT;
+  header.width = header.height = header.depth = (uint32_t)size;
+  header.levels = 1;
+  header.params[0] = 4.0f; // Tiles across the texture
+  header.sourceHash = hashBytes(&NOISE_GENERATOR_REVISION,
+                                sizeof(NOISE_GENERATOR_REVISION));
+  header.sourceHash = hashBytes(perm, sizeof(perm), header.sourceHash);
+  header.sourceHash = hashBytes(grad3, sizeof(grad3), header.sourceHash);
+  header.payloadSize = (uint64_t)size * size * size * 4 * sizeof(uint16_t);
+  return header;
+}
+
+void NoiseTexture::generate(int size) {
+  m_size = size;
+  auto start = std::chrono::steady_clock::now();
 
-  // Upload to GPU as RGBA16F for precision
   glGenTextures(1, &m_textureID);
   glBindTexture(GL_TEXTURE_3D, m_textureID);
 
-  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, size, size, size, 0, GL_RGBA,
-               GL_FLOAT, data.data());
+  // Warm start: upload straight from the mapped cache file
+  const AssetCacheHeader header = noiseCacheHeader(size);
+  const std::string cachePath =
+      assetCachePath("noise_" + std::to_string(size) + ".bhc");
+  MappedAssetCache cached;
+  bool fromCache = cached.open(cachePath, header);
+
+  if (fromCache) {
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, size, size, size, 0, GL_RGBA,
+                 GL_HALF_FLOAT, cached.getPayload());
+    cached.close();
+  } else {
+    bake(size, cachePath, header);
+  }
 
   // Use linear filtering for smooth interpolation
   glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -254,8 +259,52 @@ void NoiseTexture::generate(int size) {
   glBindTexture(GL_TEXTURE_3D, 0);
   m_initialized = true;
 
+  auto elapsed = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start);
   std::cout << "Noise texture ready (" << size * size * size * 4 * 2 / 1024
-            << " KB)" << std::endl;
+            << " KB, " << elapsed.count() << " ms"
+            << (fromCache ? ", cached" : "") << ")" << std::endl;
+}
+
+void NoiseTexture::bake(int size, const std::string &cachePath,
+                        const AssetCacheHeader &header) {
+  // RGBA: 4 channels, each with different noise characteristics
+  // R = base noise (1x frequency)
+  // G = 2x frequency
+  // B = 4x frequency
+  // A = different seed (for variation)
+  std::cout << "Generating " << size << "^3 RGBA noise texture..." << std::endl;
+
+  // Allocate as RGBA16F for precision, then fill slice by slice
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, size, size, size, 0, GL_RGBA,
+               GL_HALF_FLOAT, nullptr);
+
+  // Slices are streamed to the cache file as they are uploaded
+  AssetCacheWriter writer;
+  writer.begin(cachePath, header);
+
+  // Bake a batch of z-slices across the pool, upload them, reuse the
+  // staging memory for the next batch
+  ThreadPool pool;
+  const int batchSlices = (int)pool.getThreadCount() * 2;
+  const size_t sliceTexels = (size_t)size * size * 4;
+  std::vector<uint16_t> staging(sliceTexels * batchSlices);
+
+  for (int z0 = 0; z0 < size; z0 += batchSlices) {
+    int count = size - z0 < batchSlices ? size - z0 : batchSlices;
+    pool.parallelFor(count, [&](int s) {
+      generateSlice(size, z0 + s, &staging[sliceTexels * s]);
+    });
+    for (int s = 0; s < count; s++) {
+      glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z0 + s, size, size, 1, GL_RGBA,
+                      GL_HALF_FLOAT, &staging[sliceTexels * s]);
+    }
+    if (writer.isOpen())
+      writer.write(staging.data(), sliceTexels * count * sizeof(uint16_t));
+  }
+
+  if (writer.isOpen())
+    writer.commit();
 }
 
 void NoiseTexture::bind(unsigned int unit) const {
@@ -2,6 +2,9 @@
 #define NOISE_TEXTURE_H
 
 #include <glad/glad.h>
+#include <string>
+
+struct AssetCacheHeader;
 
 class NoiseTexture {
 public:
@@ -11,6 +14,8 @@ public:
   // Generate a 3D noise texture with multiple octaves in RGBA channels
   // R = base noise, G = 2x freq, B = 4x freq, A = alternate seed
   // Size should be power of 2 for seamless tiling (64, 128)
+  // Baked across all cores in z-slices and uploaded as half floats; loaded
+  // from the asset cache instead when a matching entry exists
   void generate(int size = 128);
 
   // Bind the texture to a texture unit
@@ -20,8 +25,8 @@ public:
   int getSize() const { return m_size; }
 
 private:
-  // 3D Simplex noise implementation (CPU-side for baking)
-  float snoise3D(float x, float y, float z);
+  void bake(int size, const std::string &cachePath,
+            const AssetCacheHeader &header);
 
   unsigned int m_textureID = 0;
   int m_size = 0;
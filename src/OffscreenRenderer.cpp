@@ -0,0 +1,289 @@
+#include "OffscreenRenderer.h"
+
+#include "PngStreamWriter.h"
+#include "stb_image_write.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+OffscreenRenderer::OffscreenRenderer() {}
+
+OffscreenRenderer::~OffscreenRenderer() { shutdown(); }
+
+bool OffscreenRenderer::init(int width, int height) {
+  if (m_initialized)
+    return true;
+
+  m_width = width;
+  m_height = height;
+
+  m_bloomRenderer.init(width, height);
+  m_blackHoleRenderer.init(width, height);
+  createOutputTarget();
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "Offscreen framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return false;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  m_bloomRenderer.setOutputFBO(m_outputFBO);
+  m_initialized = true;
+  return true;
+}
+
+void OffscreenRenderer::createOutputTarget() {
+  glGenFramebuffers(1, &m_outputFBO);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+  glGenTextures(1, &m_outputTexture);
+  glBindTexture(GL_TEXTURE_2D, m_outputTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, m_width, m_height, 0, GL_RGB,
+               GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         m_outputTexture, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenRenderer::deleteOutputTarget() {
+  if (m_outputFBO != 0) {
+    glDeleteFramebuffers(1, &m_outputFBO);
+    glDeleteTextures(1, &m_outputTexture);
+    m_outputFBO = 0;
+    m_outputTexture = 0;
+  }
+}
+
+void OffscreenRenderer::resize(int width, int height) {
+  if (!m_initialized || (width == m_width && height == m_height))
+    return;
+
+  m_width = width;
+  m_height = height;
+  m_bloomRenderer.resize(width, height);
+
+  glBindTexture(GL_TEXTURE_2D, m_outputTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB,
+               GL_UNSIGNED_BYTE, NULL);
+}
+
+void OffscreenRenderer::render(const RenderSettings &settings) {
+  if (!m_initialized)
+    return;
+
+  resize(settings.width, settings.height);
+  renderFrame(settings, settings.width, settings.height, 0, 0);
+}
+
+// Render the window of the full image starting at (originX, originY),
+// bottom-left origin, sized to the current target
+void OffscreenRenderer::renderFrame(const RenderSettings &settings,
+                                    int imageWidth, int imageHeight,
+                                    int originX, int originY) {
+  applySceneSettings(settings);
+  m_blackHoleRenderer.setTileOffset(glm::vec2(originX, originY));
+
+  // Render scene to bloom FBO
+  m_bloomRenderer.beginScene(settings.bloom);
+
+  unsigned int quadVAO = m_blackHoleRenderer.getQuadVAO();
+  if (settings.cpuTracer) {
+    renderSceneCpu(settings);
+    if (settings.bloom.enabled)
+      m_bloomRenderer.extractBright(settings.bloom, quadVAO);
+  } else {
+    m_blackHoleRenderer.render(settings.time, imageWidth, imageHeight);
+  }
+
+  // Post-process into the output FBO. A window smaller than the image is a
+  // tile, which takes its bloom from the whole-image pyramid.
+  if (settings.bloom.enabled &&
+      (imageWidth != m_width || imageHeight != m_height)) {
+    m_bloomRenderer.compositeTile(settings.bloom, quadVAO,
+                                  glm::vec2(originX, originY),
+                                  glm::vec2(imageWidth, imageHeight));
+  } else if (settings.bloom.enabled) {
+    m_bloomRenderer.applyBloom(settings.bloom, quadVAO);
+  } else {
+    m_bloomRenderer.renderWithoutBloom(settings.bloom, quadVAO);
+  }
+}
+
+// Bloom pyramid shared by all tiles, from a render of the whole image at
+// the pyramid's base size
+void OffscreenRenderer::renderBloomPyramid(const RenderSettings &settings) {
+  applySceneSettings(settings);
+  m_blackHoleRenderer.setTileOffset(glm::vec2(0.0f));
+
+  glm::ivec2 size = m_bloomRenderer.beginPyramid(
+      settings.width, settings.height, settings.bloom);
+  m_blackHoleRenderer.render(settings.time, size.x, size.y);
+  m_bloomRenderer.buildPyramid(settings.bloom,
+                               m_blackHoleRenderer.getQuadVAO());
+}
+
+void OffscreenRenderer::applySceneSettings(const RenderSettings &settings) {
+  m_blackHoleRenderer.getParams() = settings.blackHole;
+  m_blackHoleRenderer.getCameraParams() = settings.camera;
+  m_blackHoleRenderer.getOptions() = settings.options;
+  m_blackHoleRenderer.setDiskPhase(settings.resolvedDiskPhase());
+}
+
+void OffscreenRenderer::renderSceneCpu(const RenderSettings &settings) {
+  // The tracer keeps its own copy of the textures
+  if (m_blackHoleRenderer.updateAssets())
+    m_cpuTracer.reset();
+
+  if (!m_cpuTracer) {
+    m_cpuTracer.reset(new CpuTracer(settings.threads));
+    m_cpuTracer->loadTextures(m_blackHoleRenderer.getNoiseTexture(),
+                              m_blackHoleRenderer.getStarfieldCubemap());
+  }
+
+  m_cpuTracer->render(settings.blackHole, settings.camera, settings.time,
+                      settings.resolvedDiskPhase(), m_width, m_height,
+                      settings.options.quality, m_cpuPixels);
+
+  // Same layout as the scene FBO, so bloom runs unchanged
+  glBindTexture(GL_TEXTURE_2D, m_bloomRenderer.getSceneTexture());
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_FLOAT,
+                  m_cpuPixels.data());
+}
+
+void OffscreenRenderer::readPixels(std::vector<unsigned char> &pixels) const {
+  std::vector<unsigned char> raw(m_width * m_height * 3);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, raw.data());
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  // Flip vertically (OpenGL reads bottom-to-top)
+  pixels.resize(raw.size());
+  for (int y = 0; y < m_height; y++) {
+    memcpy(&pixels[y * m_width * 3], &raw[(m_height - 1 - y) * m_width * 3],
+           m_width * 3);
+  }
+}
+
+bool OffscreenRenderer::savePNG(const std::string &path) const {
+  std::vector<unsigned char> raw((size_t)m_width * m_height * 3);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, raw.data());
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  // Write from the last GL row with a negative stride instead of flipping
+  int stride = m_width * 3;
+  if (!stbi_write_png(path.c_str(), m_width, m_height, 3,
+                      &raw[(size_t)(m_height - 1) * stride], -stride)) {
+    std::cerr << "Failed to save image: " << path << std::endl;
+    return false;
+  }
+
+  std::cout << "Saved: " << path << " (" << m_width << "x" << m_height << ")"
+            << std::endl;
+  return true;
+}
+
+bool OffscreenRenderer::renderTiledPNG(const RenderSettings &settings,
+                                       int tileSize, const std::string &path) {
+  if (!m_initialized)
+    return false;
+  if (settings.cpuTracer) {
+    std::cerr << "Tiled rendering is not supported with the CPU tracer"
+              << std::endl;
+    return false;
+  }
+
+  // Tile offsets are in full-resolution pixels, so tiles march at full
+  // resolution
+  RenderSettings tileSettings = settings;
+  tileSettings.options.resolutionScale = 1.0f;
+
+  const int width = settings.width;
+  const int height = settings.height;
+  tileSize = std::max(tileSize, 16);
+
+  // Every tile renders a full window; windows at the right and top edges
+  // are shifted back inside the image and overlap their neighbours
+  int windowWidth = std::min(width, tileSize);
+  int windowHeight = std::min(height, tileSize);
+  resize(windowWidth, windowHeight);
+  if (settings.bloom.enabled &&
+      (windowWidth != width || windowHeight != height))
+    renderBloomPyramid(tileSettings);
+
+  PngStreamWriter writer;
+  if (!writer.open(path, width, height))
+    return false;
+
+  auto start = std::chrono::steady_clock::now();
+  int tilesX = (width + tileSize - 1) / tileSize;
+  int tilesY = (height + tileSize - 1) / tileSize;
+
+  // One row of tiles, bottom-up as GL returns it
+  std::vector<unsigned char> band((size_t)width * tileSize * 3);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  bool ok = true;
+  for (int ty = 0; ty < tilesY && ok; ty++) {
+    // Image rows go top-down, GL rows bottom-up
+    int top = ty * tileSize;
+    int rows = std::min(tileSize, height - top);
+    int tileY = height - top - rows;
+    int originY = std::min(tileY, height - windowHeight);
+
+    for (int tx = 0; tx < tilesX; tx++) {
+      int tileX = tx * tileSize;
+      int columns = std::min(tileSize, width - tileX);
+      int originX = std::min(tileX, width - windowWidth);
+
+      renderFrame(tileSettings, width, height, originX, originY);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+      glPixelStorei(GL_PACK_ROW_LENGTH, width);
+      glReadPixels(tileX - originX, tileY - originY, columns, rows, GL_RGB,
+                   GL_UNSIGNED_BYTE, &band[(size_t)tileX * 3]);
+      glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    }
+
+    // Last GL row first; no flip copy needed
+    ptrdiff_t stride = (ptrdiff_t)width * 3;
+    ok = writer.writeRows(&band[(size_t)(rows - 1) * stride], rows, -stride);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  m_blackHoleRenderer.setTileOffset(glm::vec2(0.0f));
+
+  ok = writer.close() && ok;
+  if (!ok) {
+    std::cerr << "Failed to save image: " << path << std::endl;
+    return false;
+  }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cout << "Saved: " << path << " (" << width << "x" << height << ", "
+            << tilesX * tilesY << " tiles, " << seconds << " s)" << std::endl;
+  return true;
+}
+
+void OffscreenRenderer::shutdown() {
+  if (!m_initialized)
+    return;
+
+  m_cpuTracer.reset();
+  m_blackHoleRenderer.shutdown();
+  m_bloomRenderer.shutdown();
+  deleteOutputTarget();
+  m_bloomRenderer.setOutputFBO(0);
+
+  m_initialized = false;
+}
@@ -0,0 +1,76 @@
+#ifndef OFFSCREEN_RENDERER_H
+#define OFFSCREEN_RENDERER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BlackHoleRenderer.h"
+#include "BloomRenderer.h"
+#include "CpuTracer.h"
+#include "RenderSettings.h"
+
+// The full scene + bloom pipeline rendering into an LDR FBO instead of a
+// window. Used by the headless CLI; needs a current GL context but no ImGui.
+class OffscreenRenderer {
+public:
+  OffscreenRenderer();
+  ~OffscreenRenderer();
+
+  bool init(int width, int height);
+  void resize(int width, int height);
+  void shutdown();
+
+  // Render one frame with the given settings into the output FBO
+  void render(const RenderSettings &settings);
+
+  // Read back the last frame as tightly packed RGB8, top row first
+  void readPixels(std::vector<unsigned char> &pixels) const;
+
+  // Read back the last frame and write it as PNG
+  bool savePNG(const std::string &path) const;
+
+  // Render settings.width x settings.height in tiles of about tileSize
+  // pixels and stream each finished row of tiles into a PNG. GPU and CPU
+  // memory stay bounded by the tile size, not the image size. Resizes the
+  // output target to the tile window.
+  bool renderTiledPNG(const RenderSettings &settings, int tileSize,
+                      const std::string &path);
+
+  // Time the scene and post-processing passes (null disables)
+  void setProfiler(GpuProfiler *profiler) {
+    m_blackHoleRenderer.setProfiler(profiler);
+    m_bloomRenderer.setProfiler(profiler);
+  }
+
+  BlackHoleRenderer &getBlackHoleRenderer() { return m_blackHoleRenderer; }
+  BloomRenderer &getBloomRenderer() { return m_bloomRenderer; }
+  unsigned int getOutputFBO() const { return m_outputFBO; }
+  int getWidth() const { return m_width; }
+  int getHeight() const { return m_height; }
+
+private:
+  void createOutputTarget();
+  void deleteOutputTarget();
+  void renderFrame(const RenderSettings &settings, int imageWidth,
+                   int imageHeight, int originX, int originY);
+  void renderBloomPyramid(const RenderSettings &settings);
+  void applySceneSettings(const RenderSettings &settings);
+  void renderSceneCpu(const RenderSettings &settings);
+
+  BlackHoleRenderer m_blackHoleRenderer;
+  BloomRenderer m_bloomRenderer;
+
+  // Created on first use of RenderSettings::cpuTracer
+  std::unique_ptr<CpuTracer> m_cpuTracer;
+  std::vector<float> m_cpuPixels;
+
+  unsigned int m_outputFBO = 0;
+  unsigned int m_outputTexture = 0;
+
+  int m_width = 0;
+  int m_height = 0;
+  bool m_initialized = false;
+};
+
+#endif // OFFSCREEN_RENDERER_H
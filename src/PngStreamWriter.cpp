@@ -0,0 +1,393 @@
+#include "PngStreamWriter.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static const int WINDOW_SIZE = 32768;
+static const int HASH_BITS = 15;
+static const int MAX_CHAIN = 8;
+static const int MIN_MATCH = 3;
+static const int MAX_MATCH = 258;
+static const size_t IDAT_SIZE = 1 << 16;
+
+static const int LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10,  11,  13,
+                                    15, 17, 19, 23, 27, 31, 35, 43,  51,  59,
+                                    67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                     1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                     4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int DIST_BASE[30] = {1,    2,    3,    4,     5,     7,    9,
+                                  13,   17,   25,   33,    49,    65,   97,
+                                  129,  193,  257,  385,   513,   769,  1025,
+                                  1537, 2049, 3073, 4097,  6145,  8193, 12289,
+                                  16385, 24577};
+static const int DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                   4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                   9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static uint32_t crcTable[256];
+
+static void initCrcTable() {
+  static bool initialized = false;
+  if (initialized)
+    return;
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++)
+      c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+    crcTable[n] = c;
+  }
+  initialized = true;
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+static void putBigEndian32(uint8_t *out, uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+}
+
+static uint32_t reverseBits(uint32_t code, int length) {
+  uint32_t result = 0;
+  for (int i = 0; i < length; i++) {
+    result = (result << 1) | (code & 1);
+    code >>= 1;
+  }
+  return result;
+}
+
+// Index of the last table entry <= value
+static int findCode(const int *base, int count, int value) {
+  int code = 0;
+  while (code + 1 < count && base[code + 1] <= value)
+    code++;
+  return code;
+}
+
+PngStreamWriter::PngStreamWriter() {}
+
+PngStreamWriter::~PngStreamWriter() {
+  if (m_file) {
+    std::fclose(m_file);
+    m_file = nullptr;
+  }
+}
+
+bool PngStreamWriter::open(const std::string &path, int width, int height) {
+  initCrcTable();
+  if (width <= 0 || height <= 0)
+    return false;
+
+  m_file = std::fopen(path.c_str(), "wb");
+  if (!m_file) {
+    std::cerr << "Failed to open " << path << " for writing" << std::endl;
+    return false;
+  }
+
+  m_path = path;
+  m_width = width;
+  m_height = height;
+  m_rowsWritten = 0;
+  m_failed = false;
+
+  size_t rowBytes = (size_t)width * 3;
+  m_previousRow.assign(rowBytes, 0);
+  for (int f = 0; f < 5; f++) {
+    m_filtered[f].assign(rowBytes + 1, 0);
+    m_filtered[f][0] = (uint8_t)f;
+  }
+
+  m_window.clear();
+  m_windowStart = 0;
+  m_head.assign((size_t)1 << HASH_BITS, -1);
+  m_prev.assign(WINDOW_SIZE, -1);
+  m_adler = 1;
+  m_bitBuffer = 0;
+  m_bitCount = 0;
+  m_output.clear();
+
+  static const uint8_t signature[8] = {0x89, 'P',  'N',  'G',
+                                       '\r', '\n', 0x1a, '\n'};
+  if (std::fwrite(signature, 1, 8, m_file) != 8)
+    m_failed = true;
+
+  uint8_t ihdr[13];
+  putBigEndian32(ihdr, (uint32_t)width);
+  putBigEndian32(ihdr + 4, (uint32_t)height);
+  ihdr[8] = 8;  // Bit depth
+  ihdr[9] = 2;  // Truecolor RGB
+  ihdr[10] = 0; // Deflate
+  ihdr[11] = 0; // Adaptive filtering
+  ihdr[12] = 0; // No interlace
+  writeChunk("IHDR", ihdr, sizeof(ihdr));
+
+  // zlib header: 32K window, no preset dictionary
+  m_output.push_back(0x78);
+  m_output.push_back(0x01);
+  return !m_failed;
+}
+
+bool PngStreamWriter::writeRows(const unsigned char *rows, int count,
+                                ptrdiff_t stride) {
+  if (!m_file || m_failed)
+    return false;
+  if (m_rowsWritten + count > m_height) {
+    std::cerr << "PngStreamWriter: too many rows for " << m_path << std::endl;
+    return false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    filterRow(rows + stride * i);
+    m_rowsWritten++;
+  }
+  flushOutput(false);
+  return !m_failed;
+}
+
+// Pick the PNG filter with the smallest sum of absolute residuals (the
+// usual heuristic), then deflate the filtered row
+void PngStreamWriter::filterRow(const unsigned char *row) {
+  const int bpp = 3;
+  const size_t n = (size_t)m_width * 3;
+  const uint8_t *up = m_previousRow.data();
+
+  long best = -1;
+  int bestFilter = 0;
+  for (int f = 0; f < 5; f++) {
+    uint8_t *out = m_filtered[f].data() + 1;
+    long sum = 0;
+    for (size_t i = 0; i < n; i++) {
+      int a = i >= bpp ? row[i - bpp] : 0;
+      int b = up[i];
+      int c = i >= bpp ? up[i - bpp] : 0;
+      int predictor;
+      switch (f) {
+      case 0:
+        predictor = 0;
+        break;
+      case 1:
+        predictor = a;
+        break;
+      case 2:
+        predictor = b;
+        break;
+      case 3:
+        predictor = (a + b) >> 1;
+        break;
+      default: {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        break;
+      }
+      }
+      uint8_t value = (uint8_t)(row[i] - predictor);
+      out[i] = value;
+      sum += value < 128 ? value : 256 - value;
+    }
+    if (best < 0 || sum < best) {
+      best = sum;
+      bestFilter = f;
+    }
+  }
+
+  compress(m_filtered[bestFilter].data(), n + 1);
+  memcpy(m_previousRow.data(), row, n);
+}
+
+void PngStreamWriter::putBits(uint32_t value, int count) {
+  m_bitBuffer |= (uint64_t)value << m_bitCount;
+  m_bitCount += count;
+  while (m_bitCount >= 8) {
+    m_output.push_back((uint8_t)m_bitBuffer);
+    m_bitBuffer >>= 8;
+    m_bitCount -= 8;
+  }
+}
+
+// Huffman codes are defined MSB first but packed LSB first
+void PngStreamWriter::putHuffman(uint32_t code, int length) {
+  putBits(reverseBits(code, length), length);
+}
+
+// Fixed literal/length code table (RFC 1951, 3.2.6)
+void PngStreamWriter::putLiteral(int literal) {
+  if (literal < 144)
+    putHuffman(0x30 + literal, 8);
+  else if (literal < 256)
+    putHuffman(0x190 + literal - 144, 9);
+  else if (literal < 280)
+    putHuffman(literal - 256, 7);
+  else
+    putHuffman(0xc0 + literal - 280, 8);
+}
+
+void PngStreamWriter::putMatch(int length, int distance) {
+  int lengthCode = findCode(LENGTH_BASE, 29, length);
+  putLiteral(257 + lengthCode);
+  putBits((uint32_t)(length - LENGTH_BASE[lengthCode]),
+          LENGTH_EXTRA[lengthCode]);
+
+  int distCode = findCode(DIST_BASE, 30, distance);
+  putHuffman((uint32_t)distCode, 5);
+  putBits((uint32_t)(distance - DIST_BASE[distCode]), DIST_EXTRA[distCode]);
+}
+
+// One fixed-Huffman block per call. Matches may reach back into earlier
+// calls through the retained window.
+void PngStreamWriter::compress(const uint8_t *data, size_t size) {
+  // Adler-32 of the uncompressed stream, in chunks that can't overflow
+  uint32_t s1 = m_adler & 0xffff, s2 = m_adler >> 16;
+  for (size_t i = 0; i < size;) {
+    size_t chunk = size - i < 5552 ? size - i : 5552;
+    for (size_t k = 0; k < chunk; k++, i++) {
+      s1 += data[i];
+      s2 += s1;
+    }
+    s1 %= 65521;
+    s2 %= 65521;
+  }
+  m_adler = (s2 << 16) | s1;
+
+  uint64_t begin = m_windowStart + m_window.size();
+  m_window.insert(m_window.end(), data, data + size);
+  uint64_t end = m_windowStart + m_window.size();
+  const uint8_t *w = m_window.data();
+
+  auto hashAt = [&](uint64_t pos) {
+    const uint8_t *p = w + (pos - m_windowStart);
+    return (((uint32_t)p[0] << 10) ^ ((uint32_t)p[1] << 5) ^ p[2]) &
+           ((1u << HASH_BITS) - 1);
+  };
+  auto insert = [&](uint64_t pos) {
+    uint32_t h = hashAt(pos);
+    m_prev[pos & (WINDOW_SIZE - 1)] = m_head[h];
+    m_head[h] = (int64_t)pos;
+  };
+
+  putBits(0, 1); // Not final
+  putBits(1, 2); // Fixed Huffman
+
+  uint64_t pos = begin;
+  while (pos < end) {
+    int bestLength = 0;
+    int bestDistance = 0;
+
+    if (end - pos >= (uint64_t)MIN_MATCH) {
+      int maxLength =
+          end - pos < (uint64_t)MAX_MATCH ? (int)(end - pos) : MAX_MATCH;
+      const uint8_t *current = w + (pos - m_windowStart);
+      int64_t candidate = m_head[hashAt(pos)];
+
+      for (int chain = 0; chain < MAX_CHAIN && candidate >= 0; chain++) {
+        uint64_t distance = pos - (uint64_t)candidate;
+        if ((uint64_t)candidate >= pos || distance > (uint64_t)WINDOW_SIZE ||
+            (uint64_t)candidate < m_windowStart)
+          break;
+
+        const uint8_t *previous = w + ((uint64_t)candidate - m_windowStart);
+        int length = 0;
+        while (length < maxLength && previous[length] == current[length])
+          length++;
+        if (length > bestLength) {
+          bestLength = length;
+          bestDistance = (int)distance;
+          if (length == maxLength)
+            break;
+        }
+
+        int64_t next = m_prev[(uint64_t)candidate & (WINDOW_SIZE - 1)];
+        if (next >= candidate)
+          break; // Slot was reused by a newer position
+        candidate = next;
+      }
+    }
+
+    if (bestLength >= MIN_MATCH) {
+      putMatch(bestLength, bestDistance);
+      for (int i = 0; i < bestLength; i++, pos++) {
+        if (end - pos >= (uint64_t)MIN_MATCH)
+          insert(pos);
+      }
+    } else {
+      putLiteral(w[pos - m_windowStart]);
+      if (end - pos >= (uint64_t)MIN_MATCH)
+        insert(pos);
+      pos++;
+    }
+  }
+
+  putLiteral(256); // End of block
+
+  // Keep only the history matches can still reach
+  if (m_window.size() > 2 * (size_t)WINDOW_SIZE) {
+    size_t drop = m_window.size() - WINDOW_SIZE;
+    m_window.erase(m_window.begin(), m_window.begin() + drop);
+    m_windowStart += drop;
+  }
+}
+
+void PngStreamWriter::flushOutput(bool force) {
+  if (m_output.empty() || (!force && m_output.size() < IDAT_SIZE))
+    return;
+  writeChunk("IDAT", m_output.data(), m_output.size());
+  m_output.clear();
+}
+
+bool PngStreamWriter::writeChunk(const char *type, const uint8_t *data,
+                                 size_t size) {
+  uint8_t header[8];
+  putBigEndian32(header, (uint32_t)size);
+  memcpy(header + 4, type, 4);
+
+  uint32_t crc = crc32Update(0xffffffffu, header + 4, 4);
+  crc = crc32Update(crc, data, size);
+  uint8_t footer[4];
+  putBigEndian32(footer, crc ^ 0xffffffffu);
+
+  if (std::fwrite(header, 1, 8, m_file) != 8 ||
+      (size > 0 && std::fwrite(data, 1, size, m_file) != size) ||
+      std::fwrite(footer, 1, 4, m_file) != 4) {
+    if (!m_failed)
+      std::cerr << "Write failed: " << m_path << std::endl;
+    m_failed = true;
+  }
+  return !m_failed;
+}
+
+bool PngStreamWriter::close() {
+  if (!m_file)
+    return false;
+
+  bool complete = m_rowsWritten == m_height;
+  if (!complete) {
+    std::cerr << "PngStreamWriter: " << m_path << " closed after "
+              << m_rowsWritten << " of " << m_height << " rows" << std::endl;
+  }
+
+  // Empty final block, byte align, Adler-32
+  putBits(1, 1);
+  putBits(1, 2);
+  putLiteral(256);
+  if (m_bitCount > 0)
+    putBits(0, 8 - m_bitCount);
+  uint8_t adler[4];
+  putBigEndian32(adler, m_adler);
+  m_output.insert(m_output.end(), adler, adler + 4);
+
+  flushOutput(true);
+  writeChunk("IEND", nullptr, 0);
+
+  bool ok = std::fclose(m_file) == 0 && !m_failed && complete;
+  m_file = nullptr;
+  m_window.clear();
+  m_window.shrink_to_fit();
+  return ok;
+}
@@ -0,0 +1,74 @@
+#ifndef PNG_STREAM_WRITER_H
+#define PNG_STREAM_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Writes an RGB8 PNG row by row, so images far larger than memory (or the
+// GPU's texture limit) can be produced from tiles. Rows are filtered and
+// deflated as they arrive and flushed in IDAT chunks; memory use is a
+// couple of rows plus the 32 KB deflate window.
+//
+// The deflate stream uses fixed Huffman codes with a small hash-chain
+// matcher: much faster than a full encoder and close in size for rendered
+// content (mostly dark, smooth gradients).
+class PngStreamWriter {
+public:
+  PngStreamWriter();
+  ~PngStreamWriter();
+
+  PngStreamWriter(const PngStreamWriter &) = delete;
+  PngStreamWriter &operator=(const PngStreamWriter &) = delete;
+
+  bool open(const std::string &path, int width, int height);
+
+  // Append 'count' rows, top to bottom. 'stride' is the byte distance from
+  // one row to the next and may be negative, so a bottom-up GL readback can
+  // be written by pointing at its last row.
+  bool writeRows(const unsigned char *rows, int count, ptrdiff_t stride);
+
+  // Finish the stream. Fails if fewer rows than the height were written.
+  bool close();
+
+  bool isOpen() const { return m_file != nullptr; }
+  int getRowsWritten() const { return m_rowsWritten; }
+
+private:
+  // Deflate
+  void putBits(uint32_t value, int count);
+  void putHuffman(uint32_t code, int length);
+  void putLiteral(int literal);
+  void putMatch(int length, int distance);
+  void compress(const uint8_t *data, size_t size);
+  void flushOutput(bool force);
+
+  bool writeChunk(const char *type, const uint8_t *data, size_t size);
+  void filterRow(const unsigned char *row);
+
+  std::FILE *m_file = nullptr;
+  std::string m_path;
+  int m_width = 0;
+  int m_height = 0;
+  int m_rowsWritten = 0;
+  bool m_failed = false;
+
+  std::vector<uint8_t> m_previousRow;
+  std::vector<uint8_t> m_filtered[5];
+
+  // Matcher state: the last 32 KB of uncompressed data plus hash chains
+  // keyed on absolute stream positions
+  std::vector<uint8_t> m_window;
+  uint64_t m_windowStart = 0;
+  std::vector<int64_t> m_head;
+  std::vector<int64_t> m_prev;
+  uint32_t m_adler = 1;
+
+  uint64_t m_bitBuffer = 0;
+  int m_bitCount = 0;
+  std::vector<uint8_t> m_output;
+};
+
+#endif // PNG_STREAM_WRITER_H
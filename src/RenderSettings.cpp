@@ -0,0 +1,292 @@
+#include "RenderSettings.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static bool parseFloat(const std::string &value, float &out) {
+  char *end = nullptr;
+  float v = strtof(value.c_str(), &end);
+  if (end == value.c_str() || *end != '\0')
+    return false;
+  out = v;
+  return true;
+}
+
+static bool parseInt(const std::string &value, int &out) {
+  char *end = nullptr;
+  long v = strtol(value.c_str(), &end, 10);
+  if (end == value.c_str() || *end != '\0')
+    return false;
+  out = (int)v;
+  return true;
+}
+
+static bool parseBool(const std::string &value, bool &out) {
+  if (value == "1" || value == "true" || value == "on" || value == "yes") {
+    out = true;
+    return true;
+  }
+  if (value == "0" || value == "false" || value == "off" || value == "no") {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+// Colors are given as "r,g,b" with components in [0, 1]
+static bool parseColor(const std::string &value, glm::vec3 &out) {
+  float r, g, b;
+  char trailing;
+  if (sscanf(value.c_str(), "%f,%f,%f%c", &r, &g, &b, &trailing) != 3)
+    return false;
+  out = glm::vec3(r, g, b);
+  return true;
+}
+
+static std::string trim(const std::string &s) {
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos)
+    return "";
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(begin, end - begin + 1);
+}
+
+bool applyRenderSetting(RenderSettings &settings, const std::string &key,
+                        const std::string &value) {
+  BlackHoleParams &bh = settings.blackHole;
+  CameraParams &cam = settings.camera;
+  BloomParams &bloom = settings.bloom;
+  bool ok = false;
+
+  if (key == "config")
+    return loadRenderSettingsFile(settings, value);
+
+  // Black hole
+  if (key == "radius")
+    ok = parseFloat(value, bh.radius);
+  else if (key == "disk-inner")
+    ok = parseFloat(value, bh.diskInnerRadius);
+  else if (key == "disk-outer")
+    ok = parseFloat(value, bh.diskOuterRadius);
+  else if (key == "disk-thickness")
+    ok = parseFloat(value, bh.diskThickness);
+  else if (key == "disk-color1")
+    ok = parseColor(value, bh.diskColor1);
+  else if (key == "disk-color2")
+    ok = parseColor(value, bh.diskColor2);
+  else if (key == "glow")
+    ok = parseFloat(value, bh.glowIntensity);
+  else if (key == "disk-speed")
+    ok = parseFloat(value, bh.diskSpeed);
+  // Camera
+  else if (key == "distance")
+    ok = parseFloat(value, cam.distance);
+  else if (key == "angle")
+    ok = parseFloat(value, cam.angle);
+  // Bloom
+  else if (key == "bloom")
+    ok = parseBool(value, bloom.enabled);
+  else if (key == "bloom-threshold")
+    ok = parseFloat(value, bloom.threshold);
+  else if (key == "bloom-intensity")
+    ok = parseFloat(value, bloom.intensity);
+  else if (key == "bloom-strength")
+    ok = parseFloat(value, bloom.strength);
+  else if (key == "bloom-radius")
+    ok = parseFloat(value, bloom.radius) && bloom.radius >= 0.25f &&
+         bloom.radius <= 4.0f;
+  else if (key == "exposure")
+    ok = parseFloat(value, bloom.exposure);
+  // Frame
+  else if (key == "width")
+    ok = parseInt(value, settings.width) && settings.width > 0;
+  else if (key == "height")
+    ok = parseInt(value, settings.height) && settings.height > 0;
+  else if (key == "time")
+    ok = parseFloat(value, settings.time);
+  else if (key == "frames")
+    ok = parseInt(value, settings.frames) && settings.frames > 0;
+  else if (key == "fps")
+    ok = parseFloat(value, settings.fps) && settings.fps > 0.0f;
+  else if (key == "phase") {
+    ok = parseFloat(value, settings.diskPhase);
+    if (ok)
+      settings.hasDiskPhase = true;
+  }
+  // Render options
+  else if (key == "quality")
+    ok = parseSceneQuality(value, settings.options.quality);
+  else if (key == "integrator")
+    ok = parseGeodesicIntegrator(value, settings.options.integrator);
+  else if (key == "deflection-lut")
+    ok = parseBool(value, settings.options.deflectionLUT);
+  else if (key == "starfield-format")
+    ok = parseStarfieldFormat(value, settings.options.starfieldFormat);
+  else if (key == "resolution-scale")
+    ok = parseFloat(value, settings.options.resolutionScale) &&
+         settings.options.resolutionScale >= 0.25f &&
+         settings.options.resolutionScale <= 1.0f;
+  else if (key == "geodesic-cache")
+    ok = parseBool(value, settings.options.geodesicCache);
+  else if (key == "tile-classify")
+    ok = parseBool(value, settings.options.tileClassification);
+  else if (key == "compute-tracer")
+    ok = parseBool(value, settings.options.computeTracer);
+  else if (key == "cpu-tracer")
+    ok = parseBool(value, settings.cpuTracer);
+  else if (key == "tile")
+    ok = parseInt(value, settings.tileSize) && settings.tileSize >= 0;
+  else if (key == "threads")
+    ok = parseInt(value, settings.threads) && settings.threads >= 0;
+  else if (key == "shm-output") {
+    settings.sharedMemory = value;
+    ok = !value.empty();
+  } else if (key == "shm-content") {
+    ok = true;
+    if (value == "hdr")
+      settings.sharedContent = 1;
+    else if (value == "ldr")
+      settings.sharedContent = 2;
+    else if (value == "both")
+      settings.sharedContent = 3;
+    else
+      ok = false;
+  } else if (key == "output") {
+    settings.output = value;
+    ok = !value.empty();
+  } else {
+    std::cerr << "Unknown setting: " << key << std::endl;
+    return false;
+  }
+
+  if (!ok) {
+    std::cerr << "Invalid value for " << key << ": '" << value << "'"
+              << std::endl;
+  }
+  return ok;
+}
+
+bool loadRenderSettingsFile(RenderSettings &settings, const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Failed to open settings file: " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    line = trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << path << ":" << lineNumber << ": expected 'key = value'"
+                << std::endl;
+      return false;
+    }
+    if (!applyRenderSetting(settings, trim(line.substr(0, eq)),
+                            trim(line.substr(eq + 1)))) {
+      std::cerr << path << ":" << lineNumber << ": invalid setting"
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseRenderSettingsArgs(RenderSettings &settings, int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      std::cerr << "Unexpected argument: " << arg << std::endl;
+      return false;
+    }
+    arg = arg.substr(2);
+
+    std::string key, value;
+    size_t eq = arg.find('=');
+    if (eq != std::string::npos) {
+      key = arg.substr(0, eq);
+      value = arg.substr(eq + 1);
+    } else {
+      if (i + 1 >= argc) {
+        std::cerr << "Missing value for --" << arg << std::endl;
+        return false;
+      }
+      key = arg;
+      value = argv[++i];
+    }
+
+    if (!applyRenderSetting(settings, key, value))
+      return false;
+  }
+  return checkRenderSettings(settings);
+}
+
+bool checkRenderSettings(const RenderSettings &settings) {
+  if (settings.cpuTracer &&
+      settings.options.integrator == GeodesicIntegrator::Binet) {
+    std::cerr << "--cpu-tracer does not implement --integrator binet"
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void printRenderSettingsUsage(const char *program) {
+  std::cout
+      << "Usage: " << program << " [--key value | --key=value]...\n"
+      << "\n"
+      << "Frame:\n"
+      << "  --width N, --height N      Output resolution (default 1920x1080)\n"
+      << "  --time T                   Shader time in seconds\n"
+      << "  --phase P                  Disk phase (default time * disk-speed)\n"
+      << "  --output FILE              PNG to write\n"
+      << "  --frames N, --fps F        Render N frames at a fixed 1/F step;\n"
+      << "                             output is a frame pattern (%05d),\n"
+      << "                             a .y4m file or '-' for Y4M on stdout\n"
+      << "  --config FILE              Load 'key = value' settings file\n"
+      << "  --tile N                   Render and stream in NxN tiles\n"
+      << "  --cpu-tracer 0|1           Trace on the CPU instead of the GPU\n"
+      << "  --threads N                CPU tracer threads (default: all)\n"
+      << "  --shm-output NAME          Stream the frames into shared memory\n"
+      << "                             NAME in real time instead of writing\n"
+      << "                             files\n"
+      << "  --shm-content C            hdr, ldr or both (default) for\n"
+      << "                             --shm-output\n"
+      << "\n"
+      << "Black hole:\n"
+      << "  --radius, --glow, --disk-inner, --disk-outer, --disk-thickness,\n"
+      << "  --disk-speed, --disk-color1 r,g,b, --disk-color2 r,g,b\n"
+      << "\n"
+      << "Camera:\n"
+      << "  --distance, --angle\n"
+      << "\n"
+      << "Render options:\n"
+      << "  --quality Q                low, medium, high (default) or ultra\n"
+      << "  --integrator march|binet   Light paths: fixed-step march (default) or\n"
+      << "                             Schwarzschild orbits with adaptive RK45\n"
+      << "  --deflection-lut 0|1       Use baked light paths instead of the march\n"
+      << "  --starfield-format F       half, rgb9e5 (default, mipmapped) or\n"
+      << "                             bc6h (mipmapped, 4x smaller)\n"
+      << "  --resolution-scale S       Ray-march at S x resolution (0.25-1),\n"
+      << "                             then upscale\n"
+      << "  --geodesic-cache 0|1       Trace once per camera change and only\n"
+      << "                             re-shade later frames\n"
+      << "  --tile-classify 0|1        Skip the march on screen tiles that only\n"
+      << "                             see stars (default 1)\n"
+      << "  --compute-tracer 0|1       March in a compute pass with ray\n"
+      << "                             compaction (GL 4.3; march only)\n"
+      << "\n"
+      << "Bloom:\n"
+      << "  --bloom 0|1, --bloom-threshold, --bloom-intensity,\n"
+      << "  --bloom-strength, --exposure\n"
+      << "  --bloom-radius R           Bloom size relative to the image height,\n"
+      << "                             0.25-4 (default 1)\n";
+}
@@ -0,0 +1,72 @@
+#ifndef RENDER_SETTINGS_H
+#define RENDER_SETTINGS_H
+
+#include <string>
+
+#include "BlackHoleRenderer.h"
+#include "BloomRenderer.h"
+
+// Everything needed to reproduce a single frame without the UI.
+// Filled from the command line and/or a "key = value" settings file.
+struct RenderSettings {
+  BlackHoleParams blackHole;
+  CameraParams camera;
+  BloomParams bloom;
+  RenderOptions options;
+
+  int width = 1920;
+  int height = 1080;
+
+  // Shader time; the disk phase defaults to time * diskSpeed, matching what
+  // the interactive app accumulates, unless given explicitly.
+  float time = 0.0f;
+  float diskPhase = 0.0f;
+  bool hasDiskPhase = false;
+
+  std::string output = "blackhole_headless.png";
+
+  // Render in tiles of this size and stream them into the PNG, so the
+  // output can exceed GPU and memory limits. 0 renders in one pass.
+  int tileSize = 0;
+
+  // Animation: more than one frame renders a sequence at a fixed timestep
+  // of 1 / fps from 'time' (SequenceExporter)
+  int frames = 1;
+  float fps = 60.0f;
+
+  // Trace the scene on the CPU (CpuTracer) instead of the scene shader.
+  // Bloom and tone mapping still run through BloomRenderer.
+  bool cpuTracer = false;
+  int threads = 0; // CPU tracer threads, 0 = all cores
+
+  // Stream frames into this POSIX shared-memory ring (SharedFrameOutput)
+  // instead of writing files; 'sharedContent' is SHARED_FRAME_HDR and/or
+  // SHARED_FRAME_LDR
+  std::string sharedMemory;
+  unsigned int sharedContent = 3;
+
+  float resolvedDiskPhase() const {
+    return hasDiskPhase ? diskPhase : time * blackHole.diskSpeed;
+  }
+};
+
+// Apply a single setting. Keys match the long CLI options without the
+// leading dashes (e.g. "radius", "disk-color1", "bloom-threshold").
+bool applyRenderSetting(RenderSettings &settings, const std::string &key,
+                        const std::string &value);
+
+// Load settings from a file with one "key = value" per line.
+// Blank lines and lines starting with '#' are ignored.
+bool loadRenderSettingsFile(RenderSettings &settings, const std::string &path);
+
+// Parse "--key value" / "--key=value" arguments. "--config <file>" loads a
+// settings file in place, so later arguments override it.
+bool parseRenderSettingsArgs(RenderSettings &settings, int argc, char **argv);
+
+// Reject combinations of settings that no renderer implements. Settings are
+// applied one key at a time, so this runs once they are all in.
+bool checkRenderSettings(const RenderSettings &settings);
+
+void printRenderSettingsUsage(const char *program);
+
+#endif // RENDER_SETTINGS_H
@@ -0,0 +1,34 @@
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Relative frame-time error ignored around the budget
+static const float DEAD_BAND = 0.05f;
+// Largest per-frame change, as a fraction of the scale
+static const float MAX_DECREASE = 0.15f;
+static const float MAX_INCREASE = 0.03f;
+
+ResolutionController::ResolutionController() {}
+
+void ResolutionController::setRange(float minScale, float maxScale) {
+  m_minScale = std::min(minScale, maxScale);
+  m_maxScale = std::max(minScale, maxScale);
+  m_scale = std::min(std::max(m_scale, m_minScale), m_maxScale);
+}
+
+float ResolutionController::update(float frameMs) {
+  if (frameMs <= 0.0f || m_budgetMs <= 0.0f)
+    return m_scale;
+
+  float ratio = m_budgetMs / frameMs;
+  if (std::fabs(ratio - 1.0f) > DEAD_BAND) {
+    // Aim a little under budget so noise doesn't push frames over it
+    float correction = std::sqrt(ratio * (1.0f - 0.5f * DEAD_BAND));
+    correction = std::min(std::max(correction, 1.0f - MAX_DECREASE),
+                          1.0f + MAX_INCREASE);
+    m_scale *= correction;
+  }
+  m_scale = std::min(std::max(m_scale, m_minScale), m_maxScale);
+  return m_scale;
+}
@@ -0,0 +1,30 @@
+#ifndef RESOLUTION_CONTROLLER_H
+#define RESOLUTION_CONTROLLER_H
+
+// Picks the ray-march resolution scale (per axis) that keeps the measured
+// GPU frame time at a budget. March cost is roughly proportional to pixel
+// count, so the correction is the square root of budget / measured. It
+// drops quickly when over budget and recovers slowly, with a dead band so
+// the scale doesn't hunt around the target.
+class ResolutionController {
+public:
+  ResolutionController();
+
+  void setBudget(float milliseconds) { m_budgetMs = milliseconds; }
+  float getBudget() const { return m_budgetMs; }
+  void setRange(float minScale, float maxScale);
+
+  // Feed one frame's GPU time; returns the scale for the next frame
+  float update(float frameMs);
+  void reset(float scale = 1.0f) { m_scale = scale; }
+
+  float getScale() const { return m_scale; }
+
+private:
+  float m_budgetMs = 16.0f;
+  float m_minScale = 0.5f;
+  float m_maxScale = 1.0f;
+  float m_scale = 1.0f;
+};
+
+#endif // RESOLUTION_CONTROLLER_H
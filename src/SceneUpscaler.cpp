@@ -0,0 +1,85 @@
+#include "SceneUpscaler.h"
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+SceneUpscaler::SceneUpscaler() {}
+
+SceneUpscaler::~SceneUpscaler() { shutdown(); }
+
+void SceneUpscaler::init() {
+  if (m_shader)
+    return;
+  m_shader = ShaderCache::get("assets/shaders/vertex.glsl",
+                              "assets/shaders/upscale.glsl");
+}
+
+void SceneUpscaler::shutdown() {
+  deleteTarget();
+  m_shader.reset();
+}
+
+void SceneUpscaler::ensureTarget(int width, int height) {
+  if (m_fbo != 0 && width == m_width && height == m_height)
+    return;
+  deleteTarget();
+
+  // Same format as the bloom scene target (alpha carries the bloom mask).
+  // Texels are fetched directly by the upscale shader.
+  glGenFramebuffers(1, &m_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  glGenTextures(1, &m_texture);
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA,
+               GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         m_texture, 0);
+
+  m_width = width;
+  m_height = height;
+}
+
+void SceneUpscaler::deleteTarget() {
+  if (m_fbo != 0) {
+    glDeleteFramebuffers(1, &m_fbo);
+    glDeleteTextures(1, &m_texture);
+    m_fbo = 0;
+    m_texture = 0;
+  }
+  m_width = m_height = 0;
+}
+
+glm::ivec2 SceneUpscaler::begin(int width, int height, float scale) {
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFBO);
+  glGetIntegerv(GL_VIEWPORT, m_previousViewport);
+
+  ensureTarget(width, height);
+  m_scaledSize.x = std::max(1, (int)std::lround(width * scale));
+  m_scaledSize.y = std::max(1, (int)std::lround(height * scale));
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  glViewport(0, 0, m_scaledSize.x, m_scaledSize.y);
+  glClear(GL_COLOR_BUFFER_BIT);
+  return m_scaledSize;
+}
+
+void SceneUpscaler::end(unsigned int quadVAO) {
+  glBindFramebuffer(GL_FRAMEBUFFER, m_previousFBO);
+  glViewport(m_previousViewport[0], m_previousViewport[1],
+             m_previousViewport[2], m_previousViewport[3]);
+
+  m_shader->use();
+  m_shader->setInt("u_Source", 0);
+  m_shader->setVec2("u_SourceSize", glm::vec2(m_scaledSize));
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+
+  glBindVertexArray(quadVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+  glBindVertexArray(0);
+}
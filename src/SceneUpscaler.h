@@ -0,0 +1,44 @@
+#ifndef SCENE_UPSCALER_H
+#define SCENE_UPSCALER_H
+
+#include <glm/glm.hpp>
+#include <memory>
+
+class Shader;
+
+// Reduced-resolution target for the ray-march pass. begin() redirects
+// rendering into the low-resolution target; end() upscales the result into
+// the framebuffer that was bound before, at its full viewport size. The
+// target is allocated at full size and rendered into a corner, so changing
+// the scale every frame never reallocates.
+class SceneUpscaler {
+public:
+  SceneUpscaler();
+  ~SceneUpscaler();
+
+  void init();
+  void shutdown();
+
+  // Bind the low-resolution target for a width x height output at 'scale'
+  // per axis and set the viewport. Returns the scaled size.
+  glm::ivec2 begin(int width, int height, float scale);
+
+  // Upscale into the previous framebuffer and restore its viewport
+  void end(unsigned int quadVAO);
+
+private:
+  void ensureTarget(int width, int height);
+  void deleteTarget();
+
+  std::shared_ptr<Shader> m_shader;
+  unsigned int m_fbo = 0;
+  unsigned int m_texture = 0;
+  int m_width = 0;
+  int m_height = 0;
+
+  glm::ivec2 m_scaledSize = glm::ivec2(0);
+  int m_previousFBO = 0;
+  int m_previousViewport[4] = {0, 0, 0, 0};
+};
+
+#endif // SCENE_UPSCALER_H
@@ -1,18 +1,38 @@
 #include "ScreenshotExporter.h"
-#include "Shader.h"
+#include "PngStreamWriter.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <ctime>
 #include <iostream>
 #include <vector>
 
-
+static std::string timestampFilename() {
+  time_t now = time(0);
+  struct tm *timeinfo = localtime(&now);
+  char filename[128];
+  strftime(filename, sizeof(filename), "blackhole_%Y%m%d_%H%M%S.png", timeinfo);
+  return filename;
+}
 
 ScreenshotExporter::ScreenshotExporter() {}
 
-ScreenshotExporter::~ScreenshotExporter() { deleteResources(); }
+ScreenshotExporter::~ScreenshotExporter() {
+  // The encoder drains its queue before exiting
+  if (m_encoder.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_encoderMutex);
+      m_encoderStop = true;
+    }
+    m_encoderWake.notify_all();
+    m_encoder.join();
+  }
+  deleteResources();
+}
 
 void ScreenshotExporter::init() {
   // Create a reusable quad VAO
@@ -33,9 +53,23 @@ void ScreenshotExporter::init() {
   glEnableVertexAttribArray(1);
   glBindVertexArray(0);
 
+  // Readback ring; storage is allocated on first use at the export size
+  for (Readback &readback : m_readbacks)
+    glGenBuffers(1, &readback.pbo);
+
+  if (!m_encoder.joinable())
+    m_encoder = std::thread(&ScreenshotExporter::encoderLoop, this);
+
   m_initialized = true;
 }
 
+void ScreenshotExporter::shutdown() {
+  if (!m_initialized)
+    return;
+  finish();
+  deleteResources();
+}
+
 void ScreenshotExporter::ensureSize(int width, int height) {
   if (m_allocatedWidth == width && m_allocatedHeight == height) {
     return; // Already the right size
@@ -45,8 +79,6 @@ void ScreenshotExporter::ensureSize(int width, int height) {
   if (m_fbo != 0) {
     glDeleteFramebuffers(1, &m_fbo);
     glDeleteTextures(1, &m_texture);
-    glDeleteFramebuffers(1, &m_hdrFBO);
-    glDeleteTextures(1, &m_hdrTexture);
   }
 
   // Create output FBO (LDR, for final readback)
@@ -61,17 +93,12 @@ void ScreenshotExporter::ensureSize(int width, int height) {
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                          m_texture, 0);
 
-  // Create HDR FBO (for scene rendering before tone mapping)
-  glGenFramebuffers(1, &m_hdrFBO);
-  glBindFramebuffer(GL_FRAMEBUFFER, m_hdrFBO);
-  glGenTextures(1, &m_hdrTexture);
-  glBindTexture(GL_TEXTURE_2D, m_hdrTexture);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA,
-               GL_FLOAT, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         m_hdrTexture, 0);
+  // HDR scene target and bloom pyramid (the same passes as the live view)
+  if (m_allocatedWidth == 0)
+    m_bloomRenderer.init(width, height);
+  else
+    m_bloomRenderer.resize(width, height);
+  m_bloomRenderer.setOutputFBO(m_fbo);
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -80,16 +107,14 @@ void ScreenshotExporter::ensureSize(int width, int height) {
 }
 
 std::string ScreenshotExporter::capture(int width, int height,
-                                        Shader &sceneShader,
-                                        Shader &compositeShader,
-                                        const BlackHoleParams &params,
-                                        const CameraParams &camParams,
-                                        float diskPhase, float exposure) {
+                                        BlackHoleRenderer &scene, float time,
+                                        const BloomParams &bloom) {
   if (!m_initialized) {
     std::cerr << "ScreenshotExporter not initialized!" << std::endl;
     return "";
   }
 
+  Readback *readback = acquireReadback();
   ensureSize(width, height);
 
   // Check framebuffer completeness
@@ -100,73 +125,268 @@ std::string ScreenshotExporter::capture(int width, int height,
     return "";
   }
 
-  // Render scene to HDR FBO
-  glBindFramebuffer(GL_FRAMEBUFFER, m_hdrFBO);
-  glViewport(0, 0, width, height);
-  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
-
-  sceneShader.use();
-  sceneShader.setVec2("u_Resolution", glm::vec2(width, height));
-  sceneShader.setFloat("u_Time",
-                       diskPhase); // Use diskPhase for consistent timing
-  sceneShader.setFloat("u_BlackHoleRadius", params.radius);
-  sceneShader.setFloat("u_DiskInnerRadius", params.diskInnerRadius);
-  sceneShader.setFloat("u_DiskOuterRadius", params.diskOuterRadius);
-  sceneShader.setFloat("u_DiskThickness", params.diskThickness);
-  sceneShader.setVec3("u_DiskColor1", params.diskColor1);
-  sceneShader.setVec3("u_DiskColor2", params.diskColor2);
-  sceneShader.setFloat("u_GlowIntensity", params.glowIntensity);
-  sceneShader.setFloat("u_DiskPhase", diskPhase);
-  sceneShader.setFloat("u_CameraDistance", camParams.distance);
-  sceneShader.setFloat("u_CameraAngle", camParams.angle);
+  renderWindow(width, height, glm::vec2(0.0f), scene, time, bloom);
 
-  glBindVertexArray(m_quadVAO);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
+  // Queue the readback into a pixel buffer; the fence tells update() when
+  // the copy has landed, without stalling this frame
+  size_t size = (size_t)width * height * 3;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+  if (readback->capacity != size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    readback->capacity = size;
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void *)0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
 
-  // Tone map to LDR FBO
-  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-  glClear(GL_COLOR_BUFFER_BIT);
+  readback->state = Readback::State::Reading;
+  readback->width = width;
+  readback->height = height;
+  readback->filename = nextFilename();
 
-  compositeShader.use();
-  compositeShader.setInt("u_Scene", 0);
-  compositeShader.setInt("u_Bloom", 1);
-  compositeShader.setFloat("u_BloomStrength", 0.0f);
-  compositeShader.setFloat("u_Exposure", exposure);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  std::cout << "Queued: " << readback->filename << " (" << width << "x"
+            << height << ")" << std::endl;
+  return readback->filename;
+}
 
-  auto& texture = m_hdrTexture; // Use reference to avoid warning or errors, actually this line is not needed if we just use m_hdrTexture.
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, m_hdrTexture);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
+ScreenshotExporter::Readback *ScreenshotExporter::acquireReadback() {
+  // When the ring is full, wait for an export to finish rather than drop one
+  for (;;) {
+    update();
+    for (Readback &readback : m_readbacks) {
+      if (readback.state == Readback::State::Free)
+        return &readback;
+    }
+    for (Readback &readback : m_readbacks) {
+      if (readback.state == Readback::State::Reading)
+        glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GL_TIMEOUT_IGNORED);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
 
-  // Read pixels
-  std::vector<unsigned char> pixels(width * height * 3);
-  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+void ScreenshotExporter::update() {
+  for (Readback &readback : m_readbacks) {
+    if (readback.state == Readback::State::Reading) {
+      GLenum status = glClientWaitSync(readback.fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        continue;
+      glDeleteSync(readback.fence);
+      readback.fence = nullptr;
+
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+      readback.pixels = (const unsigned char *)glMapBufferRange(
+          GL_PIXEL_PACK_BUFFER, 0, readback.capacity, GL_MAP_READ_BIT);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      if (!readback.pixels) {
+        std::cerr << "Failed to map readback for " << readback.filename
+                  << std::endl;
+        readback.state = Readback::State::Free;
+        continue;
+      }
+
+      readback.state = Readback::State::Encoding;
+      readback.encoded.store(false);
+      {
+        std::lock_guard<std::mutex> lock(m_encoderMutex);
+        m_encoderQueue.push_back(&readback);
+      }
+      m_encoderWake.notify_one();
+    } else if (readback.state == Readback::State::Encoding &&
+               readback.encoded.load(std::memory_order_acquire)) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      readback.pixels = nullptr;
+      readback.state = Readback::State::Free;
+
+      if (readback.saved) {
+        std::cout << "Saved: " << readback.filename << " (" << readback.width
+                  << "x" << readback.height << ")" << std::endl;
+      } else {
+        std::cerr << "Failed to save image!" << std::endl;
+      }
+    }
+  }
+}
 
-  // Flip vertically (OpenGL reads bottom-to-top)
-  std::vector<unsigned char> flipped(width * height * 3);
-  for (int y = 0; y < height; y++) {
-    memcpy(&flipped[y * width * 3], &pixels[(height - 1 - y) * width * 3],
-           width * 3);
+void ScreenshotExporter::finish() {
+  while (getPendingCount() > 0) {
+    for (Readback &readback : m_readbacks) {
+      if (readback.state == Readback::State::Reading)
+        glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GL_TIMEOUT_IGNORED);
+    }
+    update();
+    if (getPendingCount() > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
   }
+}
 
-  // Generate filename with timestamp
-  time_t now = time(0);
-  struct tm *timeinfo = localtime(&now);
-  char filename[128];
-  strftime(filename, sizeof(filename), "blackhole_%Y%m%d_%H%M%S.png", timeinfo);
+int ScreenshotExporter::getPendingCount() const {
+  int count = 0;
+  for (const Readback &readback : m_readbacks) {
+    if (readback.state != Readback::State::Free)
+      count++;
+  }
+  return count;
+}
 
-  // Write to disk
-  if (stbi_write_png(filename, width, height, 3, flipped.data(), width * 3)) {
-    std::cout << "Saved: " << filename << " (" << width << "x" << height << ")"
-              << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    return std::string(filename);
+void ScreenshotExporter::encoderLoop() {
+  for (;;) {
+    Readback *readback;
+    {
+      std::unique_lock<std::mutex> lock(m_encoderMutex);
+      m_encoderWake.wait(
+          lock, [this] { return m_encoderStop || !m_encoderQueue.empty(); });
+      if (m_encoderQueue.empty())
+        return;
+      readback = m_encoderQueue.front();
+      m_encoderQueue.pop_front();
+    }
+
+    // GL rows are bottom-up: start at the last row and step backwards
+    // instead of flipping into a copy
+    int stride = readback->width * 3;
+    const unsigned char *top =
+        readback->pixels + (size_t)(readback->height - 1) * stride;
+    readback->saved =
+        stbi_write_png(readback->filename.c_str(), readback->width,
+                       readback->height, 3, top, -stride) != 0;
+    readback->encoded.store(true, std::memory_order_release);
+  }
+}
+
+// Timestamped name, with a counter when several exports land in one second
+std::string ScreenshotExporter::nextFilename() {
+  std::string filename = timestampFilename();
+  if (filename == m_lastFilename) {
+    m_filenameRepeat++;
   } else {
-    std::cerr << "Failed to save image!" << std::endl;
+    m_lastFilename = filename;
+    m_filenameRepeat = 0;
+  }
+  if (m_filenameRepeat == 0)
+    return filename;
+  return filename.substr(0, filename.size() - 4) + "_" +
+         std::to_string(m_filenameRepeat) + ".png";
+}
+
+void ScreenshotExporter::renderWindow(int width, int height,
+                                      const glm::vec2 &offset,
+                                      BlackHoleRenderer &scene, float time,
+                                      const BloomParams &bloom) {
+  // Render scene to HDR FBO
+  m_bloomRenderer.beginScene(bloom);
+
+  // Same uniforms and passes as the live view. Exports always march at
+  // full resolution (tile offsets are in full-resolution pixels) and skip
+  // the geodesic cache, which would be reallocated at the export size.
+  RenderOptions liveOptions = scene.getOptions();
+  scene.getOptions().resolutionScale = 1.0f;
+  scene.getOptions().geodesicCache = false;
+  scene.setTileOffset(offset);
+  scene.render(time, width, height);
+  scene.setTileOffset(glm::vec2(0.0f));
+  scene.getOptions() = liveOptions;
+
+  // Post-process into the LDR FBO
+  if (!bloom.enabled) {
+    m_bloomRenderer.renderWithoutBloom(bloom, m_quadVAO);
+  } else if (width != m_allocatedWidth || height != m_allocatedHeight) {
+    m_bloomRenderer.compositeTile(bloom, m_quadVAO, offset,
+                                  glm::vec2(width, height));
+  } else {
+    m_bloomRenderer.applyBloom(bloom, m_quadVAO);
+  }
+}
+
+void ScreenshotExporter::renderBloomPyramid(int width, int height,
+                                            BlackHoleRenderer &scene,
+                                            float time,
+                                            const BloomParams &bloom) {
+  RenderOptions liveOptions = scene.getOptions();
+  scene.getOptions().resolutionScale = 1.0f;
+  scene.getOptions().geodesicCache = false;
+  glm::ivec2 size = m_bloomRenderer.beginPyramid(width, height, bloom);
+  scene.render(time, size.x, size.y);
+  scene.getOptions() = liveOptions;
+
+  m_bloomRenderer.buildPyramid(bloom, m_quadVAO);
+}
+
+std::string ScreenshotExporter::captureTiled(int width, int height,
+                                             int tileSize,
+                                             BlackHoleRenderer &scene,
+                                             float time,
+                                             const BloomParams &bloom) {
+  if (!m_initialized) {
+    std::cerr << "ScreenshotExporter not initialized!" << std::endl;
+    return "";
+  }
+
+  // Every tile renders a full window; windows at the right and top edges
+  // are shifted back inside the image and overlap their neighbours
+  int windowWidth = std::min(width, tileSize);
+  int windowHeight = std::min(height, tileSize);
+  ensureSize(windowWidth, windowHeight);
+  if (bloom.enabled && (windowWidth != width || windowHeight != height))
+    renderBloomPyramid(width, height, scene, time, bloom);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return "";
+  }
+
+  std::string filename = nextFilename();
+  PngStreamWriter writer;
+  if (!writer.open(filename, width, height)) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     return "";
   }
+
+  // One row of tiles, bottom-up as GL returns it
+  std::vector<unsigned char> band((size_t)width * windowHeight * 3);
+  const ptrdiff_t stride = (ptrdiff_t)width * 3;
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  bool ok = true;
+  for (int top = 0; top < height && ok; top += tileSize) {
+    int rows = std::min(tileSize, height - top);
+    int tileY = height - top - rows;
+    int originY = std::min(tileY, height - windowHeight);
+
+    for (int tileX = 0; tileX < width; tileX += tileSize) {
+      int columns = std::min(tileSize, width - tileX);
+      int originX = std::min(tileX, width - windowWidth);
+
+      renderWindow(width, height, glm::vec2(originX, originY), scene, time,
+                   bloom);
+
+      glPixelStorei(GL_PACK_ROW_LENGTH, width);
+      glReadPixels(tileX - originX, tileY - originY, columns, rows, GL_RGB,
+                   GL_UNSIGNED_BYTE, &band[(size_t)tileX * 3]);
+      glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    }
+
+    ok = writer.writeRows(&band[(size_t)(rows - 1) * stride], rows, -stride);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (!writer.close() || !ok) {
+    std::cerr << "Failed to save image!" << std::endl;
+    return "";
+  }
+
+  std::cout << "Saved: " << filename << " (" << width << "x" << height
+            << ", tiled)" << std::endl;
+  return filename;
 }
 
 void ScreenshotExporter::deleteResources() {
@@ -176,12 +396,24 @@ void ScreenshotExporter::deleteResources() {
   if (m_fbo != 0) {
     glDeleteFramebuffers(1, &m_fbo);
     glDeleteTextures(1, &m_texture);
-    glDeleteFramebuffers(1, &m_hdrFBO);
-    glDeleteTextures(1, &m_hdrTexture);
   }
 
   glDeleteVertexArrays(1, &m_quadVAO);
   glDeleteBuffers(1, &m_quadVBO);
+  m_bloomRenderer.shutdown();
+
+  for (Readback &readback : m_readbacks) {
+    if (readback.fence)
+      glDeleteSync(readback.fence);
+    glDeleteBuffers(1, &readback.pbo);
+    readback.pbo = 0;
+    readback.capacity = 0;
+    readback.fence = nullptr;
+    readback.state = Readback::State::Free;
+  }
+  m_fbo = 0;
+  m_allocatedWidth = 0;
+  m_allocatedHeight = 0;
 
   m_initialized = false;
 }
@@ -3,12 +3,16 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
-
-// Forward declaration
-class Shader;
+#include <thread>
 
 #include "BlackHoleRenderer.h"
+#include "BloomRenderer.h"
 
 class ScreenshotExporter {
 public:
@@ -18,24 +22,85 @@ public:
   // Initialize resources. Call once after OpenGL context is created.
   void init();
 
+  // Finish queued exports and release GL resources. Call while the
+  // context is still current.
+  void shutdown();
+
   // Capture a screenshot at the specified resolution.
-  // Uses a dedicated FBO and the provided shader/params.
-  // Returns the filename on success, empty string on failure.
-  std::string capture(int width, int height, Shader &sceneShader,
-                      Shader &compositeShader, const BlackHoleParams &params,
-                      const CameraParams &camParams,
-                      float diskPhase, float exposure);
+  // Renders 'scene' with its current parameters into a dedicated FBO and
+  // post-processes it like the live view. The readback is queued
+  // into a pixel buffer and written by a background encoder, so the call
+  // returns without waiting for the GPU; update() completes it.
+  // Returns the filename the image will be saved to, empty on failure.
+  std::string capture(int width, int height, BlackHoleRenderer &scene,
+                      float time, const BloomParams &bloom);
+
+  // Same as capture(), but renders tileSize x tileSize pieces and streams
+  // each finished row of tiles into the PNG, so the image size is limited
+  // by disk space rather than GPU texture size or memory. Bloom comes from
+  // one pyramid of the whole image, so tiles need no overlap for it.
+  std::string captureTiled(int width, int height, int tileSize,
+                           BlackHoleRenderer &scene, float time,
+                           const BloomParams &bloom);
+
+  // Advance queued exports: map readbacks whose fence has signalled, hand
+  // them to the encoder and recycle finished buffers. Call once per frame.
+  void update();
+
+  // Block until every queued export has been written
+  void finish();
+
+  int getPendingCount() const;
 
 private:
+  // One in-flight export. The pixel buffer stays mapped while the encoder
+  // reads it; only the GL thread maps and unmaps.
+  struct Readback {
+    enum class State { Free, Reading, Encoding };
+    State state = State::Free;
+    unsigned int pbo = 0;
+    size_t capacity = 0;
+    GLsync fence = nullptr;
+    int width = 0;
+    int height = 0;
+    std::string filename;
+    const unsigned char *pixels = nullptr;
+    std::atomic<bool> encoded{false};
+    bool saved = false;
+  };
+  static const int READBACK_COUNT = 3;
+
   void ensureSize(int width, int height);
+  // Render the allocated-size window at 'offset' within a width x height
+  // image and post-process it into m_fbo (left bound). A window smaller
+  // than the image uses the pyramid of renderBloomPyramid().
+  void renderWindow(int width, int height, const glm::vec2 &offset,
+                    BlackHoleRenderer &scene, float time,
+                    const BloomParams &bloom);
+  void renderBloomPyramid(int width, int height, BlackHoleRenderer &scene,
+                          float time, const BloomParams &bloom);
   void deleteResources();
+  Readback *acquireReadback();
+  void encoderLoop();
+  std::string nextFilename();
 
   unsigned int m_fbo = 0;
   unsigned int m_texture = 0;
-  unsigned int m_hdrFBO = 0;
-  unsigned int m_hdrTexture = 0;
   unsigned int m_quadVAO = 0;
   unsigned int m_quadVBO = 0;
+  // HDR scene target and post-processing at the export size
+  BloomRenderer m_bloomRenderer;
+
+  Readback m_readbacks[READBACK_COUNT];
+  std::string m_lastFilename;
+  int m_filenameRepeat = 0;
+
+  // Background PNG encoder, fed with mapped readbacks
+  std::thread m_encoder;
+  std::mutex m_encoderMutex;
+  std::condition_variable m_encoderWake;
+  std::deque<Readback *> m_encoderQueue;
+  bool m_encoderStop = false;
 
   int m_allocatedWidth = 0;
   int m_allocatedHeight = 0;
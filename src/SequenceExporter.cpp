@@ -0,0 +1,352 @@
+#include "SequenceExporter.h"
+#include "OffscreenRenderer.h"
+
+#include "stb_image_write.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+static bool endsWith(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Accept exactly one "%d" / "%05d" conversion, so the pattern can be
+// passed to snprintf safely
+static bool isFramePattern(const std::string &pattern) {
+  int conversions = 0;
+  for (size_t i = 0; i < pattern.size(); i++) {
+    if (pattern[i] != '%')
+      continue;
+    if (i + 1 < pattern.size() && pattern[i + 1] == '%') {
+      i++;
+      continue;
+    }
+    size_t j = i + 1;
+    while (j < pattern.size() && pattern[j] >= '0' && pattern[j] <= '9')
+      j++;
+    if (j >= pattern.size() || pattern[j] != 'd')
+      return false;
+    conversions++;
+    i = j;
+  }
+  return conversions == 1;
+}
+
+SequenceExporter::SequenceExporter(OffscreenRenderer &renderer)
+    : m_renderer(renderer) {}
+
+SequenceExporter::~SequenceExporter() {
+  if (m_encoder.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    m_encoder.join();
+  }
+  closeOutput();
+}
+
+RenderSettings SequenceExporter::frameSettings(const RenderSettings &settings,
+                                               int index) {
+  RenderSettings frame = settings;
+  double step = 1.0 / settings.fps;
+  frame.time = (float)(settings.time + index * step);
+  frame.diskPhase =
+      settings.hasDiskPhase
+          ? (float)(settings.diskPhase + index * step * settings.blackHole.diskSpeed)
+          : frame.time * settings.blackHole.diskSpeed;
+  frame.hasDiskPhase = true;
+  return frame;
+}
+
+bool SequenceExporter::framePattern(const std::string &output,
+                                    std::string &pattern) {
+  pattern = output;
+  if (pattern.find('%') == std::string::npos) {
+    size_t dot = pattern.find_last_of('.');
+    size_t slash = pattern.find_last_of('/');
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash))
+      dot = pattern.size();
+    pattern.insert(dot, "_%05d");
+  }
+  if (!isFramePattern(pattern)) {
+    std::cerr << "Invalid frame pattern: " << pattern << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool SequenceExporter::run(const RenderSettings &settings) {
+  if (settings.frames < 1 || settings.fps <= 0.0f)
+    return false;
+  if (settings.tileSize > 0) {
+    std::cerr << "Tiled rendering is not supported for sequences"
+              << std::endl;
+    return false;
+  }
+
+  m_width = settings.width;
+  m_height = settings.height;
+  if (!openOutput(settings))
+    return false;
+
+  size_t frameBytes = (size_t)m_width * m_height * 3;
+  for (Frame &frame : m_frames) {
+    glGenBuffers(1, &frame.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  m_stop = false;
+  m_encoder = std::thread(&SequenceExporter::encoderLoop, this);
+
+  auto start = std::chrono::steady_clock::now();
+  bool ok = true;
+  Frame *previous = nullptr;
+  for (int k = 0; k < settings.frames && ok; k++) {
+    // The slot last held frame k-3; its encode must be done
+    Frame &frame = m_frames[k % FRAME_COUNT];
+    release(frame);
+    ok = frame.ok;
+
+    m_renderer.render(frameSettings(settings, k));
+    frame.index = k;
+    readBack(frame);
+
+    // Frame k-1's copy finishes ahead of frame k's draw
+    if (previous)
+      mapAndEncode(*previous);
+    previous = &frame;
+  }
+  if (previous)
+    mapAndEncode(*previous);
+
+  for (Frame &frame : m_frames) {
+    release(frame);
+    ok = ok && frame.ok;
+    glDeleteBuffers(1, &frame.pbo);
+    frame.pbo = 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  m_encoder.join();
+  closeOutput();
+
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  if (!ok) {
+    std::cerr << "Sequence export failed" << std::endl;
+    return false;
+  }
+  std::cout << "Rendered " << settings.frames << " frames (" << m_width << "x"
+            << m_height << ", " << (m_y4m ? "y4m" : "png") << ") in "
+            << seconds << " s, " << settings.frames / seconds << " fps"
+            << std::endl;
+  return true;
+}
+
+bool SequenceExporter::isY4MOutput(const std::string &output) {
+  return output == "-" || endsWith(output, ".y4m");
+}
+
+bool SequenceExporter::openOutput(const RenderSettings &settings) {
+  const std::string &output = settings.output;
+  m_y4m = isY4MOutput(output);
+
+  if (!m_y4m)
+    return framePattern(output, m_pattern);
+
+  if (output == "-") {
+    // Log output must not go to stdout in this mode; headless_main routes
+    // std::cout to stderr before anything is printed
+    std::fflush(stdout);
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    m_stream = stdout;
+    m_streamIsStdout = true;
+  } else {
+    m_stream = std::fopen(output.c_str(), "wb");
+  }
+  if (!m_stream) {
+    std::cerr << "Failed to open " << output << " for writing" << std::endl;
+    return false;
+  }
+
+  // Integral rates exactly, others as a millihertz fraction (29.97 etc.)
+  int rateNum, rateDen;
+  if (std::fabs(settings.fps - std::round(settings.fps)) < 1e-4f) {
+    rateNum = (int)std::round(settings.fps);
+    rateDen = 1;
+  } else {
+    rateNum = (int)std::round(settings.fps * 1000.0f);
+    rateDen = 1000;
+  }
+  std::fprintf(m_stream, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n",
+               m_width, m_height, rateNum, rateDen);
+  return true;
+}
+
+void SequenceExporter::closeOutput() {
+  if (!m_stream)
+    return;
+  if (m_streamIsStdout)
+    std::fflush(m_stream);
+  else
+    std::fclose(m_stream);
+  m_stream = nullptr;
+  m_streamIsStdout = false;
+}
+
+void SequenceExporter::readBack(Frame &frame) {
+  glBindFramebuffer(GL_FRAMEBUFFER, m_renderer.getOutputFBO());
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.pbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, (void *)0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+}
+
+void SequenceExporter::mapAndEncode(Frame &frame) {
+  glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  glDeleteSync(frame.fence);
+  frame.fence = nullptr;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.pbo);
+  frame.pixels = (const unsigned char *)glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, (size_t)m_width * m_height * 3,
+      GL_MAP_READ_BIT);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (!frame.pixels) {
+    std::cerr << "Failed to map frame " << frame.index << std::endl;
+    frame.ok = false;
+    return;
+  }
+
+  frame.encoded.store(false);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(&frame);
+  }
+  m_wake.notify_one();
+}
+
+// Wait for the encoder to finish with the frame and unmap its buffer
+void SequenceExporter::release(Frame &frame) {
+  if (!frame.pixels)
+    return;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return frame.encoded.load(); });
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.pbo);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  frame.pixels = nullptr;
+}
+
+void SequenceExporter::encoderLoop() {
+  for (;;) {
+    Frame *frame;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty())
+        return;
+      frame = m_queue.front();
+      m_queue.pop_front();
+    }
+
+    bool ok = m_y4m ? encodeY4M(*frame) : encodePNG(*frame);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      frame->ok = ok;
+      frame->encoded.store(true);
+    }
+    m_done.notify_all();
+  }
+}
+
+bool SequenceExporter::encodePNG(const Frame &frame) {
+  char path[1024];
+  std::snprintf(path, sizeof(path), m_pattern.c_str(), frame.index);
+
+  // GL rows are bottom-up; write from the last one with a negative stride
+  int stride = m_width * 3;
+  if (!stbi_write_png(path, m_width, m_height, 3,
+                      frame.pixels + (size_t)(m_height - 1) * stride,
+                      -stride)) {
+    std::cerr << "Failed to save image: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// BT.601 limited range, chroma averaged over 2x2 blocks (420jpeg siting)
+bool SequenceExporter::encodeY4M(const Frame &frame) {
+  const int w = m_width, h = m_height;
+  const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+  m_yuv.resize((size_t)w * h + 2 * (size_t)cw * ch);
+  unsigned char *yPlane = m_yuv.data();
+  unsigned char *uPlane = yPlane + (size_t)w * h;
+  unsigned char *vPlane = uPlane + (size_t)cw * ch;
+
+  auto row = [&](int y) {
+    return frame.pixels + (size_t)(h - 1 - y) * w * 3;
+  };
+
+  for (int y = 0; y < h; y++) {
+    const unsigned char *src = row(y);
+    unsigned char *dst = yPlane + (size_t)y * w;
+    for (int x = 0; x < w; x++) {
+      int r = src[3 * x], g = src[3 * x + 1], b = src[3 * x + 2];
+      dst[x] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+  }
+
+  for (int cy = 0; cy < ch; cy++) {
+    const unsigned char *row0 = row(2 * cy);
+    const unsigned char *row1 = row(2 * cy + 1 < h ? 2 * cy + 1 : 2 * cy);
+    for (int cx = 0; cx < cw; cx++) {
+      int x0 = 2 * cx, x1 = 2 * cx + 1 < w ? 2 * cx + 1 : 2 * cx;
+      int r = row0[3 * x0] + row0[3 * x1] + row1[3 * x0] + row1[3 * x1];
+      int g = row0[3 * x0 + 1] + row0[3 * x1 + 1] + row1[3 * x0 + 1] +
+              row1[3 * x1 + 1];
+      int b = row0[3 * x0 + 2] + row0[3 * x1 + 2] + row1[3 * x0 + 2] +
+              row1[3 * x1 + 2];
+      // Sums of four samples: fold the /4 into the shift
+      uPlane[(size_t)cy * cw + cx] =
+          (unsigned char)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+      vPlane[(size_t)cy * cw + cx] =
+          (unsigned char)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+    }
+  }
+
+  static const char frameHeader[] = "FRAME\n";
+  if (std::fwrite(frameHeader, 1, sizeof(frameHeader) - 1, m_stream) !=
+          sizeof(frameHeader) - 1 ||
+      std::fwrite(m_yuv.data(), 1, m_yuv.size(), m_stream) != m_yuv.size()) {
+    std::cerr << "Failed to write frame " << frame.index << std::endl;
+    return false;
+  }
+  return true;
+}
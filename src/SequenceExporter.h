@@ -0,0 +1,91 @@
+#ifndef SEQUENCE_EXPORTER_H
+#define SEQUENCE_EXPORTER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RenderSettings.h"
+
+class OffscreenRenderer;
+
+// Renders settings.frames frames at a fixed timestep of 1 / settings.fps,
+// starting at settings.time, and writes them as numbered PNGs or a Y4M
+// stream. Frames are pipelined: while the GPU renders frame k, frame k-1
+// is read back through a pixel buffer and frame k-2 is encoded on a
+// background thread.
+class SequenceExporter {
+public:
+  explicit SequenceExporter(OffscreenRenderer &renderer);
+  ~SequenceExporter();
+
+  SequenceExporter(const SequenceExporter &) = delete;
+  SequenceExporter &operator=(const SequenceExporter &) = delete;
+
+  // Output is Y4M if settings.output is "-" (stdout) or ends in ".y4m";
+  // otherwise a printf-style PNG pattern, "_%05d" being inserted before
+  // the extension if the name has no '%'.
+  bool run(const RenderSettings &settings);
+
+  // Settings for frame 'index' of a sequence: time and disk phase advanced
+  // by whole timesteps, never accumulated
+  static RenderSettings frameSettings(const RenderSettings &settings,
+                                      int index);
+
+  // printf-style file pattern with one "%d" / "%05d" conversion for
+  // 'output'; "_%05d" is inserted before the extension if the name has no
+  // '%'. False if the pattern is invalid.
+  static bool framePattern(const std::string &output, std::string &pattern);
+
+  // True for "-" (stdout) and ".y4m" outputs, which are video of any
+  // number of frames
+  static bool isY4MOutput(const std::string &output);
+
+private:
+  struct Frame {
+    unsigned int pbo = 0;
+    GLsync fence = nullptr;
+    int index = -1;
+    const unsigned char *pixels = nullptr; // Mapped while encoding
+    std::atomic<bool> encoded{false};
+    bool ok = true;
+  };
+  static const int FRAME_COUNT = 3;
+
+  bool openOutput(const RenderSettings &settings);
+  void closeOutput();
+  void readBack(Frame &frame);
+  void mapAndEncode(Frame &frame);
+  void release(Frame &frame);
+
+  void encoderLoop();
+  bool encodePNG(const Frame &frame);
+  bool encodeY4M(const Frame &frame);
+
+  OffscreenRenderer &m_renderer;
+  Frame m_frames[FRAME_COUNT];
+  int m_width = 0;
+  int m_height = 0;
+
+  bool m_y4m = false;
+  std::string m_pattern;
+  std::FILE *m_stream = nullptr;
+  bool m_streamIsStdout = false;
+  std::vector<unsigned char> m_yuv;
+
+  std::thread m_encoder;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  std::deque<Frame *> m_queue;
+  bool m_stop = false;
+};
+
+#endif // SEQUENCE_EXPORTER_H
@@ -1,112 +1,391 @@
 #include "Shader.h"
+#include "AssetCache.h"
+#include "UniformBuffer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
-#include <sstream>
+#include <string>
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath) {
-  // 1. Retrieve vertex/fragment source code from file paths
-  std::string vertexCode;
-  std::string fragmentCode;
-  std::ifstream vShaderFile;
-  std::ifstream fShaderFile;
+// Reads 'path', replacing each '#include "file"' line with that file's
+// contents (relative to the including file). #line directives keep driver
+// error messages pointing at the right file: source string N is the Nth
+// file read, 0 being the top-level one.
+static bool readShaderSource(const std::string &path, std::string &out,
+                             int &fileCount, int depth) {
+  if (depth > 8) {
+    std::cerr << "ERROR::SHADER::INCLUDE_DEPTH_EXCEEDED: " << path
+              << std::endl;
+    return false;
+  }
+
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path
+              << std::endl;
+    return false;
+  }
 
-  vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  std::string directory;
+  size_t slash = path.find_last_of('/');
+  if (slash != std::string::npos)
+    directory = path.substr(0, slash + 1);
 
-  try {
-    vShaderFile.open(vertexPath);
-    fShaderFile.open(fragmentPath);
-    std::stringstream vShaderStream, fShaderStream;
+  int sourceIndex = fileCount++;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos ||
+        line.compare(start, 8, "#include") != 0) {
+      out += line;
+      out += '\n';
+      continue;
+    }
 
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
+    size_t open = line.find('"', start);
+    size_t close =
+        open == std::string::npos ? open : line.find('"', open + 1);
+    if (close == std::string::npos) {
+      std::cerr << path << ":" << lineNumber << ": malformed #include"
+                << std::endl;
+      return false;
+    }
+    out += "#line 1 " + std::to_string(fileCount) + "\n";
+    if (!readShaderSource(directory + line.substr(open + 1, close - open - 1),
+                          out, fileCount, depth + 1))
+      return false;
+    out += "#line " + std::to_string(lineNumber + 1) + " " +
+           std::to_string(sourceIndex) + "\n";
+  }
+  return true;
+}
 
-    vShaderFile.close();
-    fShaderFile.close();
+// Insert one #define per entry after the #version line, followed by a
+// #line directive so the rest of the file keeps its line numbers
+static void injectDefines(std::string &code, const ShaderDefines &defines) {
+  if (defines.empty())
+    return;
 
-    vertexCode = vShaderStream.str();
-    fragmentCode = fShaderStream.str();
-  } catch (std::ifstream::failure &e) {
-    std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what()
-              << std::endl;
+  size_t insert = 0;
+  int nextLine = 1;
+  size_t version = code.find("#version");
+  if (version != std::string::npos) {
+    size_t end = code.find('\n', version);
+    insert = end == std::string::npos ? code.size() : end + 1;
+    nextLine = (int)std::count(code.begin(), code.begin() + insert, '\n') + 1;
   }
 
-  const char *vShaderCode = vertexCode.c_str();
-  const char *fShaderCode = fragmentCode.c_str();
+  std::string block;
+  for (const std::string &define : defines)
+    block += "#define " + define + "\n";
+  block += "#line " + std::to_string(nextLine) + " 0\n";
+  code.insert(insert, block);
+}
+
+bool ShaderSource::load(const char *vertexPath, const char *fragmentPath,
+                        const ShaderDefines &defines) {
+  vertex.clear();
+  fragment.clear();
+  compute.clear();
+  int fileCount = 0;
+  bool ok = readShaderSource(vertexPath, vertex, fileCount, 0);
+  fileCount = 0;
+  ok = readShaderSource(fragmentPath, fragment, fileCount, 0) && ok;
+  injectDefines(vertex, defines);
+  injectDefines(fragment, defines);
+
+  hash = hashBytes(vertex.data(), vertex.size());
+  hash = hashBytes("", 1, hash); // Stage separator
+  hash = hashBytes(fragment.data(), fragment.size(), hash);
+  return ok;
+}
+
+bool ShaderSource::loadCompute(const char *computePath,
+                               const ShaderDefines &defines) {
+  vertex.clear();
+  fragment.clear();
+  compute.clear();
+  int fileCount = 0;
+  bool ok = readShaderSource(computePath, compute, fileCount, 0);
+  injectDefines(compute, defines);
+
+  // Separators keep it apart from a vertex + fragment pair
+  hash = hashBytes("", 1);
+  hash = hashBytes("", 1, hash);
+  hash = hashBytes(compute.data(), compute.size(), hash);
+  return ok;
+}
+
+static ShaderSource loadSource(const char *vertexPath, const char *fragmentPath,
+                               const ShaderDefines &defines) {
+  ShaderSource source;
+  source.load(vertexPath, fragmentPath, defines);
+  return source;
+}
 
-  // 2. Compile shaders
-  unsigned int vertex, fragment;
+// ARB_get_program_binary with at least one format (some drivers have the
+// entry points but no formats)
+static bool programBinariesSupported() {
+  static int supported = -1;
+  if (supported < 0) {
+    GLint formats = 0;
+    if (GLAD_GL_ARB_get_program_binary)
+      glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    supported = formats > 0;
+  }
+  return supported != 0;
+}
 
-  // Vertex Shader
-  vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &vShaderCode, NULL);
-  glCompileShader(vertex);
-  checkCompileErrors(vertex, "VERTEX");
+// Binaries are only valid for the driver that produced them
+static AssetCacheHeader programCacheHeader(uint64_t binaryHash) {
+  AssetCacheHeader header = makeAssetCacheHeader();
+  header.sourceHash = binaryHash;
+  return header;
+}
 
-  // Fragment Shader
-  fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &fShaderCode, NULL);
-  glCompileShader(fragment);
-  checkCompileErrors(fragment, "FRAGMENT");
+Shader::Shader(const char *vertexPath, const char *fragmentPath,
+               const ShaderDefines &defines)
+    : Shader(loadSource(vertexPath, fragmentPath, defines)) {}
 
-  // Shader Program
+Shader::Shader(const ShaderSource &source) {
   ID = glCreateProgram();
-  glAttachShader(ID, vertex);
-  glAttachShader(ID, fragment);
+
+  if (programBinariesSupported()) {
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+    const char *version = (const char *)glGetString(GL_VERSION);
+    m_binaryHash = hashBytes(renderer, strlen(renderer), source.hash);
+    m_binaryHash = hashBytes(version, strlen(version), m_binaryHash);
+
+    char name[64];
+    snprintf(name, sizeof(name), "program_%016llx.bhc",
+             (unsigned long long)m_binaryHash);
+    m_binaryPath = assetCachePath(name);
+    m_fromBinary = loadBinary();
+  }
+
+  if (!m_fromBinary)
+    compile(source);
+}
+
+// Payload: the binary format (uint32) followed by the program binary
+bool Shader::loadBinary() {
+  MappedAssetCache cached;
+  if (!cached.open(m_binaryPath, programCacheHeader(m_binaryHash)) ||
+      cached.getPayloadSize() <= sizeof(uint32_t))
+    return false;
+
+  uint32_t format;
+  const char *payload = static_cast<const char *>(cached.getPayload());
+  memcpy(&format, payload, sizeof(format));
+  glProgramBinary(ID, format, payload + sizeof(format),
+                  (GLsizei)(cached.getPayloadSize() - sizeof(format)));
+
+  // A driver can reject its own older binaries; the caller then compiles
+  // and the entry is rewritten
+  GLint linked = 0;
+  glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+  return linked != 0;
+}
+
+void Shader::storeBinary() const {
+  GLint linked = 0;
+  glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+  GLint length = 0;
+  glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (!linked || length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+  AssetCacheHeader header = programCacheHeader(m_binaryHash);
+  header.payloadSize = sizeof(uint32_t) + (uint64_t)length;
+  uint32_t storedFormat = format;
+  AssetCacheWriter writer;
+  if (writer.begin(m_binaryPath, header) &&
+      writer.write(&storedFormat, sizeof(storedFormat)) &&
+      writer.write(binary.data(), length))
+    writer.commit();
+}
+
+// Issue the compile and link without waiting for either
+void Shader::compile(const ShaderSource &source) {
+  if (!source.compute.empty()) {
+    const char *cShaderCode = source.compute.c_str();
+    m_compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(m_compute, 1, &cShaderCode, NULL);
+    glCompileShader(m_compute);
+
+    glAttachShader(ID, m_compute);
+    if (!m_binaryPath.empty())
+      glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(ID);
+    return;
+  }
+
+  const char *vShaderCode = source.vertex.c_str();
+  const char *fShaderCode = source.fragment.c_str();
+
+  m_vertex = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(m_vertex, 1, &vShaderCode, NULL);
+  glCompileShader(m_vertex);
+
+  m_fragment = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(m_fragment, 1, &fShaderCode, NULL);
+  glCompileShader(m_fragment);
+
+  glAttachShader(ID, m_vertex);
+  glAttachShader(ID, m_fragment);
+  if (!m_binaryPath.empty())
+    glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   glLinkProgram(ID);
-  checkCompileErrors(ID, "PROGRAM");
+}
+
+void Shader::finishLink() const {
+  if (m_linked)
+    return;
+  m_linked = true;
 
-  // Delete shaders as they're linked
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
+  if (m_vertex) {
+    checkCompileErrors(m_vertex, "VERTEX");
+    checkCompileErrors(m_fragment, "FRAGMENT");
+    checkCompileErrors(ID, "PROGRAM");
+
+    // Delete shaders as they're linked
+    glDeleteShader(m_vertex);
+    glDeleteShader(m_fragment);
+    m_vertex = 0;
+    m_fragment = 0;
+
+    if (!m_binaryPath.empty())
+      storeBinary();
+  } else if (m_compute) {
+    checkCompileErrors(m_compute, "COMPUTE");
+    checkCompileErrors(ID, "PROGRAM");
+    glDeleteShader(m_compute);
+    m_compute = 0;
+
+    if (!m_binaryPath.empty())
+      storeBinary();
+  }
+  reflect();
 }
 
-Shader::~Shader() { glDeleteProgram(ID); }
+Shader::~Shader() {
+  if (m_vertex) {
+    glDeleteShader(m_vertex);
+    glDeleteShader(m_fragment);
+  }
+  if (m_compute)
+    glDeleteShader(m_compute);
+  glDeleteProgram(ID);
+}
+
+bool Shader::isReady() const {
+  if (m_linked || !GLAD_GL_KHR_parallel_shader_compile)
+    return true;
+  GLint done = 0;
+  glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+  return done != 0;
+}
 
-void Shader::use() const { glUseProgram(ID); }
+void Shader::use() const {
+  finishLink();
+  glUseProgram(ID);
+}
+
+void Shader::reflect() const {
+  GLint linked = 0;
+  glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+  if (!linked)
+    return;
+
+  char name[256];
+  GLint count = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  for (GLint i = 0; i < count; i++) {
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(ID, i, sizeof(name), NULL, &size, &type, name);
+    // Block members have no location; they are set through UniformBuffer
+    GLint location = glGetUniformLocation(ID, name);
+    if (location < 0)
+      continue;
+    char *bracket = strchr(name, '[');
+    if (bracket)
+      *bracket = '\0';
+    m_uniforms.push_back({name, location});
+  }
+
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+  for (GLint i = 0; i < count; i++) {
+    glGetActiveUniformBlockName(ID, i, sizeof(name), NULL, name);
+    int binding = uniformBlockBinding(name);
+    if (binding < 0) {
+      std::cerr << "ERROR::SHADER::UNKNOWN_UNIFORM_BLOCK: " << name
+                << std::endl;
+      continue;
+    }
+    glUniformBlockBinding(ID, i, binding);
+  }
+}
+
+int Shader::getUniformLocation(const char *name) const {
+  finishLink();
+  for (const Uniform &uniform : m_uniforms) {
+    if (uniform.name == name)
+      return uniform.location;
+  }
+  return -1;
+}
 
-void Shader::setBool(const std::string &name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+void Shader::setBool(const char *name, bool value) const {
+  glUniform1i(getUniformLocation(name), (int)value);
 }
 
-void Shader::setInt(const std::string &name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setInt(const char *name, int value) const {
+  glUniform1i(getUniformLocation(name), value);
 }
 
-void Shader::setFloat(const std::string &name, float value) const {
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setFloat(const char *name, float value) const {
+  glUniform1f(getUniformLocation(name), value);
 }
 
-void Shader::setVec2(const std::string &name, const glm::vec2 &value) const {
-  glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1,
+void Shader::setVec2(const char *name, const glm::vec2 &value) const {
+  glUniform2fv(getUniformLocation(name), 1,
                glm::value_ptr(value));
 }
 
-void Shader::setVec2(const std::string &name, float x, float y) const {
-  glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+void Shader::setVec2(const char *name, float x, float y) const {
+  glUniform2f(getUniformLocation(name), x, y);
 }
 
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-  glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1,
+void Shader::setVec3(const char *name, const glm::vec3 &value) const {
+  glUniform3fv(getUniformLocation(name), 1,
                glm::value_ptr(value));
 }
 
-void Shader::setVec3(const std::string &name, float x, float y, float z) const {
-  glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+void Shader::setVec3(const char *name, float x, float y, float z) const {
+  glUniform3f(getUniformLocation(name), x, y, z);
 }
 
-void Shader::setVec4(const std::string &name, const glm::vec4 &value) const {
-  glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1,
+void Shader::setVec4(const char *name, const glm::vec4 &value) const {
+  glUniform4fv(getUniformLocation(name), 1,
                glm::value_ptr(value));
 }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+void Shader::setMat4(const char *name, const glm::mat4 &mat) const {
+  glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE,
                      glm::value_ptr(mat));
 }
 
-void Shader::checkCompileErrors(unsigned int shader, const std::string &type) {
+void Shader::checkCompileErrors(unsigned int shader,
+                                const std::string &type) const {
   int success;
   char infoLog[1024];
   if (type != "PROGRAM") {
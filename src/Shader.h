@@ -3,30 +3,92 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
+#include <vector>
 
+// "NAME" or "NAME VALUE", injected as #define lines after #version
+typedef std::vector<std::string> ShaderDefines;
+
+// Sources of one program with #includes expanded and defines injected:
+// vertex + fragment, or a lone compute stage. 'hash' identifies the
+// program (ShaderCache keys on it).
+struct ShaderSource {
+  std::string vertex;
+  std::string fragment;
+  std::string compute;
+  uint64_t hash = 0;
+
+  bool load(const char *vertexPath, const char *fragmentPath,
+            const ShaderDefines &defines = ShaderDefines());
+  // Compute programs need GL 4.3 or ARB_compute_shader
+  bool loadCompute(const char *computePath,
+                   const ShaderDefines &defines = ShaderDefines());
+};
+
+// A linked program. Construction only issues the compile (or loads a
+// cached program binary); the first use() or setter waits for the link,
+// so drivers with KHR_parallel_shader_compile build several programs at
+// once. Prefer ShaderCache::get(), which shares identical programs.
 class Shader {
 public:
   unsigned int ID;
 
-  Shader(const char *vertexPath, const char *fragmentPath);
+  Shader(const char *vertexPath, const char *fragmentPath,
+         const ShaderDefines &defines = ShaderDefines());
+  explicit Shader(const ShaderSource &source);
   ~Shader();
 
+  Shader(const Shader &) = delete;
+  Shader &operator=(const Shader &) = delete;
+
   void use() const;
 
+  // False while the driver is still compiling in the background; never
+  // blocks
+  bool isReady() const;
+  // True if the program came from the binary cache instead of a compile
+  bool isFromBinary() const { return m_fromBinary; }
+
+  // Location of an active default-block uniform (arrays by their base
+  // name), -1 if the program doesn't use it. Locations are reflected once
+  // at link time, so the setters never ask the driver.
+  int getUniformLocation(const char *name) const;
+
   // Uniform setters
-  void setBool(const std::string &name, bool value) const;
-  void setInt(const std::string &name, int value) const;
-  void setFloat(const std::string &name, float value) const;
-  void setVec2(const std::string &name, const glm::vec2 &value) const;
-  void setVec2(const std::string &name, float x, float y) const;
-  void setVec3(const std::string &name, const glm::vec3 &value) const;
-  void setVec3(const std::string &name, float x, float y, float z) const;
-  void setVec4(const std::string &name, const glm::vec4 &value) const;
-  void setMat4(const std::string &name, const glm::mat4 &mat) const;
+  void setBool(const char *name, bool value) const;
+  void setInt(const char *name, int value) const;
+  void setFloat(const char *name, float value) const;
+  void setVec2(const char *name, const glm::vec2 &value) const;
+  void setVec2(const char *name, float x, float y) const;
+  void setVec3(const char *name, const glm::vec3 &value) const;
+  void setVec3(const char *name, float x, float y, float z) const;
+  void setVec4(const char *name, const glm::vec4 &value) const;
+  void setMat4(const char *name, const glm::mat4 &mat) const;
 
 private:
-  void checkCompileErrors(unsigned int shader, const std::string &type);
+  struct Uniform {
+    std::string name;
+    int location;
+  };
+
+  void compile(const ShaderSource &source);
+  bool loadBinary();
+  void storeBinary() const;
+  // Wait for the link, report errors and reflect; once
+  void finishLink() const;
+  void checkCompileErrors(unsigned int shader, const std::string &type) const;
+  // Cache uniform locations and bind uniform blocks to their binding points
+  void reflect() const;
+
+  std::string m_binaryPath;
+  uint64_t m_binaryHash = 0;
+  bool m_fromBinary = false;
+  mutable unsigned int m_vertex = 0;
+  mutable unsigned int m_fragment = 0;
+  mutable unsigned int m_compute = 0;
+  mutable bool m_linked = false;
+  mutable std::vector<Uniform> m_uniforms;
 };
 
 #endif
@@ -0,0 +1,47 @@
+#include "ShaderCache.h"
+
+#include <unordered_map>
+
+static std::unordered_map<uint64_t, std::weak_ptr<Shader>> s_programs;
+static ShaderCache::Stats s_stats;
+
+static std::shared_ptr<Shader> getProgram(const ShaderSource &source) {
+  // Let the driver compile on as many threads as it likes; programs are
+  // only waited for at their first use
+  static bool parallelCompile = false;
+  if (!parallelCompile && GLAD_GL_KHR_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    parallelCompile = true;
+  }
+
+  std::weak_ptr<Shader> &entry = s_programs[source.hash];
+  if (std::shared_ptr<Shader> shader = entry.lock()) {
+    s_stats.shared++;
+    return shader;
+  }
+
+  std::shared_ptr<Shader> shader = std::make_shared<Shader>(source);
+  if (shader->isFromBinary())
+    s_stats.fromBinary++;
+  else
+    s_stats.compiled++;
+  entry = shader;
+  return shader;
+}
+
+std::shared_ptr<Shader> ShaderCache::get(const char *vertexPath,
+                                         const char *fragmentPath,
+                                         const ShaderDefines &defines) {
+  ShaderSource source;
+  source.load(vertexPath, fragmentPath, defines);
+  return getProgram(source);
+}
+
+std::shared_ptr<Shader> ShaderCache::getCompute(const char *computePath,
+                                                const ShaderDefines &defines) {
+  ShaderSource source;
+  source.loadCompute(computePath, defines);
+  return getProgram(source);
+}
+
+const ShaderCache::Stats &ShaderCache::getStats() { return s_stats; }
@@ -0,0 +1,33 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "Shader.h"
+
+#include <memory>
+
+// Process-wide program registry. get() returns the live instance built
+// from the same expanded sources and defines when there is one, so users
+// of identical programs (e.g. the bloom composite and the exporter) share
+// it. A program is deleted when its last holder releases it, which keeps
+// GL objects inside their owners' init()/shutdown(). New programs come
+// from the binary cache when possible (see Shader).
+class ShaderCache {
+public:
+  struct Stats {
+    int compiled = 0;   // Built from source
+    int fromBinary = 0; // Loaded from the binary cache
+    int shared = 0;     // Requests answered with a live instance
+  };
+
+  static std::shared_ptr<Shader>
+  get(const char *vertexPath, const char *fragmentPath,
+      const ShaderDefines &defines = ShaderDefines());
+  // Same for a compute program (ShaderSource::loadCompute())
+  static std::shared_ptr<Shader>
+  getCompute(const char *computePath,
+             const ShaderDefines &defines = ShaderDefines());
+
+  static const Stats &getStats();
+};
+
+#endif // SHADER_CACHE_H
@@ -0,0 +1,276 @@
+#include "SharedFrameOutput.h"
+#include "AssetCache.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static const char SHARED_FRAME_MAGIC[8] = {'B', 'H', 'F', 'R', 'A', 'M', 'E', 0};
+
+// Slots are page aligned and their pixels cache-line aligned
+static const size_t PAGE_SIZE_BYTES = 4096;
+static const size_t PIXEL_OFFSET = 64;
+
+static size_t alignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Wake every consumer blocked on 'word'. Without futexes consumers poll.
+static void wakeConsumers(uint32_t *word) {
+#if defined(__linux__)
+  syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+
+uint64_t hashFrameParams(const BlackHoleParams &blackHole,
+                         const CameraParams &camera, const BloomParams &bloom) {
+  // Field by field, so struct padding never reaches the hash
+  const float values[] = {blackHole.radius,        blackHole.diskInnerRadius,
+                          blackHole.diskOuterRadius, blackHole.diskThickness,
+                          blackHole.diskColor1.x,  blackHole.diskColor1.y,
+                          blackHole.diskColor1.z,  blackHole.diskColor2.x,
+                          blackHole.diskColor2.y,  blackHole.diskColor2.z,
+                          blackHole.glowIntensity, blackHole.diskSpeed,
+                          camera.distance,         camera.angle,
+                          bloom.threshold,         bloom.intensity,
+                          bloom.strength,          bloom.exposure,
+                          bloom.radius,            bloom.enabled ? 1.0f : 0.0f};
+  return hashBytes(values, sizeof(values));
+}
+
+SharedFrameOutput::SharedFrameOutput() {}
+
+SharedFrameOutput::~SharedFrameOutput() { close(); }
+
+bool SharedFrameOutput::open(const std::string &name, int width, int height,
+                             uint32_t content, int slotCount) {
+  close();
+  content &= SHARED_FRAME_HDR | SHARED_FRAME_LDR;
+  if (name.empty() || width <= 0 || height <= 0 || !content ||
+      slotCount < 2)
+    return false;
+
+#if !defined(_WIN32)
+  m_name = name[0] == '/' ? name : "/" + name;
+  m_width = width;
+  m_height = height;
+  m_content = content;
+  size_t pixels = (size_t)width * height;
+  m_hdrBytes = content & SHARED_FRAME_HDR ? alignUp(pixels * 8, PIXEL_OFFSET) : 0;
+  m_ldrBytes = content & SHARED_FRAME_LDR ? pixels * 4 : 0;
+  size_t slotSize = alignUp(PIXEL_OFFSET + m_hdrBytes + m_ldrBytes,
+                            PAGE_SIZE_BYTES);
+  m_size = PAGE_SIZE_BYTES + slotSize * slotCount;
+
+  // Tell consumers of a ring left by an earlier producer that it is gone
+  int fd = shm_open(m_name.c_str(), O_RDWR, 0);
+  if (fd >= 0) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(SharedFrameHeader)) {
+      void *old = mmap(nullptr, sizeof(SharedFrameHeader),
+                       PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (old != MAP_FAILED) {
+        SharedFrameHeader *header = static_cast<SharedFrameHeader *>(old);
+        __atomic_store_n(&header->closed, 1u, __ATOMIC_RELEASE);
+        wakeConsumers(&header->published);
+        munmap(old, sizeof(SharedFrameHeader));
+      }
+    }
+    ::close(fd);
+    shm_unlink(m_name.c_str());
+  }
+
+  fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    std::cerr << "Failed to create shared memory " << m_name << ": "
+              << strerror(errno) << std::endl;
+    return false;
+  }
+  void *mapping = MAP_FAILED;
+  if (ftruncate(fd, (off_t)m_size) == 0)
+    mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Failed to map shared memory " << m_name << ": "
+              << strerror(errno) << std::endl;
+    shm_unlink(m_name.c_str());
+    return false;
+  }
+
+  // A new object is zero filled
+  m_header = static_cast<SharedFrameHeader *>(mapping);
+  memcpy(m_header->magic, SHARED_FRAME_MAGIC, sizeof(m_header->magic));
+  m_header->version = SHARED_FRAME_VERSION;
+  m_header->headerSize = sizeof(SharedFrameHeader);
+  m_header->width = (uint32_t)width;
+  m_header->height = (uint32_t)height;
+  m_header->content = content;
+  m_header->slotCount = (uint32_t)slotCount;
+  m_header->slotOffset = PAGE_SIZE_BYTES;
+  m_header->slotSize = slotSize;
+  m_header->hdrOffset = m_hdrBytes ? PIXEL_OFFSET : 0;
+  m_header->ldrOffset = m_ldrBytes ? PIXEL_OFFSET + m_hdrBytes : 0;
+  m_nextSlot = 0;
+
+  // Same layout as a slot's pixels, so publishing is one copy
+  for (Readback &readback : m_readbacks) {
+    glGenBuffers(1, &readback.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, m_hdrBytes + m_ldrBytes, NULL,
+                 GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  std::cout << "Streaming " << width << "x" << height << " frames ("
+            << (content & SHARED_FRAME_HDR ? "HDR" : "")
+            << (content == (SHARED_FRAME_HDR | SHARED_FRAME_LDR) ? " + " : "")
+            << (content & SHARED_FRAME_LDR ? "LDR" : "") << ", " << slotCount
+            << " slots) to shared memory " << m_name << std::endl;
+  return true;
+#else
+  (void)slotCount;
+  std::cerr << "Shared-memory output needs POSIX shared memory" << std::endl;
+  return false;
+#endif
+}
+
+void SharedFrameOutput::close() {
+  if (!m_header)
+    return;
+
+  update(true);
+  deleteReadbacks();
+  __atomic_store_n(&m_header->closed, 1u, __ATOMIC_RELEASE);
+  wakeConsumers(&m_header->published);
+#if !defined(_WIN32)
+  munmap(m_header, m_size);
+#endif
+  m_header = nullptr;
+  m_size = 0;
+}
+
+void SharedFrameOutput::capture(unsigned int sceneTexture,
+                                unsigned int outputFBO,
+                                const SharedFrameSlot &info) {
+  if (!m_header)
+    return;
+
+  // Every buffer in flight: the oldest frame has to land first
+  if (m_pendingCount == READBACK_COUNT) {
+    publish(m_readbacks[m_firstPending], true);
+    m_firstPending = (m_firstPending + 1) % READBACK_COUNT;
+    m_pendingCount--;
+  }
+
+  Readback &readback =
+      m_readbacks[(m_firstPending + m_pendingCount) % READBACK_COUNT];
+  readback.info = info;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  if (m_hdrBytes) {
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_HALF_FLOAT, (void *)0);
+  }
+  if (m_ldrBytes) {
+    GLint readFBO = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFBO);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 (void *)m_hdrBytes);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+  m_pendingCount++;
+}
+
+void SharedFrameOutput::update(bool wait) {
+  while (m_pendingCount > 0) {
+    Readback &readback = m_readbacks[m_firstPending];
+    if (!wait) {
+      GLenum status = glClientWaitSync(readback.fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return;
+    }
+    publish(readback, true);
+    m_firstPending = (m_firstPending + 1) % READBACK_COUNT;
+    m_pendingCount--;
+  }
+}
+
+// Copy a finished readback into the next slot under its seqlock, then
+// announce it
+void SharedFrameOutput::publish(Readback &readback, bool wait) {
+  if (wait)
+    glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                     GL_TIMEOUT_IGNORED);
+  glDeleteSync(readback.fence);
+  readback.fence = nullptr;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+  const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                        m_hdrBytes + m_ldrBytes,
+                                        GL_MAP_READ_BIT);
+  if (!pixels) {
+    std::cerr << "Failed to map frame " << readback.info.frameIndex
+              << " for shared memory" << std::endl;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return;
+  }
+
+  uint32_t index = m_nextSlot;
+  m_nextSlot = (m_nextSlot + 1) % m_header->slotCount;
+  unsigned char *base = reinterpret_cast<unsigned char *>(m_header) +
+                        m_header->slotOffset + index * m_header->slotSize;
+  SharedFrameSlot *slot = reinterpret_cast<SharedFrameSlot *>(base);
+
+  uint32_t sequence = slot->sequence;
+  __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->frameIndex = readback.info.frameIndex;
+  slot->paramsHash = readback.info.paramsHash;
+  slot->timestampNs = readback.info.timestampNs;
+  slot->time = readback.info.time;
+  slot->diskPhase = readback.info.diskPhase;
+  memcpy(base + PIXEL_OFFSET, pixels, m_hdrBytes + m_ldrBytes);
+  __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  __atomic_store_n(&m_header->latestSlot, index, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&m_header->published, 1u, __ATOMIC_RELEASE);
+  wakeConsumers(&m_header->published);
+}
+
+void SharedFrameOutput::deleteReadbacks() {
+  for (Readback &readback : m_readbacks) {
+    if (readback.fence) {
+      glDeleteSync(readback.fence);
+      readback.fence = nullptr;
+    }
+    if (readback.pbo) {
+      glDeleteBuffers(1, &readback.pbo);
+      readback.pbo = 0;
+    }
+  }
+  m_firstPending = 0;
+  m_pendingCount = 0;
+}
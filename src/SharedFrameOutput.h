@@ -0,0 +1,130 @@
+#ifndef SHARED_FRAME_OUTPUT_H
+#define SHARED_FRAME_OUTPUT_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "BlackHoleRenderer.h"
+#include "BloomRenderer.h"
+
+// Frame ring in a POSIX shared-memory object, for a local consumer such as
+// a compositor. The object starts with a SharedFrameHeader; slotCount
+// slots follow at slotOffset, slotSize apart, each a SharedFrameSlot
+// followed by the frame's pixels (rows bottom-up, tightly packed):
+//   HDR: RGBA16F scene before bloom and tone mapping, at hdrOffset
+//   LDR: RGBA8 tone-mapped output, at ldrOffset
+//
+// Reading: shm_open() the name read-only and map it; wait until
+// 'published' changes (FUTEX_WAIT on it on Linux, or poll), then read the
+// pixels of slot 'latestSlot' in place. The slot is consistent if its
+// 'sequence' was even before reading and unchanged after. A producer that
+// exits or resizes sets 'closed'; map the name again to follow it. The
+// object outlives the producer until the next one replaces it.
+
+static const uint32_t SHARED_FRAME_VERSION = 1;
+static const uint32_t SHARED_FRAME_HDR = 1;
+static const uint32_t SHARED_FRAME_LDR = 2;
+
+struct SharedFrameHeader {
+  char magic[8];        // "BHFRAME\0"
+  uint32_t version;     // SHARED_FRAME_VERSION
+  uint32_t headerSize;  // sizeof(SharedFrameHeader)
+  uint32_t width;
+  uint32_t height;
+  uint32_t content;     // SHARED_FRAME_HDR | SHARED_FRAME_LDR
+  uint32_t slotCount;
+  uint64_t slotOffset;  // Start of slot 0 in the object
+  uint64_t slotSize;    // Stride between slots
+  uint64_t hdrOffset;   // Pixel offsets within a slot, 0 if not streamed
+  uint64_t ldrOffset;
+  uint32_t published;   // Frames published so far (futex word)
+  uint32_t latestSlot;  // Slot of the newest frame
+  uint32_t closed;
+  uint32_t reserved;
+};
+static_assert(sizeof(SharedFrameHeader) == 80,
+              "SharedFrameHeader must not contain padding");
+
+struct SharedFrameSlot {
+  uint32_t sequence;    // Odd while the slot is being written
+  uint32_t reserved;
+  uint64_t frameIndex;
+  uint64_t paramsHash;  // hashFrameParams() of the frame
+  uint64_t timestampNs; // CLOCK_MONOTONIC when the frame was rendered
+  float time;           // Shader time
+  float diskPhase;
+};
+static_assert(sizeof(SharedFrameSlot) == 40,
+              "SharedFrameSlot must not contain padding");
+
+// Identifies the look of a frame (black hole, camera and bloom settings),
+// so a consumer can tell parameter changes from animation
+uint64_t hashFrameParams(const BlackHoleParams &blackHole,
+                         const CameraParams &camera, const BloomParams &bloom);
+
+// Writer side. Frames are read back through a small ring of pixel buffers
+// and copied into the next slot once their fence has signalled, so the
+// render loop never waits on the GPU unless every buffer is in flight.
+class SharedFrameOutput {
+public:
+  SharedFrameOutput();
+  ~SharedFrameOutput();
+
+  SharedFrameOutput(const SharedFrameOutput &) = delete;
+  SharedFrameOutput &operator=(const SharedFrameOutput &) = delete;
+
+  // Create the object 'name' (a leading '/' is added if missing) for
+  // width x height frames of 'content', replacing any existing one
+  bool open(const std::string &name, int width, int height, uint32_t content,
+            int slotCount = 4);
+  // Publish the frames still in flight and mark the ring closed
+  void close();
+  bool isOpen() const { return m_header != nullptr; }
+
+  const std::string &getName() const { return m_name; }
+  int getWidth() const { return m_width; }
+  int getHeight() const { return m_height; }
+  uint32_t getContent() const { return m_content; }
+  // Frames read back but not yet published
+  int getPendingCount() const { return m_pendingCount; }
+
+  // Queue the readback of a frame: HDR from 'sceneTexture' (RGBA16F),
+  // LDR from color buffer 0 of 'outputFBO' (the back buffer if 0). Both
+  // must be the ring's size. 'info' supplies the slot fields other than
+  // the sequence.
+  void capture(unsigned int sceneTexture, unsigned int outputFBO,
+               const SharedFrameSlot &info);
+
+  // Publish readbacks whose fence has signalled; 'wait' blocks for all
+  void update(bool wait = false);
+
+private:
+  struct Readback {
+    unsigned int pbo = 0;
+    GLsync fence = nullptr;
+    SharedFrameSlot info = {};
+  };
+  static const int READBACK_COUNT = 3;
+
+  void publish(Readback &readback, bool wait);
+  void deleteReadbacks();
+
+  std::string m_name;
+  SharedFrameHeader *m_header = nullptr;
+  size_t m_size = 0;
+  int m_width = 0;
+  int m_height = 0;
+  uint32_t m_content = 0;
+  size_t m_hdrBytes = 0;
+  size_t m_ldrBytes = 0;
+
+  Readback m_readbacks[READBACK_COUNT];
+  int m_firstPending = 0;
+  int m_pendingCount = 0;
+  uint32_t m_nextSlot = 0;
+};
+
+#endif // SHARED_FRAME_OUTPUT_H
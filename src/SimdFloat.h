@@ -0,0 +1,172 @@
+#ifndef SIMD_FLOAT_H
+#define SIMD_FLOAT_H
+
+// Thin wrapper over the widest float vector the compiler targets:
+// 16 lanes with AVX-512, 8 with AVX2, otherwise a 1-lane scalar fallback.
+// Only the operations the CPU tracer and noise baker need are provided;
+// anything transcendental is done per lane through simdStore/simdLoad.
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define SIMD_FLOAT_AVX512 1
+constexpr int kSimdWidth = 16;
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_FLOAT_AVX2 1
+constexpr int kSimdWidth = 8;
+#else
+constexpr int kSimdWidth = 1;
+#endif
+
+#include <cmath>
+
+#if defined(SIMD_FLOAT_AVX512)
+
+struct SimdFloat {
+  __m512 v;
+  SimdFloat() : v(_mm512_setzero_ps()) {}
+  SimdFloat(float s) : v(_mm512_set1_ps(s)) {}
+  SimdFloat(__m512 x) : v(x) {}
+};
+struct SimdMask {
+  __mmask16 m;
+  SimdMask() : m(0) {}
+  SimdMask(__mmask16 x) : m(x) {}
+};
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return _mm512_add_ps(a.v, b.v); }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return _mm512_sub_ps(a.v, b.v); }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return _mm512_mul_ps(a.v, b.v); }
+inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return _mm512_div_ps(a.v, b.v); }
+inline SimdFloat operator-(SimdFloat a) { return _mm512_sub_ps(_mm512_setzero_ps(), a.v); }
+inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return _mm512_min_ps(a.v, b.v); }
+inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return _mm512_max_ps(a.v, b.v); }
+inline SimdFloat simdSqrt(SimdFloat a) { return _mm512_sqrt_ps(a.v); }
+inline SimdFloat simdAbs(SimdFloat a) { return _mm512_abs_ps(a.v); }
+inline SimdFloat simdFloor(SimdFloat a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+inline SimdMask operator<(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+inline SimdMask operator<=(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ); }
+inline SimdMask operator>(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMask operator>=(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ); }
+inline SimdMask operator==(SimdFloat a, SimdFloat b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ); }
+inline SimdMask operator&(SimdMask a, SimdMask b) { return (__mmask16)(a.m & b.m); }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return (__mmask16)(a.m | b.m); }
+inline SimdMask operator~(SimdMask a) { return (__mmask16)(~a.m); }
+inline bool simdAny(SimdMask a) { return a.m != 0; }
+inline bool simdLane(SimdMask a, int lane) { return (a.m >> lane) & 1; }
+
+// mask ? a : b
+inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) { return _mm512_mask_blend_ps(mask.m, b.v, a.v); }
+inline SimdFloat simdLoad(const float *p) { return _mm512_loadu_ps(p); }
+inline void simdStore(float *p, SimdFloat a) { _mm512_storeu_ps(p, a.v); }
+
+#elif defined(SIMD_FLOAT_AVX2)
+
+struct SimdFloat {
+  __m256 v;
+  SimdFloat() : v(_mm256_setzero_ps()) {}
+  SimdFloat(float s) : v(_mm256_set1_ps(s)) {}
+  SimdFloat(__m256 x) : v(x) {}
+};
+struct SimdMask {
+  __m256 m;
+  SimdMask() : m(_mm256_setzero_ps()) {}
+  SimdMask(__m256 x) : m(x) {}
+};
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a.v, b.v); }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return _mm256_sub_ps(a.v, b.v); }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return _mm256_mul_ps(a.v, b.v); }
+inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return _mm256_div_ps(a.v, b.v); }
+inline SimdFloat operator-(SimdFloat a) { return _mm256_sub_ps(_mm256_setzero_ps(), a.v); }
+inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return _mm256_min_ps(a.v, b.v); }
+inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return _mm256_max_ps(a.v, b.v); }
+inline SimdFloat simdSqrt(SimdFloat a) { return _mm256_sqrt_ps(a.v); }
+inline SimdFloat simdAbs(SimdFloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline SimdFloat simdFloor(SimdFloat a) { return _mm256_floor_ps(a.v); }
+
+inline SimdMask operator<(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline SimdMask operator<=(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline SimdMask operator>(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMask operator>=(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline SimdMask operator==(SimdFloat a, SimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+inline SimdMask operator&(SimdMask a, SimdMask b) { return _mm256_and_ps(a.m, b.m); }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return _mm256_or_ps(a.m, b.m); }
+inline SimdMask operator~(SimdMask a) { return _mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+inline bool simdAny(SimdMask a) { return _mm256_movemask_ps(a.m) != 0; }
+inline bool simdLane(SimdMask a, int lane) { return (_mm256_movemask_ps(a.m) >> lane) & 1; }
+
+// mask ? a : b
+inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) { return _mm256_blendv_ps(b.v, a.v, mask.m); }
+inline SimdFloat simdLoad(const float *p) { return _mm256_loadu_ps(p); }
+inline void simdStore(float *p, SimdFloat a) { _mm256_storeu_ps(p, a.v); }
+
+#else
+
+struct SimdFloat {
+  float v;
+  SimdFloat() : v(0.0f) {}
+  SimdFloat(float s) : v(s) {}
+};
+struct SimdMask {
+  bool m;
+  SimdMask() : m(false) {}
+  SimdMask(bool x) : m(x) {}
+};
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return a.v + b.v; }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return a.v - b.v; }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return a.v * b.v; }
+inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return a.v / b.v; }
+inline SimdFloat operator-(SimdFloat a) { return -a.v; }
+inline SimdFloat simdMin(SimdFloat a, SimdFloat b) { return a.v < b.v ? a.v : b.v; }
+inline SimdFloat simdMax(SimdFloat a, SimdFloat b) { return a.v > b.v ? a.v : b.v; }
+inline SimdFloat simdSqrt(SimdFloat a) { return std::sqrt(a.v); }
+inline SimdFloat simdAbs(SimdFloat a) { return std::fabs(a.v); }
+inline SimdFloat simdFloor(SimdFloat a) { return std::floor(a.v); }
+
+inline SimdMask operator<(SimdFloat a, SimdFloat b) { return a.v < b.v; }
+inline SimdMask operator<=(SimdFloat a, SimdFloat b) { return a.v <= b.v; }
+inline SimdMask operator>(SimdFloat a, SimdFloat b) { return a.v > b.v; }
+inline SimdMask operator>=(SimdFloat a, SimdFloat b) { return a.v >= b.v; }
+inline SimdMask operator==(SimdFloat a, SimdFloat b) { return a.v == b.v; }
+inline SimdMask operator&(SimdMask a, SimdMask b) { return a.m && b.m; }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return a.m || b.m; }
+inline SimdMask operator~(SimdMask a) { return !a.m; }
+inline bool simdAny(SimdMask a) { return a.m; }
+inline bool simdLane(SimdMask a, int) { return a.m; }
+
+// mask ? a : b
+inline SimdFloat simdSelect(SimdMask mask, SimdFloat a, SimdFloat b) { return mask.m ? a : b; }
+inline SimdFloat simdLoad(const float *p) { return *p; }
+inline void simdStore(float *p, SimdFloat a) { *p = a.v; }
+
+#endif
+
+inline SimdFloat &operator+=(SimdFloat &a, SimdFloat b) { return a = a + b; }
+inline SimdFloat &operator-=(SimdFloat &a, SimdFloat b) { return a = a - b; }
+inline SimdFloat &operator*=(SimdFloat &a, SimdFloat b) { return a = a * b; }
+inline SimdMask &operator&=(SimdMask &a, SimdMask b) { return a = a & b; }
+inline SimdMask &operator|=(SimdMask &a, SimdMask b) { return a = a | b; }
+
+inline SimdFloat simdClamp(SimdFloat x, SimdFloat lo, SimdFloat hi) {
+  return simdMin(simdMax(x, lo), hi);
+}
+
+// Three-component vector of lanes (structure of arrays)
+struct SimdVec3 {
+  SimdFloat x, y, z;
+};
+
+inline SimdVec3 operator+(const SimdVec3 &a, const SimdVec3 &b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline SimdVec3 operator-(const SimdVec3 &a, const SimdVec3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline SimdVec3 operator*(const SimdVec3 &a, SimdFloat s) { return {a.x * s, a.y * s, a.z * s}; }
+inline SimdFloat simdDot(const SimdVec3 &a, const SimdVec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline SimdFloat simdLength(const SimdVec3 &a) { return simdSqrt(simdDot(a, a)); }
+inline SimdVec3 simdNormalize(const SimdVec3 &a) { return a * (SimdFloat(1.0f) / simdLength(a)); }
+inline SimdVec3 simdSelect(SimdMask mask, const SimdVec3 &a, const SimdVec3 &b) {
+  return {simdSelect(mask, a.x, b.x), simdSelect(mask, a.y, b.y), simdSelect(mask, a.z, b.z)};
+}
+
+#endif // SIMD_FLOAT_H
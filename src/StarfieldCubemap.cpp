@@ -1,33 +1,273 @@
 #include "StarfieldCubemap.h"
+#include "AssetCache.h"
+#include "ShaderCache.h"
+#include "TextureEncoding.h"
+#include "ThreadPool.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
 #include <iostream>
+#include <vector>
+
+static const char *STARFIELD_VERTEX_PATH = "assets/shaders/vertex.glsl";
+static const char *STARFIELD_GENERATOR_PATH =
+    "assets/shaders/starfield_cubemap.glsl";
+
+const char *starfieldFormatName(StarfieldFormat format) {
+  switch (format) {
+  case StarfieldFormat::Half:
+    return "half";
+  case StarfieldFormat::SharedExponent:
+    return "rgb9e5";
+  case StarfieldFormat::Compressed:
+    return "bc6h";
+  }
+  return "half";
+}
+
+bool parseStarfieldFormat(const std::string &name, StarfieldFormat &format) {
+  for (StarfieldFormat f : {StarfieldFormat::Half,
+                            StarfieldFormat::SharedExponent,
+                            StarfieldFormat::Compressed}) {
+    if (name == starfieldFormatName(f)) {
+      format = f;
+      return true;
+    }
+  }
+  return false;
+}
+
+static GLenum internalFormatFor(StarfieldFormat format) {
+  switch (format) {
+  case StarfieldFormat::SharedExponent:
+    return GL_RGB9_E5;
+  case StarfieldFormat::Compressed:
+    return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB;
+  default:
+    return GL_RGB16F;
+  }
+}
+
+// Bytes of one face at one mip level
+static size_t levelBytes(StarfieldFormat format, int size) {
+  switch (format) {
+  case StarfieldFormat::SharedExponent:
+    return (size_t)size * size * sizeof(uint32_t);
+  case StarfieldFormat::Compressed: {
+    size_t blocks = (size_t)(size + 3) / 4;
+    return blocks * blocks * BC6H_BLOCK_BYTES;
+  }
+  default:
+    return (size_t)size * size * 3 * sizeof(uint16_t);
+  }
+}
+
+static int levelSize(int faceResolution, int level) {
+  int size = faceResolution >> level;
+  return size > 0 ? size : 1;
+}
+
+static AssetCacheHeader starfieldCacheHeader(int faceResolution,
+                                             StarfieldFormat format,
+                                             int levels) {
+  AssetCacheHeader header = makeAssetCacheHeader();
+  header.internalFormat = internalFormatFor(format);
+  header.format = GL_RGB;
+  header.type = format == StarfieldFormat::SharedExponent
+                    ? GL_UNSIGNED_INT_5_9_9_9_REV
+                    : (format == StarfieldFormat::Half ? GL_HALF_FLOAT : 0);
+  header.width = header.height = (uint32_t)faceResolution;
+  header.depth = 6;
+  header.levels = (uint32_t)levels;
+  // The faces are a pure function of the generator shaders
+  header.sourceHash = hashFile(STARFIELD_GENERATOR_PATH,
+                               hashFile(STARFIELD_VERTEX_PATH));
+  // Payload is face-major: all levels of +X, then -X, ...
+  for (int level = 0; level < levels; level++) {
+    header.payloadSize +=
+        levelBytes(format, levelSize(faceResolution, level)) * 6;
+  }
+  return header;
+}
+
+// Upload one face level from tightly packed texels in the format's layout
+static void uploadLevel(StarfieldFormat format, int face, int level, int size,
+                        const void *data) {
+  GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+  switch (format) {
+  case StarfieldFormat::SharedExponent:
+    glTexImage2D(target, level, GL_RGB9_E5, size, size, 0, GL_RGB,
+                 GL_UNSIGNED_INT_5_9_9_9_REV, data);
+    break;
+  case StarfieldFormat::Compressed:
+    glCompressedTexImage2D(target, level,
+                           GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB, size,
+                           size, 0, (GLsizei)levelBytes(format, size), data);
+    break;
+  default:
+    glTexImage2D(target, level, GL_RGB16F, size, size, 0, GL_RGB,
+                 GL_HALF_FLOAT, data);
+    break;
+  }
+}
+
+// 2x2 box filter of an RGB float image (linear light, so star energy is
+// preserved down the chain)
+static void downsample(const std::vector<float> &src, int srcSize,
+                       std::vector<float> &dst, int dstSize) {
+  dst.resize((size_t)dstSize * dstSize * 3);
+  int step = srcSize > 1 ? 2 : 1;
+  for (int y = 0; y < dstSize; y++) {
+    for (int x = 0; x < dstSize; x++) {
+      for (int c = 0; c < 3; c++) {
+        int x0 = x * step, y0 = y * step;
+        int x1 = x0 + step - 1, y1 = y0 + step - 1;
+        float sum = src[((size_t)y0 * srcSize + x0) * 3 + c] +
+                    src[((size_t)y0 * srcSize + x1) * 3 + c] +
+                    src[((size_t)y1 * srcSize + x0) * 3 + c] +
+                    src[((size_t)y1 * srcSize + x1) * 3 + c];
+        dst[((size_t)y * dstSize + x) * 3 + c] = sum * 0.25f;
+      }
+    }
+  }
+}
+
+// Encode one RGB float level into the compact format, rows spread over the
+// pool (block rows for BC6H)
+static void encodeLevel(StarfieldFormat format, const std::vector<float> &src,
+                        int size, std::vector<uint8_t> &dst,
+                        ThreadPool &pool) {
+  dst.resize(levelBytes(format, size));
+
+  if (format == StarfieldFormat::SharedExponent) {
+    uint32_t *texels = reinterpret_cast<uint32_t *>(dst.data());
+    pool.parallelFor(size, [&](int y) {
+      for (int x = 0; x < size; x++) {
+        const float *t = &src[((size_t)y * size + x) * 3];
+        texels[(size_t)y * size + x] = encodeRGB9E5(t[0], t[1], t[2]);
+      }
+    });
+    return;
+  }
+
+  // BC6H: edge texels are repeated to fill partial blocks
+  int blocks = (size + 3) / 4;
+  pool.parallelFor(blocks, [&](int by) {
+    float block[16][3];
+    for (int bx = 0; bx < blocks; bx++) {
+      for (int i = 0; i < 16; i++) {
+        int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+        x = x < size ? x : size - 1;
+        y = y < size ? y : size - 1;
+        const float *t = &src[((size_t)y * size + x) * 3];
+        block[i][0] = t[0];
+        block[i][1] = t[1];
+        block[i][2] = t[2];
+      }
+      encodeBC6HBlock(block, &dst[((size_t)by * blocks + bx) *
+                                  BC6H_BLOCK_BYTES]);
+    }
+  });
+}
 
 StarfieldCubemap::StarfieldCubemap() {}
 
 StarfieldCubemap::~StarfieldCubemap() { deleteResources(); }
 
-void StarfieldCubemap::init(int faceResolution) {
+void StarfieldCubemap::init(int faceResolution, StarfieldFormat format) {
+  deleteResources();
+
   m_faceResolution = faceResolution;
+  m_requestedFormat = format;
+  m_format = format;
+  if (format == StarfieldFormat::Compressed &&
+      !GLAD_GL_ARB_texture_compression_bptc) {
+    std::cout << "BC6H not supported, storing starfield as RGB9_E5"
+              << std::endl;
+    m_format = StarfieldFormat::SharedExponent;
+  }
+
+  m_levelCount = 1;
+  if (m_format != StarfieldFormat::Half) {
+    while ((faceResolution >> m_levelCount) > 0)
+      m_levelCount++;
+  }
 
-  m_generatorShader = new Shader("assets/shaders/vertex.glsl",
-                                 "assets/shaders/starfield_cubemap.glsl");
+  auto start = std::chrono::steady_clock::now();
 
   glGenTextures(1, &m_cubemapTexture);
   glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemapTexture);
 
-  for (int i = 0; i < 6; i++) {
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F,
-                 faceResolution, faceResolution, 0, GL_RGB, GL_FLOAT, nullptr);
+  // Warm start: upload the faces straight from the mapped cache file
+  const AssetCacheHeader header =
+      starfieldCacheHeader(faceResolution, m_format, m_levelCount);
+  const std::string cachePath =
+      assetCachePath("starfield_" + std::to_string(faceResolution) + "_" +
+                     starfieldFormatName(m_format) + ".bhc");
+  MappedAssetCache cached;
+  bool fromCache = cached.open(cachePath, header);
+
+  if (fromCache) {
+    const char *payload = static_cast<const char *>(cached.getPayload());
+    for (int i = 0; i < 6; i++) {
+      for (int level = 0; level < m_levelCount; level++) {
+        int size = levelSize(faceResolution, level);
+        uploadLevel(m_format, i, level, size, payload);
+        payload += levelBytes(m_format, size);
+      }
+    }
+    cached.close();
+  } else if (m_format == StarfieldFormat::Half) {
+    // The generator renders straight into the final texture
+    for (int i = 0; i < 6; i++)
+      uploadLevel(m_format, i, 0, faceResolution, nullptr);
+    generateFaces(m_cubemapTexture);
+    storeCache(cachePath, header);
+  } else {
+    encodeFaces(cachePath, header);
   }
 
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemapTexture);
+  setSamplingParameters();
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  m_memoryBytes = header.payloadSize;
+  m_initialized = true;
+
+  auto elapsed = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start);
+  std::cout << "Starfield cubemap " << (fromCache ? "loaded" : "generated")
+            << " (" << faceResolution << "x" << faceResolution << " per face, "
+            << starfieldFormatName(m_format) << ", " << m_levelCount
+            << (m_levelCount == 1 ? " level, " : " levels, ")
+            << m_memoryBytes / (1024 * 1024) << " MB, " << elapsed.count()
+            << " ms)" << std::endl;
+}
+
+bool StarfieldCubemap::setFormat(StarfieldFormat format) {
+  if (m_initialized && format == m_requestedFormat)
+    return false;
+  init(m_faceResolution, format);
+  return true;
+}
+
+void StarfieldCubemap::setSamplingParameters() {
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
+                  m_levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1);
+}
 
-  glGenFramebuffers(1, &m_fbo);
+void StarfieldCubemap::generateFaces(unsigned int texture) {
+  if (!m_generatorShader) {
+    m_generatorShader =
+        ShaderCache::get(STARFIELD_VERTEX_PATH, STARFIELD_GENERATOR_PATH);
+  }
+  if (!m_fbo)
+    glGenFramebuffers(1, &m_fbo);
 
   float quadVertices[] = {
       -1.0f, 1.0f,  0.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f,
@@ -48,27 +288,98 @@ void StarfieldCubemap::init(int faceResolution) {
   glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
                         (void *)(2 * sizeof(float)));
 
+  // May run mid-frame when the format changes; leave the caller's target
+  // and viewport as they were
+  GLint previousFBO = 0;
+  GLint previousViewport[4];
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+  glGetIntegerv(GL_VIEWPORT, previousViewport);
+
   glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
-  glViewport(0, 0, faceResolution, faceResolution);
+  glViewport(0, 0, m_faceResolution, m_faceResolution);
 
   for (int i = 0; i < 6; i++) {
-    renderFace(i, quadVAO);
+    renderFace(texture, i, quadVAO);
   }
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+  glViewport(previousViewport[0], previousViewport[1], previousViewport[2],
+             previousViewport[3]);
 
   glDeleteVertexArrays(1, &quadVAO);
   glDeleteBuffers(1, &quadVBO);
+}
 
-  m_initialized = true;
-  std::cout << "Starfield cubemap generated (" << faceResolution << "x"
-            << faceResolution << " per face)" << std::endl;
+// Read the freshly rendered faces back and stream them to the cache
+void StarfieldCubemap::storeCache(const std::string &cachePath,
+                                  const AssetCacheHeader &header) {
+  AssetCacheWriter writer;
+  if (!writer.begin(cachePath, header))
+    return;
+
+  std::vector<uint16_t> face((size_t)m_faceResolution * m_faceResolution * 3);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemapTexture);
+  for (int i = 0; i < 6 && writer.isOpen(); i++) {
+    glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB,
+                  GL_HALF_FLOAT, face.data());
+    writer.write(face.data(), face.size() * sizeof(uint16_t));
+  }
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+  writer.commit();
+}
+
+// Compact formats aren't renderable: render to a temporary RGB16F cubemap,
+// then build the mip chain and encode on the CPU one face at a time
+void StarfieldCubemap::encodeFaces(const std::string &cachePath,
+                                   const AssetCacheHeader &header) {
+  unsigned int staging;
+  glGenTextures(1, &staging);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, staging);
+  for (int i = 0; i < 6; i++) {
+    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F,
+                 m_faceResolution, m_faceResolution, 0, GL_RGB, GL_FLOAT,
+                 nullptr);
+  }
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
+  generateFaces(staging);
+
+  AssetCacheWriter writer;
+  writer.begin(cachePath, header);
+
+  ThreadPool pool;
+  std::vector<float> level, next;
+  std::vector<uint8_t> encoded;
+
+  for (int i = 0; i < 6; i++) {
+    level.resize((size_t)m_faceResolution * m_faceResolution * 3);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, staging);
+    glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, GL_FLOAT,
+                  level.data());
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemapTexture);
+    for (int l = 0; l < m_levelCount; l++) {
+      int size = levelSize(m_faceResolution, l);
+      if (l > 0) {
+        downsample(level, levelSize(m_faceResolution, l - 1), next, size);
+        level.swap(next);
+      }
+      encodeLevel(m_format, level, size, encoded, pool);
+      uploadLevel(m_format, i, l, size, encoded.data());
+      if (writer.isOpen())
+        writer.write(encoded.data(), encoded.size());
+    }
+  }
+
+  if (writer.isOpen())
+    writer.commit();
+  glDeleteTextures(1, &staging);
 }
 
-void StarfieldCubemap::renderFace(int face, unsigned int quadVAO) {
+void StarfieldCubemap::renderFace(unsigned int texture, int face,
+                                  unsigned int quadVAO) {
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                         GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
-                         m_cubemapTexture, 0);
+                         GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, texture, 0);
   glClear(GL_COLOR_BUFFER_BIT);
 
   // Define view directions for each cubemap face
@@ -110,7 +421,9 @@ void StarfieldCubemap::deleteResources() {
 
   glDeleteTextures(1, &m_cubemapTexture);
   glDeleteFramebuffers(1, &m_fbo);
-  delete m_generatorShader;
+  m_generatorShader.reset();
+  m_cubemapTexture = 0;
+  m_fbo = 0;
 
   m_initialized = false;
 }
@@ -2,30 +2,67 @@
 #define STARFIELD_CUBEMAP_H
 
 #include "Shader.h"
+#include <cstdint>
 #include <glad/glad.h>
+#include <memory>
+#include <string>
+
+struct AssetCacheHeader;
+
+// Texel storage for the baked starfield
+enum class StarfieldFormat {
+  Half,           // GL_RGB16F, single level
+  SharedExponent, // GL_RGB9_E5 with a full mip chain
+  Compressed      // BC6H with a full mip chain (RGB9_E5 if unsupported)
+};
+
+// "half", "rgb9e5", "bc6h"
+const char *starfieldFormatName(StarfieldFormat format);
+bool parseStarfieldFormat(const std::string &name, StarfieldFormat &format);
 
 class StarfieldCubemap {
 public:
   StarfieldCubemap();
   ~StarfieldCubemap();
 
-  // Initialize and generate the cubemap texture
-  void init(int faceResolution = 512);
+  // Initialize the cubemap texture, loading it from the asset cache when
+  // possible and rendering (then caching) the faces otherwise. The compact
+  // formats are mipmapped and encoded on the CPU.
+  void init(int faceResolution = 512,
+            StarfieldFormat format = StarfieldFormat::Half);
+
+  // Recreate the texture if 'format' differs from the requested one.
+  // Returns true if it was rebuilt.
+  bool setFormat(StarfieldFormat format);
 
   // Bind the cubemap to a texture unit
   void bind(int textureUnit);
 
   // Get the cubemap texture ID
   unsigned int getTextureID() const { return m_cubemapTexture; }
+  int getFaceResolution() const { return m_faceResolution; }
+  int getLevelCount() const { return m_levelCount; }
+  StarfieldFormat getFormat() const { return m_format; }
+  uint64_t getMemoryBytes() const { return m_memoryBytes; }
 
 private:
   void deleteResources();
-  void renderFace(int face, unsigned int quadVAO);
+  void setSamplingParameters();
+  void generateFaces(unsigned int texture);
+  void renderFace(unsigned int texture, int face, unsigned int quadVAO);
+  void storeCache(const std::string &cachePath,
+                  const AssetCacheHeader &header);
+  void encodeFaces(const std::string &cachePath,
+                   const AssetCacheHeader &header);
 
   unsigned int m_cubemapTexture = 0;
   unsigned int m_fbo = 0;
-  Shader *m_generatorShader = nullptr;
+  std::shared_ptr<Shader> m_generatorShader;
   int m_faceResolution = 512;
+  int m_levelCount = 1;
+  StarfieldFormat m_requestedFormat = StarfieldFormat::Half;
+  StarfieldFormat m_format = StarfieldFormat::Half;
+  uint64_t m_memoryBytes = 0;
   bool m_initialized = false;
 };
 
@@ -0,0 +1,344 @@
+#include "SweepExporter.h"
+#include "OffscreenRenderer.h"
+#include "SequenceExporter.h"
+
+#include "stb_image_write.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+// Pixels per array texture when the batch size isn't given: large enough
+// that small images are read back dozens at a time
+static const int BATCH_PIXELS = 8 << 20;
+static const int MAX_DEFAULT_BATCH = 64;
+
+// Scene parameters every manifest row lists, by setting key
+static const char *MANIFEST_KEYS[] = {
+    "radius", "disk-inner", "disk-outer", "disk-thickness", "glow",
+    "disk-speed", "distance", "angle", "time", "phase"};
+
+static std::string csvField(const std::string &value) {
+  if (value.find_first_of(",\"\n") == std::string::npos)
+    return value;
+  std::string quoted = "\"";
+  for (char c : value) {
+    if (c == '"')
+      quoted += '"';
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+static bool isManifestKey(const std::string &key) {
+  for (const char *name : MANIFEST_KEYS) {
+    if (key == name)
+      return true;
+  }
+  return false;
+}
+
+SweepExporter::SweepExporter(OffscreenRenderer &renderer)
+    : m_renderer(renderer) {}
+
+SweepExporter::~SweepExporter() {
+  stopEncoders();
+  for (Batch &batch : m_batches)
+    deleteBatch(batch);
+}
+
+bool SweepExporter::run(const SweepSpec &spec, const std::string &manifestPath,
+                        int batchSize, int encoders) {
+  const RenderSettings &base = spec.base;
+  if (base.frames > 1 || base.tileSize > 0) {
+    std::cerr << "Sequences and tiled renders can't be swept" << std::endl;
+    return false;
+  }
+  std::string pattern;
+  if (!SequenceExporter::framePattern(base.output, pattern))
+    return false;
+
+  size_t total = spec.count();
+  m_width = base.width;
+  m_height = base.height;
+  GLint maxLayers = 1;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  m_layers = batchSize > 0 ? batchSize
+                           : std::min(BATCH_PIXELS / (m_width * m_height),
+                                      MAX_DEFAULT_BATCH);
+  m_layers = (int)std::min<size_t>(
+      std::max(std::min(m_layers, (int)maxLayers), 1), total);
+  for (Batch &batch : m_batches) {
+    if (!createBatch(batch, m_layers))
+      return false;
+  }
+
+  m_manifest.open(manifestPath);
+  if (!m_manifest) {
+    std::cerr << "Failed to open " << manifestPath << " for writing"
+              << std::endl;
+    return false;
+  }
+  std::vector<std::string> extraKeys;
+  for (const std::string &key : spec.sweptKeys()) {
+    if (!isManifestKey(key))
+      extraKeys.push_back(key);
+  }
+  writeManifestHeader(extraKeys);
+
+  if (encoders <= 0)
+    encoders = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+  m_stop = false;
+  for (int i = 0; i < encoders; i++)
+    m_encoders.emplace_back(&SweepExporter::encoderLoop, this);
+
+  auto start = std::chrono::steady_clock::now();
+  BloomRenderer &bloom = m_renderer.getBloomRenderer();
+  RenderSettings settings;
+  SweepSpec::Assignment applied;
+  bool ok = true;
+  Batch *previous = nullptr;
+  size_t next = 0;
+  for (int b = 0; next < total && ok; b++) {
+    // The batch last held batch b-2; its encodes must be done
+    Batch &batch = m_batches[b % BATCH_COUNT];
+    release(batch);
+    ok = batch.ok;
+    batch.paths.clear();
+
+    for (int layer = 0; layer < m_layers && next < total && ok; layer++) {
+      ok = spec.settingsFor(next, settings, applied);
+      if (!ok)
+        break;
+      bloom.setOutputFBO(batch.fbos[layer]);
+      m_renderer.render(settings);
+
+      char path[1024];
+      snprintf(path, sizeof(path), pattern.c_str(), (int)next);
+      batch.paths.push_back(path);
+      writeManifestRow(next, path, settings, applied, extraKeys);
+      next++;
+    }
+    readBack(batch);
+
+    // Batch b-1's copy finishes ahead of batch b's draws
+    if (previous)
+      mapAndEncode(*previous);
+    previous = &batch;
+  }
+  if (previous)
+    mapAndEncode(*previous);
+  bloom.setOutputFBO(m_renderer.getOutputFBO());
+
+  for (Batch &batch : m_batches) {
+    release(batch);
+    ok = ok && batch.ok;
+    deleteBatch(batch);
+  }
+  stopEncoders();
+  m_manifest.close();
+  ok = ok && !m_manifest.fail();
+
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  if (!ok) {
+    std::cerr << "Sweep failed after " << next << " of " << total
+              << " images" << std::endl;
+    return false;
+  }
+  std::cout << "Rendered " << total << " images (" << m_width << "x"
+            << m_height << ", " << m_layers << " per batch) in " << seconds
+            << " s, " << total / seconds << " images/s; manifest "
+            << manifestPath << std::endl;
+  return true;
+}
+
+bool SweepExporter::createBatch(Batch &batch, int layers) {
+  glGenTextures(1, &batch.texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, batch.texture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, m_width, m_height, layers, 0,
+               GL_RGB, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  batch.fbos.resize(layers);
+  glGenFramebuffers(layers, batch.fbos.data());
+  bool complete = true;
+  for (int i = 0; i < layers; i++) {
+    glBindFramebuffer(GL_FRAMEBUFFER, batch.fbos[i]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              batch.texture, 0, i);
+    complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+                               GL_FRAMEBUFFER_COMPLETE;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (!complete) {
+    std::cerr << "Sweep framebuffer not complete!" << std::endl;
+    return false;
+  }
+
+  glGenBuffers(1, &batch.pbo);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, batch.pbo);
+  glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)m_width * m_height * 3 * layers,
+               NULL, GL_STREAM_READ);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  batch.ok = true;
+  return true;
+}
+
+void SweepExporter::deleteBatch(Batch &batch) {
+  if (batch.fence) {
+    glDeleteSync(batch.fence);
+    batch.fence = nullptr;
+  }
+  if (!batch.fbos.empty()) {
+    glDeleteFramebuffers((GLsizei)batch.fbos.size(), batch.fbos.data());
+    batch.fbos.clear();
+  }
+  if (batch.texture) {
+    glDeleteTextures(1, &batch.texture);
+    batch.texture = 0;
+  }
+  if (batch.pbo) {
+    glDeleteBuffers(1, &batch.pbo);
+    batch.pbo = 0;
+  }
+}
+
+// Every layer in one copy; layers past the rendered ones are read too
+void SweepExporter::readBack(Batch &batch) {
+  glBindTexture(GL_TEXTURE_2D_ARRAY, batch.texture);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, batch.pbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, GL_UNSIGNED_BYTE, (void *)0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+}
+
+void SweepExporter::mapAndEncode(Batch &batch) {
+  glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  glDeleteSync(batch.fence);
+  batch.fence = nullptr;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, batch.pbo);
+  batch.pixels = (const unsigned char *)glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, (size_t)m_width * m_height * 3 * m_layers,
+      GL_MAP_READ_BIT);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (!batch.pixels) {
+    std::cerr << "Failed to map sweep batch" << std::endl;
+    batch.ok = false;
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    batch.remaining = (int)batch.paths.size();
+    for (int i = 0; i < batch.remaining; i++)
+      m_queue.push_back({&batch, i});
+  }
+  m_wake.notify_all();
+}
+
+// Wait for the encoders to finish with the batch and unmap its buffer
+void SweepExporter::release(Batch &batch) {
+  if (!batch.pixels)
+    return;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return batch.remaining == 0; });
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, batch.pbo);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  batch.pixels = nullptr;
+}
+
+void SweepExporter::stopEncoders() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (std::thread &encoder : m_encoders)
+    encoder.join();
+  m_encoders.clear();
+}
+
+void SweepExporter::encoderLoop() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty())
+        return;
+      job = m_queue.front();
+      m_queue.pop_front();
+    }
+
+    bool ok = encodePNG(*job.batch, job.layer);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      job.batch->ok = job.batch->ok && ok;
+      job.batch->remaining--;
+    }
+    m_done.notify_all();
+  }
+}
+
+bool SweepExporter::encodePNG(const Batch &batch, int layer) {
+  const std::string &path = batch.paths[layer];
+  const unsigned char *pixels =
+      batch.pixels + (size_t)layer * m_width * m_height * 3;
+
+  // GL rows are bottom-up; write from the last one with a negative stride
+  int stride = m_width * 3;
+  if (!stbi_write_png(path.c_str(), m_width, m_height, 3,
+                      pixels + (size_t)(m_height - 1) * stride, -stride)) {
+    std::cerr << "Failed to save image: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void SweepExporter::writeManifestHeader(
+    const std::vector<std::string> &extraKeys) {
+  m_manifest << "index,file";
+  for (const char *key : MANIFEST_KEYS)
+    m_manifest << "," << key;
+  for (const std::string &key : extraKeys)
+    m_manifest << "," << csvField(key);
+  m_manifest << "\n";
+}
+
+// Other swept settings are listed as given, empty where the render keeps
+// the base value
+void SweepExporter::writeManifestRow(
+    size_t index, const std::string &path, const RenderSettings &settings,
+    const SweepSpec::Assignment &applied,
+    const std::vector<std::string> &extraKeys) {
+  const BlackHoleParams &bh = settings.blackHole;
+  m_manifest << index << "," << csvField(path);
+  for (float value : {bh.radius, bh.diskInnerRadius, bh.diskOuterRadius,
+                      bh.diskThickness, bh.glowIntensity, bh.diskSpeed,
+                      settings.camera.distance, settings.camera.angle,
+                      settings.time, settings.resolvedDiskPhase()})
+    m_manifest << "," << formatSweepValue(value);
+
+  for (const std::string &key : extraKeys) {
+    std::string value;
+    for (const auto &assignment : applied) {
+      if (assignment.first == key)
+        value = assignment.second;
+    }
+    m_manifest << "," << csvField(value);
+  }
+  m_manifest << "\n";
+}
@@ -0,0 +1,87 @@
+#ifndef SWEEP_EXPORTER_H
+#define SWEEP_EXPORTER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SweepSpec.h"
+
+class OffscreenRenderer;
+
+// Renders every combination of a SweepSpec as numbered PNGs with one
+// context and one set of baked assets. Images are composited straight into
+// the layers of a 2D array texture, a batch of them per texture, and each
+// batch is read back with a single pixel-buffer copy. While the GPU renders
+// batch k, batch k-1 is mapped and encoded by a pool of encoder threads.
+// A CSV manifest lists each file with its scene parameters.
+class SweepExporter {
+public:
+  explicit SweepExporter(OffscreenRenderer &renderer);
+  ~SweepExporter();
+
+  SweepExporter(const SweepExporter &) = delete;
+  SweepExporter &operator=(const SweepExporter &) = delete;
+
+  // Files are named from spec.base.output like SequenceExporter's PNG
+  // frames, numbered by render index. batchSize = images per array texture
+  // (0 picks one from the image size); encoders = encoder threads (0 = one
+  // per core besides the render thread).
+  bool run(const SweepSpec &spec, const std::string &manifestPath,
+           int batchSize = 0, int encoders = 0);
+
+private:
+  struct Batch {
+    unsigned int texture = 0;
+    std::vector<unsigned int> fbos; // One per layer
+    unsigned int pbo = 0;
+    GLsync fence = nullptr;
+    std::vector<std::string> paths; // Files of the rendered layers
+    const unsigned char *pixels = nullptr; // Mapped while encoding
+    int remaining = 0; // Layers still being encoded (m_mutex)
+    bool ok = true;
+  };
+  struct Job {
+    Batch *batch;
+    int layer;
+  };
+  static const int BATCH_COUNT = 2;
+
+  bool createBatch(Batch &batch, int layers);
+  void deleteBatch(Batch &batch);
+  void readBack(Batch &batch);
+  void mapAndEncode(Batch &batch);
+  void release(Batch &batch);
+  void stopEncoders();
+
+  void encoderLoop();
+  bool encodePNG(const Batch &batch, int layer);
+
+  void writeManifestHeader(const std::vector<std::string> &extraKeys);
+  void writeManifestRow(size_t index, const std::string &path,
+                        const RenderSettings &settings,
+                        const SweepSpec::Assignment &applied,
+                        const std::vector<std::string> &extraKeys);
+
+  OffscreenRenderer &m_renderer;
+  Batch m_batches[BATCH_COUNT];
+  int m_width = 0;
+  int m_height = 0;
+  int m_layers = 0;
+  std::ofstream m_manifest;
+
+  std::vector<std::thread> m_encoders;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  std::deque<Job> m_queue;
+  bool m_stop = false;
+};
+
+#endif // SWEEP_EXPORTER_H
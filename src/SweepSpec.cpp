@@ -0,0 +1,195 @@
+#include "SweepSpec.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static std::string trim(const std::string &s) {
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos)
+    return "";
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(begin, end - begin + 1);
+}
+
+static std::vector<std::string> splitWhitespace(const std::string &s) {
+  std::vector<std::string> tokens;
+  std::istringstream stream(s);
+  std::string token;
+  while (stream >> token)
+    tokens.push_back(token);
+  return tokens;
+}
+
+// All renders of a sweep share one output size and one file pattern
+static bool isSweepable(const std::string &key) {
+  static const char *fixed[] = {"width",      "height",     "output",
+                                "frames",     "fps",        "tile",
+                                "config",     "shm-output", "shm-content"};
+  for (const char *name : fixed) {
+    if (key == name) {
+      std::cerr << "'" << key << "' can't be swept" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Check a value by applying it to scratch settings
+static bool isValidSetting(const std::string &key, const std::string &value) {
+  RenderSettings scratch;
+  return isSweepable(key) && applyRenderSetting(scratch, key, value);
+}
+
+// "start:stop:count"; false if 'value' isn't a range
+static bool expandRange(const std::string &value,
+                        std::vector<std::string> &values) {
+  float start, stop;
+  int count;
+  char trailing;
+  if (sscanf(value.c_str(), "%f:%f:%d%c", &start, &stop, &count,
+             &trailing) != 3 ||
+      count < 1)
+    return false;
+
+  for (int i = 0; i < count; i++) {
+    float t = count > 1 ? (float)i / (float)(count - 1) : 0.0f;
+    values.push_back(formatSweepValue(start + (stop - start) * t));
+  }
+  return true;
+}
+
+std::string formatSweepValue(float value) {
+  char text[32];
+  for (int precision = 6; precision < 9; precision++) {
+    snprintf(text, sizeof(text), "%.*g", precision, value);
+    if (strtof(text, nullptr) == value)
+      return text;
+  }
+  snprintf(text, sizeof(text), "%.9g", value);
+  return text;
+}
+
+size_t SweepSpec::count() const {
+  size_t total = std::max(cases.size(), (size_t)1);
+  for (const Axis &axis : grid)
+    total *= axis.values.size();
+  return total;
+}
+
+bool SweepSpec::settingsFor(size_t index, RenderSettings &settings,
+                            Assignment &applied) const {
+  applied.clear();
+  std::vector<size_t> digits(grid.size());
+  for (size_t a = grid.size(); a-- > 0;) {
+    digits[a] = index % grid[a].values.size();
+    index /= grid[a].values.size();
+  }
+  if (!cases.empty())
+    applied = cases[index];
+  for (size_t a = 0; a < grid.size(); a++)
+    applied.emplace_back(grid[a].key, grid[a].values[digits[a]]);
+
+  settings = base;
+  for (const auto &assignment : applied) {
+    if (!applyRenderSetting(settings, assignment.first, assignment.second))
+      return false;
+  }
+  return checkRenderSettings(settings);
+}
+
+std::vector<std::string> SweepSpec::sweptKeys() const {
+  std::vector<std::string> keys;
+  auto add = [&](const std::string &key) {
+    if (std::find(keys.begin(), keys.end(), key) == keys.end())
+      keys.push_back(key);
+  };
+  for (const Assignment &c : cases) {
+    for (const auto &assignment : c)
+      add(assignment.first);
+  }
+  for (const Axis &axis : grid)
+    add(axis.key);
+  return keys;
+}
+
+bool addSweepAxis(SweepSpec &spec, const std::string &definition) {
+  size_t eq = definition.find('=');
+  if (eq == std::string::npos) {
+    std::cerr << "Expected 'key = values' in grid axis: " << definition
+              << std::endl;
+    return false;
+  }
+
+  SweepSpec::Axis axis;
+  axis.key = trim(definition.substr(0, eq));
+  for (const std::string &token : splitWhitespace(definition.substr(eq + 1))) {
+    if (!expandRange(token, axis.values))
+      axis.values.push_back(token);
+  }
+  if (axis.values.empty()) {
+    std::cerr << "Grid axis '" << axis.key << "' has no values" << std::endl;
+    return false;
+  }
+  for (const std::string &value : axis.values) {
+    if (!isValidSetting(axis.key, value))
+      return false;
+  }
+  spec.grid.push_back(axis);
+  return true;
+}
+
+bool addSweepCase(SweepSpec &spec, const std::string &definition) {
+  SweepSpec::Assignment assignment;
+  for (const std::string &token : splitWhitespace(definition)) {
+    size_t eq = token.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << "Expected key=value in case: " << token << std::endl;
+      return false;
+    }
+    std::string key = token.substr(0, eq);
+    std::string value = token.substr(eq + 1);
+    if (!isValidSetting(key, value))
+      return false;
+    assignment.emplace_back(key, value);
+  }
+  spec.cases.push_back(assignment);
+  return true;
+}
+
+bool loadSweepSpec(SweepSpec &spec, const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Failed to open sweep file: " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    line = trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    bool ok;
+    if (line.compare(0, 5, "grid ") == 0) {
+      ok = addSweepAxis(spec, line.substr(5));
+    } else if (line.compare(0, 5, "case ") == 0) {
+      ok = addSweepCase(spec, line.substr(5));
+    } else {
+      size_t eq = line.find('=');
+      ok = eq != std::string::npos &&
+           applyRenderSetting(spec.base, trim(line.substr(0, eq)),
+                              trim(line.substr(eq + 1)));
+    }
+    if (!ok) {
+      std::cerr << path << ":" << lineNumber << ": invalid line" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
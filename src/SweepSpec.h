@@ -0,0 +1,52 @@
+#ifndef SWEEP_SPEC_H
+#define SWEEP_SPEC_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RenderSettings.h"
+
+// A batch of renders: base settings plus variations of any render setting.
+// The renders are the listed cases (or a single unchanged one if there are
+// none), each crossed with every combination of the grid axes, the last
+// axis varying fastest.
+struct SweepSpec {
+  using Assignment = std::vector<std::pair<std::string, std::string>>;
+
+  struct Axis {
+    std::string key;
+    std::vector<std::string> values;
+  };
+
+  RenderSettings base;
+  std::vector<Axis> grid;
+  std::vector<Assignment> cases;
+
+  size_t count() const;
+
+  // Settings of render 'index', and the key/value pairs applied to the base
+  // for it. False if one of the values is invalid.
+  bool settingsFor(size_t index, RenderSettings &settings,
+                   Assignment &applied) const;
+
+  // Keys set by cases or grid axes, in the order they first appear
+  std::vector<std::string> sweptKeys() const;
+};
+
+// Shortest text that parses back to 'value'
+std::string formatSweepValue(float value);
+
+// "key = v1 v2 ..." or "key = start:stop:count" (count values spaced
+// evenly from start to stop inclusive)
+bool addSweepAxis(SweepSpec &spec, const std::string &definition);
+
+// "key=value key=value ..."
+bool addSweepCase(SweepSpec &spec, const std::string &definition);
+
+// Load a sweep file. Lines are base settings as in a --config file
+// ("key = value"), "grid <axis>" or "case <assignments>". Blank lines and
+// lines starting with '#' are ignored.
+bool loadSweepSpec(SweepSpec &spec, const std::string &path);
+
+#endif // SWEEP_SPEC_H
@@ -0,0 +1,167 @@
+#include "TextureEncoding.h"
+#include "HalfFloat.h"
+
+#include <cmath>
+#include <cstring>
+
+uint32_t encodeRGB9E5(float r, float g, float b) {
+  const int N = 9;  // Mantissa bits
+  const int B = 15; // Exponent bias
+  const float sharedExpMax = 65408.0f; // (2^9 - 1) / 2^9 * 2^16
+
+  // Also maps NaN to 0
+  auto clampComponent = [&](float x) {
+    return x > 0.0f ? (x < sharedExpMax ? x : sharedExpMax) : 0.0f;
+  };
+  float rc = clampComponent(r);
+  float gc = clampComponent(g);
+  float bc = clampComponent(b);
+  float maxRGB = rc > gc ? (rc > bc ? rc : bc) : (gc > bc ? gc : bc);
+
+  int expShared = (maxRGB > 0.0f ? (int)std::floor(std::log2(maxRGB)) : -B - 1);
+  if (expShared < -B - 1)
+    expShared = -B - 1;
+  expShared += 1 + B;
+
+  float denom = std::ldexp(1.0f, expShared - B - N);
+  int maxS = (int)std::floor(maxRGB / denom + 0.5f);
+  if (maxS == (1 << N)) {
+    denom *= 2.0f;
+    expShared += 1;
+  }
+
+  uint32_t rs = (uint32_t)std::floor(rc / denom + 0.5f);
+  uint32_t gs = (uint32_t)std::floor(gc / denom + 0.5f);
+  uint32_t bs = (uint32_t)std::floor(bc / denom + 0.5f);
+  return rs | (gs << 9) | (bs << 18) | ((uint32_t)expShared << 27);
+}
+
+// ============================================================================
+// BC6H (unsigned), mode 11: one region, two 10-bit RGB endpoints stored
+// as-is, 4-bit indices. The decoder interpolates endpoint values in a
+// 16-bit domain and maps the result to half float bits with (x * 31) >> 6,
+// so fitting happens in that domain (roughly logarithmic in intensity).
+// ============================================================================
+
+static const int BC6H_WEIGHTS[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                     34, 38, 43, 47, 51, 55, 60, 64};
+
+// Endpoint dequantization for 10-bit unsigned endpoints
+static int unquantize10(int q) {
+  if (q == 0)
+    return 0;
+  if (q == 1023)
+    return 0xffff;
+  return ((q << 16) + 0x8000) >> 10;
+}
+
+static int quantize10(float v) {
+  int q = (int)std::floor((v - 32.0f) / 64.0f + 0.5f);
+  q = q < 0 ? 0 : (q > 1023 ? 1023 : q);
+  // The two ends of the range dequantize specially; pick the closer one
+  int best = q;
+  float bestErr = std::fabs((float)unquantize10(q) - v);
+  for (int c = q - 1; c <= q + 1; c += 2) {
+    if (c < 0 || c > 1023)
+      continue;
+    float err = std::fabs((float)unquantize10(c) - v);
+    if (err < bestErr) {
+      best = c;
+      bestErr = err;
+    }
+  }
+  return best;
+}
+
+static void putBits(uint8_t *out, int &pos, uint32_t value, int count) {
+  for (int i = 0; i < count; i++, pos++) {
+    if ((value >> i) & 1)
+      out[pos >> 3] |= (uint8_t)(1 << (pos & 7));
+  }
+}
+
+void encodeBC6HBlock(const float texels[16][3],
+                     uint8_t out[BC6H_BLOCK_BYTES]) {
+  // Texels in the interpolation domain
+  float v[16][3];
+  float lo[3] = {1e30f, 1e30f, 1e30f};
+  float hi[3] = {0.0f, 0.0f, 0.0f};
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 3; c++) {
+      float x = texels[i][c] > 0.0f ? texels[i][c] : 0.0f;
+      uint16_t h = floatToHalf(x);
+      if (h > 0x7bff)
+        h = 0x7bff; // Inf/NaN -> largest finite
+      v[i][c] = (float)h * (64.0f / 31.0f);
+      lo[c] = v[i][c] < lo[c] ? v[i][c] : lo[c];
+      hi[c] = v[i][c] > hi[c] ? v[i][c] : hi[c];
+      mean[c] += v[i][c] / 16.0f;
+    }
+  }
+
+  // Use the diagonal of the bounding box that follows the block's overall
+  // brightness: flip channels that anti-correlate with the channel sum
+  float e0[3], e1[3];
+  for (int c = 0; c < 3; c++) {
+    float cov = 0.0f;
+    for (int i = 0; i < 16; i++) {
+      float sum = (v[i][0] - mean[0]) + (v[i][1] - mean[1]) +
+                  (v[i][2] - mean[2]);
+      cov += (v[i][c] - mean[c]) * sum;
+    }
+    e0[c] = cov < 0.0f ? hi[c] : lo[c];
+    e1[c] = cov < 0.0f ? lo[c] : hi[c];
+  }
+
+  int q0[3], q1[3];
+  float u0[3], dir[3];
+  float dirLength2 = 0.0f;
+  for (int c = 0; c < 3; c++) {
+    q0[c] = quantize10(e0[c]);
+    q1[c] = quantize10(e1[c]);
+    u0[c] = (float)unquantize10(q0[c]);
+    dir[c] = (float)unquantize10(q1[c]) - u0[c];
+    dirLength2 += dir[c] * dir[c];
+  }
+
+  // Project onto the endpoint segment, snap to the nearest weight
+  int indices[16];
+  for (int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    if (dirLength2 > 0.0f) {
+      t = ((v[i][0] - u0[0]) * dir[0] + (v[i][1] - u0[1]) * dir[1] +
+           (v[i][2] - u0[2]) * dir[2]) /
+          dirLength2;
+    }
+    float w = t * 64.0f;
+    int best = 0;
+    for (int k = 1; k < 16; k++) {
+      if (std::fabs(BC6H_WEIGHTS[k] - w) < std::fabs(BC6H_WEIGHTS[best] - w))
+        best = k;
+    }
+    indices[i] = best;
+  }
+
+  // The first index is stored with its top bit implied zero
+  if (indices[0] >= 8) {
+    for (int c = 0; c < 3; c++) {
+      int tmp = q0[c];
+      q0[c] = q1[c];
+      q1[c] = tmp;
+    }
+    for (int i = 0; i < 16; i++)
+      indices[i] = 15 - indices[i];
+  }
+
+  memset(out, 0, BC6H_BLOCK_BYTES);
+  int pos = 0;
+  putBits(out, pos, 0x03, 5); // Mode 11
+  for (int c = 0; c < 3; c++)
+    putBits(out, pos, (uint32_t)q0[c], 10);
+  for (int c = 0; c < 3; c++)
+    putBits(out, pos, (uint32_t)q1[c], 10);
+  putBits(out, pos, (uint32_t)indices[0], 3);
+  for (int i = 1; i < 16; i++)
+    putBits(out, pos, (uint32_t)indices[i], 4);
+}
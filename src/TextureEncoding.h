@@ -0,0 +1,22 @@
+#ifndef TEXTURE_ENCODING_H
+#define TEXTURE_ENCODING_H
+
+#include <cstdint>
+
+// CPU encoders for compact HDR texture formats, used when baking assets
+// whose generator can only render to a float target.
+
+// GL_RGB9_E5 texel (GL_UNSIGNED_INT_5_9_9_9_REV), per the
+// EXT_texture_shared_exponent reference encoding. Negative inputs clamp to 0.
+uint32_t encodeRGB9E5(float r, float g, float b);
+
+// Size of one BC6H block (4x4 texels)
+static const int BC6H_BLOCK_BYTES = 16;
+
+// Encode a 4x4 block of RGB texels (row-major, 3 floats each) as unsigned
+// BC6H (GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT). Uses the single-region,
+// 10-bit endpoint mode only: fast and good enough for smooth or sparse
+// content, not a best-quality encoder.
+void encodeBC6HBlock(const float texels[16][3], uint8_t out[BC6H_BLOCK_BYTES]);
+
+#endif // TEXTURE_ENCODING_H
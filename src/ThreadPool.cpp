@@ -0,0 +1,90 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+      threadCount = 1;
+  }
+
+  // The calling thread is the last worker
+  for (unsigned int i = 1; i < threadCount; i++) {
+    m_workers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::runItems(const std::function<void(int)> &fn, int count) {
+  for (int i = m_nextIndex.fetch_add(1); i < count;
+       i = m_nextIndex.fetch_add(1)) {
+    fn(i);
+  }
+}
+
+void ThreadPool::workerLoop() {
+  uint64_t seenGeneration = 0;
+
+  for (;;) {
+    const std::function<void(int)> *job = nullptr;
+    int count = 0;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&] {
+        return m_stop || (m_job && m_generation != seenGeneration);
+      });
+      if (m_stop)
+        return;
+
+      seenGeneration = m_generation;
+      job = m_job;
+      count = m_jobCount;
+      m_activeWorkers++;
+    }
+
+    runItems(*job, count);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_activeWorkers--;
+    }
+    m_done.notify_one();
+  }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &fn) {
+  if (count <= 0)
+    return;
+
+  if (m_workers.empty() || count == 1) {
+    for (int i = 0; i < count; i++)
+      fn(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_job = &fn;
+    m_jobCount = count;
+    m_nextIndex.store(0);
+    m_generation++;
+  }
+  m_wake.notify_all();
+
+  runItems(fn, count);
+
+  // All items are claimed; wait for workers still finishing theirs. Workers
+  // that wake up after the job is cleared simply go back to sleep.
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [&] { return m_activeWorkers == 0; });
+  m_job = nullptr;
+}
@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fork-join pool for CPU-side baking and tracing.
+// parallelFor hands out indices dynamically, so uneven work items (e.g.
+// image tiles near the black hole) balance across cores.
+class ThreadPool {
+public:
+  // threadCount = 0 uses one thread per hardware core
+  explicit ThreadPool(unsigned int threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Total number of threads doing work, including the caller
+  unsigned int getThreadCount() const {
+    return (unsigned int)m_workers.size() + 1;
+  }
+
+  // Run fn(i) for every i in [0, count). The calling thread participates
+  // and the call blocks until all items are done.
+  void parallelFor(int count, const std::function<void(int)> &fn);
+
+private:
+  void workerLoop();
+  void runItems(const std::function<void(int)> &fn, int count);
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+
+  const std::function<void(int)> *m_job = nullptr;
+  int m_jobCount = 0;
+  std::atomic<int> m_nextIndex{0};
+  int m_activeWorkers = 0;
+  uint64_t m_generation = 0;
+  bool m_stop = false;
+};
+
+#endif // THREAD_POOL_H
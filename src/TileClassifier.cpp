@@ -0,0 +1,170 @@
+#include "TileClassifier.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+TileClassifier::TileClassifier() {}
+
+TileClassifier::~TileClassifier() { shutdown(); }
+
+void TileClassifier::init() {
+  if (m_vao)
+    return;
+  glGenVertexArrays(1, &m_vao);
+  glGenBuffers(1, &m_vbo);
+  glBindVertexArray(m_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float),
+                        (void *)0);
+  glBindVertexArray(0);
+}
+
+void TileClassifier::shutdown() {
+  if (m_vao) {
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vbo);
+    m_vao = 0;
+    m_vbo = 0;
+  }
+  m_valid = false;
+}
+
+bool TileClassifier::sameView(const View &view) const {
+  return m_valid && view.resolution == m_view.resolution &&
+         view.tileOffset == m_view.tileOffset &&
+         view.cameraDistance == m_view.cameraDistance &&
+         view.cameraAngle == m_view.cameraAngle &&
+         view.boundRadius == m_view.boundRadius &&
+         memcmp(view.viewport, m_view.viewport, sizeof(view.viewport)) == 0;
+}
+
+// Every ray through the tile lies within the cone around its center ray
+// that reaches the corners. The tile misses if that cone and the cone of
+// directions hitting the sphere don't overlap, and the shader's
+// line-vs-sphere test also counts lines hitting it behind the camera.
+bool TileClassifier::tileMisses(const View &view, int x0, int y0, int x1,
+                                int y1) const {
+  float scale = 1.0f / std::min(view.resolution.x, view.resolution.y);
+  glm::vec2 half = 0.5f * view.resolution;
+  auto rayAt = [&](float x, float y) {
+    glm::vec2 uv = (glm::vec2(x, y) + view.tileOffset - half) * scale;
+    return glm::normalize(m_forward + uv.x * m_right + uv.y * m_up);
+  };
+
+  glm::vec3 center = rayAt(0.5f * (x0 + x1), 0.5f * (y0 + y1));
+  float cosSpread = 1.0f;
+  for (int corner = 0; corner < 4; corner++) {
+    glm::vec3 ray = rayAt((float)(corner & 1 ? x1 : x0),
+                          (float)(corner & 2 ? y1 : y0));
+    cosSpread = std::min(cosSpread, glm::dot(center, ray));
+  }
+
+  // Margin for the shader evaluating the same test in single precision
+  const float margin = 1e-3f;
+  float spread = std::acos(glm::clamp(cosSpread, -1.0f, 1.0f));
+  float sphere = std::asin(view.boundRadius / view.cameraDistance);
+  // The camera looks at the hole, so the sphere is centered on m_forward
+  float angle =
+      std::acos(glm::clamp(glm::dot(center, m_forward), -1.0f, 1.0f));
+  const float pi = 3.14159265f;
+  return angle > sphere + spread + margin &&
+         angle < pi - sphere - spread - margin;
+}
+
+void TileClassifier::addRect(std::vector<float> &vertices, const View &view,
+                             int x0, int y0, int x1, int y1) const {
+  // Window pixels to NDC of the viewport
+  float left = 2.0f * (x0 - view.viewport[0]) / view.viewport[2] - 1.0f;
+  float right = 2.0f * (x1 - view.viewport[0]) / view.viewport[2] - 1.0f;
+  float bottom = 2.0f * (y0 - view.viewport[1]) / view.viewport[3] - 1.0f;
+  float top = 2.0f * (y1 - view.viewport[1]) / view.viewport[3] - 1.0f;
+  float quad[12] = {left,  top,    left,  bottom, right, bottom,
+                    left,  top,    right, bottom, right, top};
+  vertices.insert(vertices.end(), quad, quad + 12);
+}
+
+void TileClassifier::update(const glm::vec2 &resolution,
+                            const glm::vec2 &tileOffset, float cameraDistance,
+                            float cameraAngle, float boundRadius) {
+  View view;
+  view.resolution = resolution;
+  view.tileOffset = tileOffset;
+  view.cameraDistance = cameraDistance;
+  view.cameraAngle = cameraAngle;
+  view.boundRadius = boundRadius;
+  glGetIntegerv(GL_VIEWPORT, view.viewport);
+  if (sameView(view))
+    return;
+  m_view = view;
+  m_valid = true;
+
+  // Camera basis as in cameraOrigin() / cameraRay()
+  glm::vec3 ro(0.0f, -std::sin(cameraAngle) * cameraDistance,
+               std::cos(cameraAngle) * cameraDistance);
+  m_forward = glm::normalize(-ro);
+  m_right = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), m_forward));
+  m_up = glm::cross(m_forward, m_right);
+
+  // Inside the bounding sphere every ray marches
+  bool inside = cameraDistance <= boundRadius;
+
+  // Horizontal runs of equal tiles become one rectangle
+  std::vector<float> march, background;
+  int x0 = view.viewport[0], y0 = view.viewport[1];
+  int x1 = x0 + view.viewport[2], y1 = y0 + view.viewport[3];
+  long long marchPixels = 0;
+  for (int ty = y0; ty < y1; ty += kTileSize) {
+    int tyEnd = std::min(ty + kTileSize, y1);
+    int runStart = x0;
+    bool runMisses = false;
+    auto endRun = [&](int runEnd) {
+      addRect(runMisses ? background : march, view, runStart, ty, runEnd,
+              tyEnd);
+      if (!runMisses)
+        marchPixels += (long long)(runEnd - runStart) * (tyEnd - ty);
+    };
+
+    for (int tx = x0; tx < x1; tx += kTileSize) {
+      bool misses = !inside && tileMisses(view, tx, ty,
+                                          std::min(tx + kTileSize, x1), tyEnd);
+      if (tx == x0) {
+        runMisses = misses;
+      } else if (misses != runMisses) {
+        endRun(tx);
+        runStart = tx;
+        runMisses = misses;
+      }
+    }
+    endRun(x1);
+  }
+
+  m_marchVertices = (int)march.size() / 2;
+  m_backgroundVertices = (int)background.size() / 2;
+  m_marchFraction =
+      (float)((double)marchPixels / ((double)view.viewport[2] * view.viewport[3]));
+
+  march.insert(march.end(), background.begin(), background.end());
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBufferData(GL_ARRAY_BUFFER, march.size() * sizeof(float), march.data(),
+               GL_DYNAMIC_DRAW);
+}
+
+void TileClassifier::drawMarchTiles() const {
+  if (m_marchVertices == 0)
+    return;
+  glBindVertexArray(m_vao);
+  glDrawArrays(GL_TRIANGLES, 0, m_marchVertices);
+  glBindVertexArray(0);
+}
+
+void TileClassifier::drawBackgroundTiles() const {
+  if (m_backgroundVertices == 0)
+    return;
+  glBindVertexArray(m_vao);
+  glDrawArrays(GL_TRIANGLES, m_marchVertices, m_backgroundVertices);
+  glBindVertexArray(0);
+}
@@ -0,0 +1,63 @@
+#ifndef TILE_CLASSIFIER_H
+#define TILE_CLASSIFIER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Splits the viewport into kTileSize tiles and sorts them into those whose
+// rays all miss the scene's bounding sphere (stars only) and those that need
+// the march. The test is conservative on the cone of rays through each tile,
+// so drawing the march over the first set only changes nothing but cost.
+// Classification runs on the CPU from the same camera model as
+// scene_common.glsl and is redone only when the view changes.
+class TileClassifier {
+public:
+  static const int kTileSize = 16;
+
+  TileClassifier();
+  ~TileClassifier();
+
+  void init();
+  void shutdown();
+
+  // Classify the current viewport. boundRadius must match missesBounds()
+  // in scene_common.glsl.
+  void update(const glm::vec2 &resolution, const glm::vec2 &tileOffset,
+              float cameraDistance, float cameraAngle, float boundRadius);
+
+  // Draw the tiles of one class with the bound program (vertex.glsl layout)
+  void drawMarchTiles() const;
+  void drawBackgroundTiles() const;
+
+  // Share of the viewport's pixels in march tiles, 0..1
+  float getMarchFraction() const { return m_marchFraction; }
+
+private:
+  struct View {
+    glm::vec2 resolution;
+    glm::vec2 tileOffset;
+    float cameraDistance;
+    float cameraAngle;
+    float boundRadius;
+    int viewport[4];
+  };
+
+  bool sameView(const View &view) const;
+  bool tileMisses(const View &view, int x0, int y0, int x1, int y1) const;
+  void addRect(std::vector<float> &vertices, const View &view, int x0, int y0,
+               int x1, int y1) const;
+
+  unsigned int m_vao = 0;
+  unsigned int m_vbo = 0;
+  View m_view;
+  bool m_valid = false;
+
+  // Ray basis for the current view (see cameraRay())
+  glm::vec3 m_forward, m_right, m_up;
+
+  int m_marchVertices = 0;
+  int m_backgroundVertices = 0;
+  float m_marchFraction = 1.0f;
+};
+
+#endif // TILE_CLASSIFIER_H
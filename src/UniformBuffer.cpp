@@ -0,0 +1,56 @@
+#include "UniformBuffer.h"
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+int uniformBlockBinding(const char *name) {
+  static const struct {
+    const char *name;
+    UniformBlockBinding binding;
+  } blocks[] = {{"BlackHoleBlock", BLACK_HOLE_BLOCK_BINDING},
+                {"CameraBlock", CAMERA_BLOCK_BINDING},
+                {"BloomBlock", BLOOM_BLOCK_BINDING}};
+  for (const auto &block : blocks) {
+    if (strcmp(name, block.name) == 0)
+      return block.binding;
+  }
+  return -1;
+}
+
+UniformBuffer::UniformBuffer() {}
+
+UniformBuffer::~UniformBuffer() {}
+
+void UniformBuffer::init(int binding, size_t size) {
+  m_binding = binding;
+  m_contents.assign(size, 0);
+  m_uploaded = false;
+
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::shutdown() {
+  if (m_buffer) {
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+  }
+  m_uploaded = false;
+}
+
+void UniformBuffer::update(const void *data) {
+  if (!m_buffer)
+    return;
+
+  glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+  if (m_uploaded && memcmp(data, m_contents.data(), m_contents.size()) == 0)
+    return;
+
+  memcpy(m_contents.data(), data, m_contents.size());
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, m_contents.size(), data);
+  m_uploaded = true;
+  m_uploadCount++;
+}
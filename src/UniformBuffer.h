@@ -0,0 +1,79 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Binding points of the std140 blocks in assets/shaders/uniform_blocks.glsl.
+// GLSL 3.30 has no layout(binding), so Shader assigns these by block name
+// when it links.
+enum UniformBlockBinding {
+  BLACK_HOLE_BLOCK_BINDING = 0,
+  CAMERA_BLOCK_BINDING = 1,
+  BLOOM_BLOCK_BINDING = 2,
+};
+
+// Binding point of the block called 'name', -1 for an unknown block
+int uniformBlockBinding(const char *name);
+
+// std140 mirrors of the GLSL blocks; keep the two in sync. Fill them from
+// a value-initialized struct so the padding compares equal.
+struct BlackHoleBlock {
+  float radius;
+  float diskInnerRadius;
+  float diskOuterRadius;
+  float diskThickness;
+  glm::vec3 diskColor1;
+  float glowIntensity;
+  glm::vec3 diskColor2;
+  float pad0;
+};
+
+struct CameraBlock {
+  float distance;
+  float angle;
+  float pad0[2];
+};
+
+struct BloomBlock {
+  float threshold;
+  float intensity;
+  float strength;
+  float exposure;
+};
+
+static_assert(sizeof(BlackHoleBlock) == 48, "BlackHoleBlock must match std140");
+static_assert(sizeof(CameraBlock) == 16, "CameraBlock must match std140");
+static_assert(sizeof(BloomBlock) == 16, "BloomBlock must match std140");
+
+// Uniform buffer for one block, with a copy of what was last uploaded so
+// unchanged contents cost no upload. Several buffers may share a binding
+// point; update() rebinds on every call.
+class UniformBuffer {
+public:
+  UniformBuffer();
+  ~UniformBuffer();
+
+  void init(int binding, size_t size);
+  void shutdown();
+
+  // Bind the buffer to its binding point, uploading 'data' (the size given
+  // to init()) only if it differs from the previous upload
+  void update(const void *data);
+
+  template <typename T> void update(const T &block) {
+    static_assert(sizeof(T) % 16 == 0, "std140 blocks are vec4 sized");
+    update(static_cast<const void *>(&block));
+  }
+
+  int getUploadCount() const { return m_uploadCount; }
+
+private:
+  unsigned int m_buffer = 0;
+  int m_binding = 0;
+  std::vector<unsigned char> m_contents;
+  bool m_uploaded = false;
+  int m_uploadCount = 0;
+};
+
+#endif // UNIFORM_BUFFER_H
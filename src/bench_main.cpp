@@ -0,0 +1,368 @@
+#include "GpuProfiler.h"
+#include "HeadlessContext.h"
+#include "OffscreenRenderer.h"
+#include "RenderSettings.h"
+#include "ShaderCache.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Offscreen benchmark: renders the real scene + bloom pipeline over a
+// matrix of resolutions and parameter presets along a scripted camera
+// orbit, and writes per-pass percentiles and startup timings as JSON.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - since)
+      .count();
+}
+
+struct Resolution {
+  std::string name;
+  int width;
+  int height;
+};
+
+struct Preset {
+  const char *name;
+  const char *description;
+  BlackHoleParams params;
+};
+
+static std::vector<Preset> makePresets() {
+  std::vector<Preset> presets;
+
+  presets.push_back({"default", "UI defaults", BlackHoleParams()});
+
+  BlackHoleParams massive;
+  massive.radius = 1.0f;
+  massive.diskInnerRadius = 1.6f;
+  massive.diskOuterRadius = 7.0f;
+  massive.diskThickness = 0.5f;
+  massive.glowIntensity = 1.5f;
+  presets.push_back({"massive", "large horizon, thick wide disk", massive});
+
+  BlackHoleParams thin;
+  thin.radius = 0.3f;
+  thin.diskInnerRadius = 0.6f;
+  thin.diskOuterRadius = 5.0f;
+  thin.diskThickness = 0.08f;
+  presets.push_back({"thin", "small horizon, thin disk", thin});
+
+  return presets;
+}
+
+static bool parseResolution(const std::string &token, Resolution &out) {
+  static const Resolution named[] = {{"360p", 640, 360},
+                                     {"720p", 1280, 720},
+                                     {"1080p", 1920, 1080},
+                                     {"1440p", 2560, 1440},
+                                     {"4k", 3840, 2160}};
+  for (const Resolution &r : named) {
+    if (token == r.name) {
+      out = r;
+      return true;
+    }
+  }
+  int w, h;
+  char trailing;
+  if (sscanf(token.c_str(), "%dx%d%c", &w, &h, &trailing) == 2 && w > 0 &&
+      h > 0) {
+    out = {token, w, h};
+    return true;
+  }
+  return false;
+}
+
+static std::vector<std::string> splitList(const std::string &value) {
+  std::vector<std::string> items;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty())
+      items.push_back(item);
+  }
+  return items;
+}
+
+// Nearest-rank percentile of an unsorted sample set
+static double percentile(std::vector<double> samples, double p) {
+  if (samples.empty())
+    return 0.0;
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+  rank = std::min(std::max(rank, (size_t)1), samples.size());
+  return samples[rank - 1];
+}
+
+static void writeStats(std::ostream &out, const std::vector<double> &samples) {
+  double sum = 0.0;
+  for (double ms : samples)
+    sum += ms;
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer),
+           "{\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, "
+           "\"min\": %.4f, \"max\": %.4f}",
+           samples.empty() ? 0.0 : sum / samples.size(),
+           percentile(samples, 50.0), percentile(samples, 95.0),
+           percentile(samples, 99.0), percentile(samples, 0.0),
+           percentile(samples, 100.0));
+  out << buffer;
+}
+
+static std::string jsonString(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if ((unsigned char)c < 0x20)
+      continue;
+    out += c;
+  }
+  return out + "\"";
+}
+
+// Camera for measured frame 'frame' of 'count': one full swing of the
+// elevation and a dolly in and out, with the disk advancing at 60 fps
+static void orbitCamera(const RenderSettings &base, int frame, int count,
+                        RenderSettings &settings) {
+  const float pi = 3.14159265f;
+  float t = count > 1 ? (float)frame / (float)count : 0.0f;
+  settings.camera.angle = base.camera.angle + 0.6f * std::sin(2.0f * pi * t);
+  settings.camera.distance =
+      base.camera.distance * (1.0f + 0.25f * std::cos(2.0f * pi * t));
+  settings.time = base.time + frame / 60.0f;
+}
+
+static void printUsage(const char *program) {
+  std::cout
+      << "Usage: " << program << " [options] [--render-setting value]...\n"
+      << "\n"
+      << "  --resolutions LIST   720p,1080p,4k (default); also 360p, 1440p,\n"
+      << "                       WxH\n"
+      << "  --presets LIST       default,massive,thin (default: all)\n"
+      << "  --warmup N           Unmeasured frames per case (default 3)\n"
+      << "  --frames N           Measured frames per case (default 30)\n"
+      << "  --output FILE        JSON report (default blackhole_bench.json)\n"
+      << "\n"
+      << "Other options are render settings as in BlackHoleHeadless\n"
+      << "(e.g. --starfield-format, --deflection-lut, --bloom).\n";
+}
+
+int main(int argc, char **argv) {
+  std::vector<Resolution> resolutions;
+  std::vector<std::string> presetNames;
+  int warmupFrames = 3;
+  int measuredFrames = 30;
+  std::string output = "blackhole_bench.json";
+  RenderSettings base;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      printUsage(argv[0]);
+      return 0;
+    }
+    if (arg.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+      std::cerr << "Expected --key value, got " << arg << std::endl;
+      return 1;
+    }
+    std::string key = arg.substr(2);
+    std::string value = argv[++i];
+
+    bool ok = true;
+    if (key == "resolutions") {
+      for (const std::string &token : splitList(value)) {
+        Resolution r;
+        ok = ok && parseResolution(token, r);
+        resolutions.push_back(r);
+      }
+    } else if (key == "presets") {
+      presetNames = splitList(value);
+    } else if (key == "warmup") {
+      warmupFrames = atoi(value.c_str());
+      ok = warmupFrames >= 0;
+    } else if (key == "frames") {
+      measuredFrames = atoi(value.c_str());
+      ok = measuredFrames > 0;
+    } else if (key == "output") {
+      output = value;
+    } else {
+      ok = applyRenderSetting(base, key, value);
+    }
+    if (!ok) {
+      std::cerr << "Invalid value for --" << key << ": " << value << std::endl;
+      return 1;
+    }
+  }
+  if (!checkRenderSettings(base))
+    return 1;
+
+  if (resolutions.empty()) {
+    for (const char *name : {"720p", "1080p", "4k"}) {
+      Resolution r;
+      parseResolution(name, r);
+      resolutions.push_back(r);
+    }
+  }
+
+  std::vector<Preset> allPresets = makePresets();
+  std::vector<Preset> presets;
+  if (presetNames.empty()) {
+    presets = allPresets;
+  } else {
+    for (const std::string &name : presetNames) {
+      auto it = std::find_if(allPresets.begin(), allPresets.end(),
+                             [&](const Preset &p) { return name == p.name; });
+      if (it == allPresets.end()) {
+        std::cerr << "Unknown preset: " << name << std::endl;
+        return 1;
+      }
+      presets.push_back(*it);
+    }
+  }
+
+  // Startup
+  auto start = Clock::now();
+  HeadlessContext context;
+  if (!context.init())
+    return -1;
+  double contextMs = elapsedMs(start);
+
+  OffscreenRenderer renderer;
+  renderer.getBlackHoleRenderer().getOptions() = base.options;
+  start = Clock::now();
+  if (!renderer.init(resolutions[0].width, resolutions[0].height))
+    return -1;
+  double initMs = elapsedMs(start);
+  StartupTimings timings = renderer.getBlackHoleRenderer().getStartupTimings();
+
+  // First frame includes driver-side shader variant compiles
+  RenderSettings first = base;
+  first.width = resolutions[0].width;
+  first.height = resolutions[0].height;
+  start = Clock::now();
+  renderer.render(first);
+  glFinish();
+  double firstFrameMs = elapsedMs(start);
+  ShaderCache::Stats programs = ShaderCache::getStats();
+
+  GpuProfiler profiler(measuredFrames);
+  renderer.setProfiler(&profiler);
+
+  std::ostringstream cases;
+  bool firstCase = true;
+  for (const Resolution &resolution : resolutions) {
+    for (const Preset &preset : presets) {
+      RenderSettings settings = base;
+      settings.width = resolution.width;
+      settings.height = resolution.height;
+      settings.blackHole = preset.params;
+
+      std::vector<double> warmup;
+      for (int f = 0; f < warmupFrames; f++) {
+        orbitCamera(base, 0, measuredFrames, settings);
+        auto frameStart = Clock::now();
+        renderer.render(settings);
+        glFinish();
+        warmup.push_back(elapsedMs(frameStart));
+      }
+
+      profiler.reset();
+      std::vector<double> frameMs;
+      for (int f = 0; f < measuredFrames; f++) {
+        orbitCamera(base, f, measuredFrames, settings);
+        auto frameStart = Clock::now();
+        profiler.beginFrame();
+        renderer.render(settings);
+        profiler.endFrame();
+        glFinish();
+        frameMs.push_back(elapsedMs(frameStart));
+      }
+      profiler.flush();
+
+      std::cout << resolution.name << " " << preset.name << ": p50 "
+                << percentile(frameMs, 50.0) << " ms, p99 "
+                << percentile(frameMs, 99.0) << " ms" << std::endl;
+
+      cases << (firstCase ? "" : ",\n") << "    {\n"
+            << "      \"resolution\": " << jsonString(resolution.name)
+            << ", \"width\": " << resolution.width
+            << ", \"height\": " << resolution.height << ",\n"
+            << "      \"preset\": " << jsonString(preset.name) << ",\n"
+            << "      \"warmup_ms\": [";
+      for (size_t w = 0; w < warmup.size(); w++)
+        cases << (w ? ", " : "") << warmup[w];
+      cases << "],\n      \"frame_ms\": ";
+      writeStats(cases, frameMs);
+      cases << ",\n      \"gpu_pass_ms\": {";
+
+      std::vector<float> history;
+      for (int p = 0; p < profiler.getPassCount(); p++) {
+        profiler.getHistory(p, history);
+        std::vector<double> samples(history.begin(), history.end());
+        cases << (p ? "," : "") << "\n        "
+              << jsonString(profiler.getPassName(p)) << ": ";
+        writeStats(cases, samples);
+      }
+      cases << "\n      }\n    }";
+      firstCase = false;
+    }
+  }
+  renderer.setProfiler(nullptr);
+  profiler.shutdown();
+
+  std::ofstream file(output);
+  if (!file) {
+    std::cerr << "Failed to open " << output << " for writing" << std::endl;
+    return 1;
+  }
+
+  char date[64];
+  time_t now = time(0);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  file << "{\n"
+       << "  \"date\": " << jsonString(date) << ",\n"
+       << "  \"renderer\": " << jsonString(context.getRenderer()) << ",\n"
+       << "  \"gl_version\": "
+       << jsonString((const char *)glGetString(GL_VERSION)) << ",\n"
+       << "  \"warmup_frames\": " << warmupFrames << ",\n"
+       << "  \"measured_frames\": " << measuredFrames << ",\n"
+       << "  \"startup_ms\": {\"context\": " << contextMs
+       << ", \"shader_compile\": " << timings.shaderMs
+       << ", \"noise_bake\": " << timings.noiseMs
+       << ", \"starfield_bake\": " << timings.starfieldMs
+       << ", \"renderer_init\": " << initMs
+       << ", \"first_frame\": " << firstFrameMs << "},\n"
+       << "  \"shader_programs\": {\"compiled\": " << programs.compiled
+       << ", \"from_binary\": " << programs.fromBinary
+       << ", \"shared\": " << programs.shared << "},\n"
+       << "  \"presets\": {";
+  for (size_t p = 0; p < presets.size(); p++) {
+    file << (p ? ", " : "") << jsonString(presets[p].name) << ": "
+         << jsonString(presets[p].description);
+  }
+  file << "},\n"
+       << "  \"cases\": [\n"
+       << cases.str() << "\n  ]\n}\n";
+
+  if (!file) {
+    std::cerr << "Failed to write " << output << std::endl;
+    return 1;
+  }
+  std::cout << "Saved: " << output << std::endl;
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include "HeadlessContext.h"
+#include "OffscreenRenderer.h"
+#include "RenderSettings.h"
+#include "SequenceExporter.h"
+#include "SharedFrameOutput.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// Render settings.frames frames into a shared-memory ring, one every
+// 1 / fps seconds of wall time so a consumer sees them live
+static bool streamSharedFrames(OffscreenRenderer &renderer,
+                               const RenderSettings &settings) {
+  SharedFrameOutput output;
+  if (!output.open(settings.sharedMemory, settings.width, settings.height,
+                   settings.sharedContent))
+    return false;
+
+  using Clock = std::chrono::steady_clock;
+  const auto step = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / settings.fps));
+  auto next = Clock::now();
+  for (int k = 0; k < settings.frames; k++) {
+    std::this_thread::sleep_until(next);
+    next += step;
+
+    RenderSettings frame = SequenceExporter::frameSettings(settings, k);
+    renderer.render(frame);
+
+    SharedFrameSlot info = {};
+    info.frameIndex = (uint64_t)k;
+    info.paramsHash =
+        hashFrameParams(frame.blackHole, frame.camera, frame.bloom);
+    info.timestampNs = (uint64_t)std::chrono::duration_cast<
+                           std::chrono::nanoseconds>(
+                           Clock::now().time_since_epoch())
+                           .count();
+    info.time = frame.time;
+    info.diskPhase = frame.diskPhase;
+    output.capture(renderer.getBloomRenderer().getSceneTexture(),
+                   renderer.getOutputFBO(), info);
+    output.update();
+  }
+  output.close();
+  return true;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      printRenderSettingsUsage(argv[0]);
+      return 0;
+    }
+  }
+
+  RenderSettings settings;
+  if (!parseRenderSettingsArgs(settings, argc, argv)) {
+    printRenderSettingsUsage(argv[0]);
+    return 1;
+  }
+
+  // Frames go to stdout; keep log output out of the stream
+  if (settings.output == "-")
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+  HeadlessContext context;
+  if (!context.init()) {
+    return -1;
+  }
+
+  OffscreenRenderer renderer;
+  if (!settings.sharedMemory.empty()) {
+    if (!renderer.init(settings.width, settings.height)) {
+      return -1;
+    }
+    return streamSharedFrames(renderer, settings) ? 0 : 1;
+  }
+
+  // Video outputs take any number of frames, a single one included
+  if (settings.frames > 1 || SequenceExporter::isY4MOutput(settings.output)) {
+    if (!renderer.init(settings.width, settings.height)) {
+      return -1;
+    }
+    SequenceExporter exporter(renderer);
+    return exporter.run(settings) ? 0 : 1;
+  }
+
+  if (settings.tileSize > 0) {
+    // The target is sized to the tile window, never the full image
+    if (!renderer.init(std::min(settings.width, settings.tileSize),
+                       std::min(settings.height, settings.tileSize))) {
+      return -1;
+    }
+    return renderer.renderTiledPNG(settings, settings.tileSize,
+                                   settings.output)
+               ? 0
+               : 1;
+  }
+
+  if (!renderer.init(settings.width, settings.height)) {
+    return -1;
+  }
+
+  renderer.render(settings);
+
+  return renderer.savePNG(settings.output) ? 0 : 1;
+}
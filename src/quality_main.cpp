@@ -0,0 +1,843 @@
+#include "AssetCache.h"
+#include "HeadlessContext.h"
+#include "ImageMetrics.h"
+#include "OffscreenRenderer.h"
+#include "RenderSettings.h"
+#include "stb_image_write.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Quality regression for approximate render paths: renders a fixed set of
+// scenes in several modes, scores each against a stored reference render
+// (no approximations, highest step count) over the whole image and over
+// the regions approximations tend to break, and reports the time each mode
+// takes next to it. A fast path then comes with a measured image cost.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - since)
+      .count();
+}
+
+struct Scene {
+  const char *name;
+  const char *description;
+  BlackHoleParams params;
+  CameraParams camera;
+  float time;
+};
+
+static std::vector<Scene> makeScenes() {
+  std::vector<Scene> scenes;
+
+  scenes.push_back({"default", "UI defaults", BlackHoleParams(),
+                    CameraParams(), 1.0f});
+
+  CameraParams edgeOn;
+  edgeOn.distance = 12.0f;
+  edgeOn.angle = 0.05f;
+  scenes.push_back({"edge-on", "disk seen edge-on, strongest lensed arc",
+                    BlackHoleParams(), edgeOn, 2.0f});
+
+  CameraParams close;
+  close.distance = 5.0f;
+  close.angle = 0.3f;
+  scenes.push_back({"close", "camera near the inner disk", BlackHoleParams(),
+                    close, 0.5f});
+
+  BlackHoleParams massive;
+  massive.radius = 1.0f;
+  massive.diskInnerRadius = 1.6f;
+  massive.diskOuterRadius = 7.0f;
+  massive.diskThickness = 0.5f;
+  massive.glowIntensity = 1.5f;
+  CameraParams above;
+  above.distance = 14.0f;
+  above.angle = 0.8f;
+  scenes.push_back({"massive", "large horizon, thick wide disk, from above",
+                    massive, above, 3.0f});
+
+  return scenes;
+}
+
+// A mode is a list of render settings applied on top of the reference, so
+// each row measures its own approximations and nothing else
+struct Mode {
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> settings;
+  std::string reference; // Name of the reference it is scored against;
+                         // empty for references themselves
+};
+
+static const char *REFERENCE_MODE = "reference";
+
+// Settings that pick a different light model rather than approximate one.
+// A mode that changes one is scored against a reference rendered with the
+// same model ("reference-<value>"), since the models disagree by design.
+static const char *MODEL_KEYS[] = {"integrator"};
+
+// The reference: every option that trades image quality for time off
+static const char *REFERENCE_SETTINGS =
+    "quality=ultra integrator=march starfield-format=half deflection-lut=0 "
+    "resolution-scale=1 geodesic-cache=0 tile-classify=0 compute-tracer=0 "
+    "cpu-tracer=0";
+
+static const char *BUILTIN_MODES[][2] = {
+    {"defaults", "quality=high starfield-format=rgb9e5 tile-classify=1"},
+    {"low", "quality=low"},
+    {"medium", "quality=medium"},
+    {"high", "quality=high"},
+    {"ultra", "quality=ultra"},
+    {"lut", "deflection-lut=1"},
+    {"half-res", "resolution-scale=0.5"},
+    {"geodesic-cache", "geodesic-cache=1"},
+    {"compute", "compute-tracer=1"},
+    {"bc6h", "starfield-format=bc6h"},
+    {"tile-classify", "tile-classify=1"},
+    {"binet", "integrator=binet quality=high"},
+};
+
+// "key=value key=value ..."
+static bool parseModeSettings(const std::string &definition, Mode &mode) {
+  std::istringstream stream(definition);
+  std::string token;
+  while (stream >> token) {
+    size_t eq = token.find('=');
+    RenderSettings scratch;
+    if (eq == std::string::npos ||
+        !applyRenderSetting(scratch, token.substr(0, eq),
+                            token.substr(eq + 1))) {
+      std::cerr << "Invalid mode setting: " << token << std::endl;
+      return false;
+    }
+    mode.settings.emplace_back(token.substr(0, eq), token.substr(eq + 1));
+  }
+  return true;
+}
+
+static RenderSettings modeSettings(const RenderSettings &base,
+                                   const Scene &scene, const Mode &reference,
+                                   const Mode &mode) {
+  RenderSettings settings = base;
+  settings.blackHole = scene.params;
+  settings.camera = scene.camera;
+  settings.time = scene.time;
+  for (const auto &setting : reference.settings)
+    applyRenderSetting(settings, setting.first, setting.second);
+  for (const auto &setting : mode.settings)
+    applyRenderSetting(settings, setting.first, setting.second);
+  return settings;
+}
+
+// The reference 'mode' is scored against: 'reference' with any model
+// settings the mode changes
+static Mode referenceFor(const Mode &reference, const Mode &mode) {
+  Mode variant = reference;
+  for (const auto &setting : mode.settings) {
+    for (const char *key : MODEL_KEYS) {
+      if (setting.first != key)
+        continue;
+      bool same = false;
+      for (const auto &base : reference.settings)
+        same = same || (base.first == key && base.second == setting.second);
+      if (!same) {
+        variant.name += "-" + setting.second;
+        variant.settings.push_back(setting);
+      }
+    }
+  }
+  return variant;
+}
+
+static std::vector<std::string> splitList(const std::string &value) {
+  std::vector<std::string> items;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty())
+      items.push_back(item);
+  }
+  return items;
+}
+
+// Nearest-rank percentile of an unsorted sample set
+static double percentile(std::vector<double> samples, double p) {
+  if (samples.empty())
+    return 0.0;
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+  rank = std::min(std::max(rank, (size_t)1), samples.size());
+  return samples[rank - 1];
+}
+
+// --- Stored references ---
+
+static const uint32_t REFERENCE_VERSION = 1;
+
+// Followed by RGB8 pixels, top row first
+struct ReferenceHeader {
+  char magic[8]; // "BHREFIM\0"
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t width;
+  uint32_t height;
+  uint64_t sceneHash; // referenceHash() of the settings it was rendered with
+};
+static_assert(sizeof(ReferenceHeader) == 32,
+              "ReferenceHeader must not contain padding");
+
+static const char REFERENCE_MAGIC[8] = {'B', 'H', 'R', 'E', 'F', 'I', 'M', 0};
+
+// Everything that changes the reference image apart from the shaders,
+// which are what the references guard
+static uint64_t referenceHash(const RenderSettings &settings) {
+  const float values[] = {settings.blackHole.radius,
+                          settings.blackHole.diskInnerRadius,
+                          settings.blackHole.diskOuterRadius,
+                          settings.blackHole.diskThickness,
+                          settings.blackHole.diskColor1.x,
+                          settings.blackHole.diskColor1.y,
+                          settings.blackHole.diskColor1.z,
+                          settings.blackHole.diskColor2.x,
+                          settings.blackHole.diskColor2.y,
+                          settings.blackHole.diskColor2.z,
+                          settings.blackHole.glowIntensity,
+                          settings.blackHole.diskSpeed,
+                          settings.camera.distance,
+                          settings.camera.angle,
+                          settings.bloom.threshold,
+                          settings.bloom.intensity,
+                          settings.bloom.strength,
+                          settings.bloom.exposure,
+                          settings.bloom.radius,
+                          settings.bloom.enabled ? 1.0f : 0.0f,
+                          settings.time,
+                          settings.resolvedDiskPhase()};
+  return hashBytes(values, sizeof(values));
+}
+
+// "" for the reference, "-<model>" for the others
+static std::string referenceSuffix(const Mode &reference) {
+  return reference.name.substr(strlen(REFERENCE_MODE));
+}
+
+static std::string referencePath(const std::string &dir, const Scene &scene,
+                                 const Mode &reference,
+                                 const RenderSettings &settings) {
+  return dir + "/" + scene.name + "_" + std::to_string(settings.width) + "x" +
+         std::to_string(settings.height) + referenceSuffix(reference) +
+         ".bhref";
+}
+
+// False if the file is missing; 'stale' is set if it exists but was
+// rendered from other settings
+static bool loadReference(const std::string &path,
+                          const RenderSettings &settings,
+                          std::vector<unsigned char> &pixels, bool &stale) {
+  stale = false;
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+
+  ReferenceHeader header;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || memcmp(header.magic, REFERENCE_MAGIC, sizeof(header.magic)) ||
+      header.version != REFERENCE_VERSION ||
+      header.headerSize != sizeof(header) ||
+      header.width != (uint32_t)settings.width ||
+      header.height != (uint32_t)settings.height ||
+      header.sceneHash != referenceHash(settings)) {
+    stale = true;
+    return false;
+  }
+
+  pixels.resize((size_t)settings.width * settings.height * 3);
+  file.read(reinterpret_cast<char *>(pixels.data()), pixels.size());
+  if (!file) {
+    stale = true;
+    return false;
+  }
+  return true;
+}
+
+static bool saveReference(const std::string &path,
+                          const RenderSettings &settings,
+                          const std::vector<unsigned char> &pixels) {
+  ReferenceHeader header = {};
+  memcpy(header.magic, REFERENCE_MAGIC, sizeof(header.magic));
+  header.version = REFERENCE_VERSION;
+  header.headerSize = sizeof(header);
+  header.width = (uint32_t)settings.width;
+  header.height = (uint32_t)settings.height;
+  header.sceneHash = referenceHash(settings);
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+  if (!file) {
+    std::cerr << "Failed to write reference " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// mkdir -p, so a first --update-references run needs no setup
+static bool createDirectory(const std::string &path) {
+  std::error_code error;
+  std::filesystem::create_directories(path, error);
+  if (error) {
+    std::cerr << "Failed to create " << path << ": " << error.message()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// --- Regions ---
+
+enum Region { HORIZON_EDGE, PHOTON_RING, DISK, REGION_COUNT };
+static const char *REGION_NAMES[REGION_COUNT] = {"horizon_edge",
+                                                 "photon_ring", "disk"};
+
+// Pixels within 'radius' (Chebyshev distance) of a set pixel
+static void dilate(const std::vector<unsigned char> &mask, int width,
+                   int height, int radius, std::vector<unsigned char> &out) {
+  std::vector<unsigned char> rows(mask.size(), 0);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      unsigned char &value = rows[(size_t)y * width + x];
+      for (int k = std::max(x - radius, 0);
+           k <= std::min(x + radius, width - 1) && !value; k++)
+        value = mask[(size_t)y * width + k];
+    }
+  }
+  out.assign(mask.size(), 0);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      unsigned char &value = out[(size_t)y * width + x];
+      for (int k = std::max(y - radius, 0);
+           k <= std::min(y + radius, height - 1) && !value; k++)
+        value = rows[(size_t)k * width + x];
+    }
+  }
+}
+
+// Per-pixel masks (top row first) from the camera model of
+// scene_common.glsl and the reference image. The shadow is the black area
+// (bloom off, as by default) connected to rays aimed inside the horizon.
+//   horizon edge: a band of about 1% of the image around the shadow's edge
+//   photon ring:  the lensed ring just outside it, three bands wide
+//   disk:         direct image of the disk (primary rays hitting its plane
+//                 between the inner and outer radius, before lensing)
+static void computeRegions(const RenderSettings &settings,
+                           const std::vector<unsigned char> &reference,
+                           std::vector<unsigned char> masks[REGION_COUNT]) {
+  int width = settings.width;
+  int height = settings.height;
+  size_t pixels = (size_t)width * height;
+  const BlackHoleParams &bh = settings.blackHole;
+  float distance = settings.camera.distance;
+
+  glm::vec3 ro(0.0f, -std::sin(settings.camera.angle) * distance,
+               std::cos(settings.camera.angle) * distance);
+  glm::vec3 forward = glm::normalize(-ro);
+  glm::vec3 right =
+      glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), forward));
+  glm::vec3 up = glm::cross(forward, right);
+  float scale = 1.0f / (float)std::min(width, height);
+  float horizonRadius = std::atan(bh.radius / distance);
+
+  for (int r = 0; r < REGION_COUNT; r++)
+    masks[r].assign(pixels, 0);
+  std::vector<unsigned char> black(pixels, 0);
+  std::vector<unsigned char> shadow(pixels, 0);
+  std::vector<size_t> stack;
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      size_t i = (size_t)y * width + x;
+      glm::vec2 uv((x + 0.5f - 0.5f * width) * scale,
+                   (height - 1 - y + 0.5f - 0.5f * height) * scale);
+      glm::vec3 rd = glm::normalize(forward + uv.x * right + uv.y * up);
+      float angularDist =
+          std::acos(std::min(std::max(glm::dot(rd, forward), -1.0f), 1.0f));
+
+      const unsigned char *p = &reference[i * 3];
+      black[i] = p[0] <= 1 && p[1] <= 1 && p[2] <= 1;
+      if (black[i] && angularDist < horizonRadius) {
+        shadow[i] = 1;
+        stack.push_back(i);
+      }
+      if (rd.y != 0.0f) {
+        float t = -ro.y / rd.y;
+        glm::vec3 hit = ro + t * rd;
+        float radius = glm::length(glm::vec2(hit.x, hit.z));
+        masks[DISK][i] = t > 0.0f && radius >= bh.diskInnerRadius &&
+                         radius <= bh.diskOuterRadius;
+      }
+    }
+  }
+
+  while (!stack.empty()) {
+    size_t i = stack.back();
+    stack.pop_back();
+    int x = (int)(i % width);
+    int y = (int)(i / width);
+    const size_t neighbours[4] = {x > 0 ? i - 1 : i, x < width - 1 ? i + 1 : i,
+                                  y > 0 ? i - width : i,
+                                  y < height - 1 ? i + width : i};
+    for (size_t n : neighbours) {
+      if (black[n] && !shadow[n]) {
+        shadow[n] = 1;
+        stack.push_back(n);
+      }
+    }
+  }
+
+  std::vector<unsigned char> edge(pixels, 0);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      size_t i = (size_t)y * width + x;
+      edge[i] = (x > 0 && shadow[i] != shadow[i - 1]) ||
+                (y > 0 && shadow[i] != shadow[i - width]);
+    }
+  }
+  int band = std::max(2, std::min(width, height) / 100);
+  std::vector<unsigned char> outer;
+  dilate(edge, width, height, band, masks[HORIZON_EDGE]);
+  dilate(edge, width, height, 4 * band, outer);
+  for (size_t i = 0; i < pixels; i++) {
+    masks[PHOTON_RING][i] =
+        outer[i] && !shadow[i] && !masks[HORIZON_EDGE][i];
+  }
+}
+
+// --- Images for inspection ---
+
+// Reference dimmed, regions tinted: horizon edge red, ring green, disk blue
+static bool saveRegionImage(const std::string &path, int width, int height,
+                            const std::vector<unsigned char> &reference,
+                            const std::vector<unsigned char> masks[]) {
+  std::vector<unsigned char> image(reference.size());
+  for (size_t i = 0; i < (size_t)width * height; i++) {
+    for (int c = 0; c < 3; c++) {
+      int value = reference[i * 3 + c] / 3;
+      if (masks[c][i])
+        value += 160;
+      image[i * 3 + c] = (unsigned char)std::min(value, 255);
+    }
+  }
+  return stbi_write_png(path.c_str(), width, height, 3, image.data(),
+                        width * 3) != 0;
+}
+
+// Largest channel difference as a heat ramp, white at 32 levels or more
+static bool saveErrorImage(const std::string &path, int width, int height,
+                           const std::vector<unsigned char> &image,
+                           const std::vector<unsigned char> &reference) {
+  std::vector<unsigned char> heat(image.size());
+  for (size_t i = 0; i < (size_t)width * height; i++) {
+    int error = 0;
+    for (int c = 0; c < 3; c++)
+      error = std::max(error, std::abs((int)image[i * 3 + c] -
+                                       (int)reference[i * 3 + c]));
+    float t = std::min(error / 32.0f, 1.0f);
+    for (int c = 0; c < 3; c++) {
+      float channel = std::min(std::max(3.0f * t - c, 0.0f), 1.0f);
+      heat[i * 3 + c] = (unsigned char)(channel * 255.0f + 0.5f);
+    }
+  }
+  return stbi_write_png(path.c_str(), width, height, 3, heat.data(),
+                        width * 3) != 0;
+}
+
+// --- Report ---
+
+// "-" for an empty region
+static std::string formatPSNR(const ImageMetrics &metrics) {
+  if (metrics.pixels == 0)
+    return "-";
+  if (std::isinf(metrics.psnr))
+    return "inf";
+  char text[32];
+  snprintf(text, sizeof(text), "%.2f", metrics.psnr);
+  return text;
+}
+
+static std::string jsonNumber(double value) {
+  if (!std::isfinite(value))
+    return "null";
+  char text[32];
+  snprintf(text, sizeof(text), "%.6g", value);
+  return text;
+}
+
+static std::string jsonString(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if ((unsigned char)c < 0x20)
+      continue;
+    out += c;
+  }
+  return out + "\"";
+}
+
+static void writeMetrics(std::ostream &out, const ImageMetrics &metrics) {
+  out << "{\"psnr\": " << jsonNumber(metrics.psnr)
+      << ", \"ssim\": " << jsonNumber(metrics.ssim)
+      << ", \"mse\": " << jsonNumber(metrics.mse)
+      << ", \"max_error\": " << metrics.maxError
+      << ", \"pixels\": " << metrics.pixels << "}";
+}
+
+static void printUsage(const char *program) {
+  std::cout
+      << "Usage: " << program << " [options] [--render-setting value]...\n"
+      << "\n"
+      << "  --scenes LIST          default,edge-on,close,massive\n"
+      << "                         (default: all)\n"
+      << "  --modes LIST           defaults,low,medium,high,ultra,lut,\n"
+      << "                         half-res,geodesic-cache,compute,bc6h,\n"
+      << "                         tile-classify,binet (default: all)\n"
+      << "  --mode 'name k=v ...'  Add a mode: render settings applied to\n"
+      << "                         the reference settings\n"
+      << "  --references DIR       Stored references (default 'reference');\n"
+      << "                         a missing one is an error\n"
+      << "  --update-references 0|1\n"
+      << "                         Write the references from this build's\n"
+      << "                         renders instead of scoring against them\n"
+      << "  --frames N             Timed frames per case (default 3)\n"
+      << "  --error-maps DIR       Write region and per-mode error images\n"
+      << "  --output FILE          JSON report (default\n"
+      << "                         blackhole_quality.json)\n"
+      << "  --min-psnr DB          Fail if a case scores below DB overall\n"
+      << "  --min-ssim S           Fail if a case scores below S overall\n"
+      << "\n"
+      << "Other options are base render settings as in BlackHoleHeadless\n"
+      << "(default 320x180, bloom off). References are rendered at ultra\n"
+      << "quality with every approximation off, and every mode starts from\n"
+      << "those settings, so a row measures only its own approximations\n"
+      << "('defaults' is the app's default combination). Modes that change\n"
+      << "the integrator get a reference of their own ('reference-binet').\n"
+      << "The 'reference' rows compare this build's reference renders with\n"
+      << "the stored ones.\n";
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> sceneNames;
+  std::vector<std::string> modeNames;
+  std::vector<Mode> extraModes;
+  std::string referenceDir = "reference";
+  bool updateReferences = false;
+  int timedFrames = 3;
+  std::string errorMapDir;
+  std::string output = "blackhole_quality.json";
+  double minPSNR = 0.0;
+  double minSSIM = -1.0;
+  RenderSettings base;
+  base.width = 320;
+  base.height = 180;
+  base.bloom.enabled = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      printUsage(argv[0]);
+      return 0;
+    }
+    if (arg.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+      std::cerr << "Expected --key value, got " << arg << std::endl;
+      return 1;
+    }
+    std::string key = arg.substr(2);
+    std::string value = argv[++i];
+
+    bool ok = true;
+    if (key == "scenes") {
+      sceneNames = splitList(value);
+    } else if (key == "modes") {
+      modeNames = splitList(value);
+    } else if (key == "mode") {
+      Mode mode;
+      std::istringstream stream(value);
+      std::string settings;
+      ok = (bool)(stream >> mode.name) &&
+           mode.name.compare(0, strlen(REFERENCE_MODE), REFERENCE_MODE) != 0;
+      std::getline(stream, settings);
+      ok = ok && parseModeSettings(settings, mode);
+      extraModes.push_back(mode);
+    } else if (key == "references") {
+      referenceDir = value;
+    } else if (key == "update-references") {
+      updateReferences = atoi(value.c_str()) != 0;
+    } else if (key == "frames") {
+      timedFrames = atoi(value.c_str());
+      ok = timedFrames > 0;
+    } else if (key == "error-maps") {
+      errorMapDir = value;
+    } else if (key == "output") {
+      output = value;
+    } else if (key == "min-psnr") {
+      minPSNR = atof(value.c_str());
+    } else if (key == "min-ssim") {
+      minSSIM = atof(value.c_str());
+    } else {
+      ok = applyRenderSetting(base, key, value);
+    }
+    if (!ok) {
+      std::cerr << "Invalid value for --" << key << ": " << value << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<Scene> allScenes = makeScenes();
+  std::vector<Scene> scenes;
+  if (sceneNames.empty()) {
+    scenes = allScenes;
+  } else {
+    for (const std::string &name : sceneNames) {
+      auto it = std::find_if(allScenes.begin(), allScenes.end(),
+                             [&](const Scene &s) { return name == s.name; });
+      if (it == allScenes.end()) {
+        std::cerr << "Unknown scene: " << name << std::endl;
+        return 1;
+      }
+      scenes.push_back(*it);
+    }
+  }
+
+  // The reference runs first: every other mode is scored against it
+  std::vector<Mode> modes(1);
+  modes[0].name = REFERENCE_MODE;
+  parseModeSettings(REFERENCE_SETTINGS, modes[0]);
+  for (const auto &builtin : BUILTIN_MODES) {
+    if (!modeNames.empty() &&
+        std::find(modeNames.begin(), modeNames.end(), builtin[0]) ==
+            modeNames.end())
+      continue;
+    Mode mode;
+    mode.name = builtin[0];
+    parseModeSettings(builtin[1], mode);
+    modes.push_back(mode);
+  }
+  for (const std::string &name : modeNames) {
+    bool known = false;
+    for (const auto &builtin : BUILTIN_MODES)
+      known = known || name == builtin[0];
+    if (!known) {
+      std::cerr << "Unknown mode: " << name << std::endl;
+      return 1;
+    }
+  }
+  modes.insert(modes.end(), extraModes.begin(), extraModes.end());
+
+  // Each other reference goes in just before the first mode scored
+  // against it
+  std::vector<Mode> ordered(1, modes[0]);
+  for (size_t m = 1; m < modes.size(); m++) {
+    Mode variant = referenceFor(modes[0], modes[m]);
+    bool known = false;
+    for (const Mode &mode : ordered)
+      known = known || mode.name == variant.name;
+    if (!known)
+      ordered.push_back(variant);
+    ordered.push_back(modes[m]);
+    ordered.back().reference = variant.name;
+  }
+  modes = ordered;
+
+  if ((updateReferences && !createDirectory(referenceDir)) ||
+      (!errorMapDir.empty() && !createDirectory(errorMapDir)))
+    return 1;
+  for (const Mode &mode : modes) {
+    if (!checkRenderSettings(modeSettings(base, scenes[0], modes[0], mode))) {
+      std::cerr << "in mode " << mode.name << std::endl;
+      return 1;
+    }
+  }
+
+  HeadlessContext context;
+  if (!context.init())
+    return -1;
+
+  OffscreenRenderer renderer;
+  renderer.getBlackHoleRenderer().getOptions() =
+      modeSettings(base, scenes[0], modes[0], modes[0]).options;
+  if (!renderer.init(base.width, base.height))
+    return -1;
+
+  struct SceneData {
+    std::vector<unsigned char> reference;
+    std::vector<unsigned char> masks[REGION_COUNT];
+    double referenceMs = 0.0;
+  };
+  // Per reference, per scene
+  std::map<std::string, std::vector<SceneData>> sceneData;
+
+  std::ostringstream cases;
+  bool firstCase = true;
+  bool passed = true;
+  std::vector<unsigned char> pixels;
+  std::vector<float> ssim;
+
+  printf("%-16s %-10s %9s %8s %8s %7s %8s %8s %8s\n", "mode", "scene",
+         "ms", "speedup", "PSNR", "SSIM", "horizon", "ring", "disk");
+  for (const Mode &mode : modes) {
+    bool isReference = mode.reference.empty();
+    std::vector<SceneData> &referenceData =
+        sceneData[isReference ? mode.name : mode.reference];
+    referenceData.resize(scenes.size());
+    for (size_t s = 0; s < scenes.size(); s++) {
+      const Scene &scene = scenes[s];
+      SceneData &data = referenceData[s];
+      RenderSettings settings = modeSettings(base, scene, modes[0], mode);
+
+      // The first frame also builds mode-specific state (caches, tables)
+      renderer.render(settings);
+      glFinish();
+      std::vector<double> frameMs;
+      for (int f = 0; f < timedFrames; f++) {
+        auto start = Clock::now();
+        renderer.render(settings);
+        glFinish();
+        frameMs.push_back(elapsedMs(start));
+      }
+      double ms = percentile(frameMs, 50.0);
+      renderer.readPixels(pixels);
+
+      if (isReference) {
+        data.referenceMs = ms;
+        std::string path = referencePath(referenceDir, scene, mode, settings);
+        bool stale = false;
+        if (updateReferences) {
+          data.reference = pixels;
+          if (!saveReference(path, settings, pixels))
+            return 1;
+          std::cout << "Saved reference: " << path << std::endl;
+        } else if (!loadReference(path, settings, data.reference, stale)) {
+          // Never score against this build's own render: that would pass
+          // whatever the shaders do
+          std::cerr << path
+                    << (stale ? " was rendered from other scene settings"
+                              : " is missing")
+                    << "; render references from a trusted build with"
+                    << " --update-references 1" << std::endl;
+          return 1;
+        }
+        computeRegions(settings, data.reference, data.masks);
+        if (!errorMapDir.empty() &&
+            !saveRegionImage(errorMapDir + "/" + scene.name +
+                                 referenceSuffix(mode) + "_regions.png",
+                             settings.width, settings.height, data.reference,
+                             data.masks)) {
+          std::cerr << "Failed to write region image in " << errorMapDir
+                    << std::endl;
+        }
+      }
+
+      computeSSIMMap(pixels.data(), data.reference.data(), settings.width,
+                     settings.height, ssim);
+      ImageMetrics overall =
+          compareImages(pixels.data(), data.reference.data(), ssim,
+                        settings.width, settings.height);
+      ImageMetrics regions[REGION_COUNT];
+      for (int r = 0; r < REGION_COUNT; r++) {
+        regions[r] = compareImages(pixels.data(), data.reference.data(), ssim,
+                                   settings.width, settings.height,
+                                   data.masks[r].data());
+      }
+      double speedup = ms > 0.0 ? data.referenceMs / ms : 0.0;
+
+      printf("%-16s %-10s %9.2f %7.2fx %8s %7.4f %8s %8s %8s\n",
+             mode.name.c_str(), scene.name, ms, speedup,
+             formatPSNR(overall).c_str(), overall.ssim,
+             formatPSNR(regions[HORIZON_EDGE]).c_str(),
+             formatPSNR(regions[PHOTON_RING]).c_str(),
+             formatPSNR(regions[DISK]).c_str());
+      fflush(stdout);
+
+      if (overall.psnr < minPSNR || overall.ssim < minSSIM) {
+        std::cerr << mode.name << " / " << scene.name
+                  << " is below the quality threshold" << std::endl;
+        passed = false;
+      }
+
+      if (!errorMapDir.empty() && !isReference) {
+        std::string path = errorMapDir + "/" + scene.name + "_" + mode.name +
+                           "_error.png";
+        if (!saveErrorImage(path, settings.width, settings.height, pixels,
+                            data.reference))
+          std::cerr << "Failed to write " << path << std::endl;
+      }
+
+      cases << (firstCase ? "" : ",\n") << "    {\"mode\": "
+            << jsonString(mode.name) << ", \"scene\": "
+            << jsonString(scene.name) << ", \"reference\": "
+            << jsonString(isReference ? mode.name : mode.reference)
+            << ",\n      \"frame_ms\": "
+            << jsonNumber(ms) << ", \"reference_ms\": "
+            << jsonNumber(data.referenceMs) << ", \"speedup\": "
+            << jsonNumber(speedup) << ",\n      \"overall\": ";
+      writeMetrics(cases, overall);
+      for (int r = 0; r < REGION_COUNT; r++) {
+        cases << ",\n      " << jsonString(REGION_NAMES[r]) << ": ";
+        writeMetrics(cases, regions[r]);
+      }
+      cases << "}";
+      firstCase = false;
+    }
+  }
+
+  std::ofstream file(output);
+  if (!file) {
+    std::cerr << "Failed to open " << output << " for writing" << std::endl;
+    return 1;
+  }
+  file << "{\n"
+       << "  \"renderer\": " << jsonString(context.getRenderer()) << ",\n"
+       << "  \"width\": " << base.width << ", \"height\": " << base.height
+       << ",\n"
+       << "  \"timed_frames\": " << timedFrames << ",\n"
+       << "  \"modes\": {";
+  for (size_t m = 0; m < modes.size(); m++) {
+    std::string settings;
+    for (const auto &setting : modes[m].settings)
+      settings += (settings.empty() ? "" : " ") + setting.first + "=" +
+                  setting.second;
+    file << (m ? ", " : "") << jsonString(modes[m].name) << ": "
+         << jsonString(settings);
+  }
+  file << "},\n  \"scenes\": {";
+  for (size_t s = 0; s < scenes.size(); s++) {
+    file << (s ? ", " : "") << jsonString(scenes[s].name) << ": "
+         << jsonString(scenes[s].description);
+  }
+  file << "},\n"
+       << "  \"cases\": [\n"
+       << cases.str() << "\n  ]\n}\n";
+  if (!file) {
+    std::cerr << "Failed to write " << output << std::endl;
+    return 1;
+  }
+  std::cout << "Saved: " << output << std::endl;
+  return passed ? 0 : 1;
+}